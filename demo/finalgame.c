@@ -10,6 +10,7 @@
 #include "forces.h"
 #include "collision.h"
 #include "star.h"
+#include "stepper.h"
 
 const int INIT_LIST = 5;
 const int WIDTH = 800.0;
@@ -21,6 +22,27 @@ const int SIZE_ALL = 25;
 const double GRAVITY = 250.0;
 const double FLOOR_THICKNESS = 50.0;
 const double BIG_MASS = 10000000000.0;
+// Broadphase grid cell size, a little larger than one shape
+const double CELL_SIZE = 64.0;
+// The physics runs at a fixed 120 ticks per second, whatever the frame rate
+const double PHYSICS_STEP = 1.0 / 120.0;
+// After this many ticks in one frame, the game slows down instead
+const size_t MAX_SUBSTEPS = 8;
+// Shapes slower than this many pixels per second, and accelerating by less
+// than this many pixels per second squared, for this many seconds, are put
+// to sleep
+const double SLEEP_SPEED = 5.0;
+const double SLEEP_ACCELERATION = 25.0;
+const double SLEEP_TIME = 0.5;
+
+// Collision categories (see body_set_category())
+// a shape that has been dropped by the player
+const unsigned int CAT_DROPPED = 1;
+// a dropped star bomb
+const unsigned int CAT_BOMB = 2;
+// a shape in the pit, including dropped shapes that have settled into it
+const unsigned int CAT_PIT = 4;
+const unsigned int CAT_FLOOR = 8;
 
 /**
  * Returns a list of rgb_color_t pointers for the colors of shape
@@ -140,6 +162,7 @@ void init_walls(scene_t *scene) {
     body_set_color(right_wall, (rgb_color_t) {1, 1, 1});
     body_set_color(floor, (rgb_color_t) {1, 1, 1});
     body_set_mass(floor, BIG_MASS);
+    body_set_category(floor, CAT_FLOOR);
     scene_add_body(scene, floor);
 }
 
@@ -182,16 +205,15 @@ body_t *reset_dropped(scene_t *scene){
  */
 void pit_up(scene_t *scene){
   for (size_t i = 0; i < scene_bodies(scene); i++){
-    char *status = malloc(sizeof(char));
-    *status = 'p';
     body_t *body = scene_get_body(scene, i);
     vector_t force = body_get_force(body);
     if (*(char *)body_get_info(body) == 'p'){
       vector_t centroid = body_get_centroid(body);
-      body_set_centroid(body, (vector_t) {centroid.x, centroid.y + 2 *SIZE_ALL});
+      body_teleport(body, (vector_t) {centroid.x, centroid.y + 2 *SIZE_ALL});
     }
     if (force.x == 0.0 && force.y == 0.0 && *(char *)body_get_info(body) == 'd'){
-      body_set_info(body, status);
+      *(char *)body_get_info(body) = 'p';
+      body_set_category(body, CAT_PIT);
     }
   }
 }
@@ -249,15 +271,33 @@ void bound(scene_t *scene) {
     body_t *top = scene_get_top(scene);
     vector_t curr_pos = body_get_centroid(top);
     if (curr_pos.x + SIZE_ALL > WIDTH) {
-        body_set_centroid(top, (vector_t) {WIDTH - SIZE_ALL, curr_pos.y});
+        body_teleport(top, (vector_t) {WIDTH - SIZE_ALL, curr_pos.y});
         body_set_velocity(top, VEC_ZERO);
     }
     else if (curr_pos.x - SIZE_ALL < 0) {
-        body_set_centroid(top, (vector_t) {SIZE_ALL, curr_pos.y});
+        body_teleport(top, (vector_t) {SIZE_ALL, curr_pos.y});
         body_set_velocity(top, VEC_ZERO);
     }
 }
 
+/**
+ * Removes a shape in the pit if its centroid lies strictly inside a box
+ *
+ * @param other shape found near the box
+ * @param aux the box
+ * @return true, to keep searching
+ */
+bool remove_if_centered(body_t *other, void *aux) {
+    aabb_t *box = aux;
+    vector_t centroid = body_get_centroid(other);
+    if (centroid.x > box->min.x && centroid.x < box->max.x &&
+      centroid.y > box->min.y && centroid.y < box->max.y &&
+      *(char *)body_get_info(other) == 'p') {
+        body_remove(other);
+    }
+    return true;
+}
+
 /**
  * Removes all objects in a certain radius around a certain body, including
  * the body itself
@@ -266,22 +306,47 @@ void bound(scene_t *scene) {
  * @param s scene to remove bodies from
  */
 void remove_nearby(body_t *b, scene_t *s) {
-    double x_coord = body_get_centroid(b).x;
-    double y_coord = body_get_centroid(b).y;
-    double left_bound = x_coord - 4 * SIZE_ALL;
-    double right_bound = x_coord + 4 * SIZE_ALL;
-    double lower_bound = y_coord - 4 * SIZE_ALL;
-    double upper_bound = y_coord + 4 * SIZE_ALL;
-    for (size_t i = 0; i < scene_bodies(s); i++){
-        body_t *other = scene_get_body(s, i);
-        double x = body_get_centroid(other).x;
-        double y = body_get_centroid(other).y;
-        if (x > left_bound && x < right_bound && y > lower_bound &&
-          y < upper_bound && *(char *)body_get_info(other) == 'p'){
-            body_remove(other);
+    vector_t centroid = body_get_centroid(b);
+    vector_t reach = {4 * SIZE_ALL, 4 * SIZE_ALL};
+    aabb_t box = {vec_subtract(centroid, reach), vec_add(centroid, reach)};
+    scene_query_aabb(s, box, remove_if_centered, &box);
+    body_remove(b);
+}
+
+/**
+ * A search for the shapes of one color touching a shape
+ */
+typedef struct {
+    body_t *body;
+    scene_t *scene;
+    list_t *touching;
+} color_search_t;
+
+int count_colors(body_t *b, scene_t *s, int count, list_t *l);
+
+/**
+ * Adds a shape near the searched shape to the list if it has the same color
+ * and is close enough, and searches around it in turn
+ *
+ * @param body a shape near the searched shape
+ * @param aux the color_search_t
+ * @return true, to keep searching
+ */
+bool visit_nearby(body_t *body, void *aux) {
+    color_search_t *search = aux;
+    rgb_color_t c1 = body_get_color(search->body);
+    rgb_color_t c2 = body_get_color(body);
+    vector_t pos1 = body_get_centroid(search->body);
+    vector_t pos2 = body_get_centroid(body);
+    double distance = sqrt(pow((pos2.x - pos1.x), 2) + pow((pos2.y - pos1.y), 2));
+    if (distance < 2.5 * SIZE_ALL && c1.r == c2.r && c1.g == c2.g && c1.b == c2.b) {
+        if (!list_contains(search->touching, body)) {
+            list_add(search->touching, body);
+            count_colors(body, search->scene, list_size(search->touching),
+              search->touching);
         }
     }
-    body_remove(b);
+    return true;
 }
 
 /**
@@ -295,20 +360,10 @@ void remove_nearby(body_t *b, scene_t *s) {
  * @return number of objects touching b with the same color as b
  */
 int count_colors(body_t *b, scene_t *s, int count, list_t *l) {
-    for (size_t i = 0; i < scene_bodies(s); i++){
-        body_t *body = scene_get_body(s, i);
-        rgb_color_t c1 = body_get_color(b);
-        rgb_color_t c2 = body_get_color(body);
-        vector_t pos1 = body_get_centroid(b);
-        vector_t pos2 = body_get_centroid(body);
-        double distance = sqrt(pow((pos2.x - pos1.x), 2) + pow((pos2.y - pos1.y), 2));
-        if (distance < 2.5 * SIZE_ALL && c1.r == c2.r && c1.g == c2.g && c1.b == c2.b) {
-            if (!list_contains(l, body)) {
-                list_add(l, body);
-                count_colors(body, s, list_size(l), l);
-            }
-        }
-    }
+    // Any shape whose centroid is near enough has some point near enough
+    color_search_t search = {b, s, l};
+    scene_query_radius(s, body_get_centroid(b), 2.5 * SIZE_ALL, visit_nearby,
+      &search);
     return list_size(l);
 }
 
@@ -348,37 +403,45 @@ void destroy(body_t *body_1, body_t *body_2, vector_t axis, void *aux) {
         remove_nearby(body_1, (scene_t*) aux);
     }
     else if (*(char*)body_get_info(body_1) != 'f') {
-        char *status = malloc(sizeof(char));
-        *status = 'p';
-        body_set_info(body_1, status);
+        // Once in the pit the shape no longer matches this rule, so the
+        // match check runs once per drop
+        *(char *)body_get_info(body_1) = 'p';
+        body_set_category(body_1, CAT_PIT);
+        body_set_bullet(body_1, false);
         touching_colors(body_1, (scene_t*) aux);
     }
 }
 
 /**
- * Creates physics collision for shapes in scene that are within
- * 4 radius of the body
- * Creates collisions with disappearance of same colors
+ * Registers the collision rules of the game with the scene:
+ * dropped shapes and bombs stop on the pit, the floor and other dropped
+ * shapes, and set off color matches or explosions when they touch the pit.
+ *
+ * @param scene the scene containing the game
+ */
+void init_collision_rules(scene_t *scene){
+  scene_set_broadphase(scene, broadphase_init_grid(CELL_SIZE));
+  create_physics_collision_rule(scene, 0.0, CAT_DROPPED | CAT_BOMB,
+    CAT_PIT | CAT_FLOOR | CAT_DROPPED);
+  scene_add_collision_rule(scene, CAT_DROPPED | CAT_BOMB, CAT_PIT, destroy,
+    scene, NULL);
+}
+
+/**
+ * Settles every shape in the scene before a new shape is dropped, making
+ * them heavy and stationary so the dropped shape comes to rest on them
+ * instead of pushing them aside
  *
  * @param scene with all the bodies
- * @param body that we are finding nearby shapes to
  */
-void create_nearby_collision(scene_t *scene, body_t *body){
-  double x_coord = body_get_centroid(body).x;
-  double left_bound = x_coord - 4 * SIZE_ALL;
-  double right_bound = x_coord + 4 * SIZE_ALL;
+void settle_bodies(scene_t *scene){
   for (size_t i = 0; i < scene_bodies(scene); i++){
     body_t *other = scene_get_body(scene, i);
-    double x = body_get_centroid(other).x;
+    if (other == scene_get_top(scene)) {
+      continue;
+    }
     body_set_mass(other, BIG_MASS);
     body_set_velocity(other, VEC_ZERO);
-    if (x > left_bound && x < right_bound && *(char *)body_get_info(other) != 't'
-      && *(char *)body_get_info(other) != 'b' && *(char *)body_get_info(other) != 'w'){
-      create_physics_collision(scene, 0.0, body, other);
-    }
-    if (*(char *)body_get_info(body) != 'p' && x > left_bound && x < right_bound && *(char *)body_get_info(other) == 'p'){
-      create_collision(scene, body, other, destroy, scene, free);
-    }
   }
 }
 
@@ -393,10 +456,9 @@ void init_one_row(scene_t *scene){
   int rand_index_c = rand_int(6);
   rgb_color_t *color = list_get(colors, rand_index_c);
   for (int i = SIZE_ALL; i < WIDTH; i+= 2 * SIZE_ALL){
-    char *status = malloc(sizeof(char));
-    *status = 'p';
     body_t *shape1 = init_polygon(rand_index_n, SIZE_ALL, (vector_t){i, 10 + SIZE_ALL});
-    body_set_info(shape1, status);
+    *(char *)body_get_info(shape1) = 'p';
+    body_set_category(shape1, CAT_PIT);
     body_set_velocity(shape1, VEC_ZERO);
     body_set_color(shape1, *color);
     scene_add_body(scene, shape1);
@@ -434,19 +496,24 @@ void on_mouse(char button, mouse_event_type_t type, void *s){
     body_t *floor = scene_get_body(s, 0);
     body_set_force(floor, VEC_ZERO);
     body_set_velocity(floor, VEC_ZERO);
-    char *status = malloc(sizeof(char));
-    *status = 'd';
     switch(type){
       case MOUSE_PRESSED:
           if (button == LEFT_BUTTON){
             body_t *dropped = scene_get_top(s);
             create_gravity_one(s, GRAVITY, dropped, floor);
-            create_nearby_collision(s, dropped);
+            // Falling shapes pick up speed quickly enough to skip over the
+            // thin gaps between pit shapes in one step
+            body_set_bullet(dropped, true);
+            settle_bodies(s);
             if (*(char *)body_get_info(dropped) == 'b') {
+              body_set_category(dropped, CAT_BOMB);
               scene_add_score(s, 16);
             }
+            else {
+              body_set_category(dropped, CAT_DROPPED);
+            }
             if (*(char *)body_get_info(dropped) == 't') {
-              body_set_info(dropped, status);
+              *(char *)body_get_info(dropped) = 'd';
             }
           }
           break;
@@ -456,6 +523,22 @@ void on_mouse(char button, mouse_event_type_t type, void *s){
     }
 }
 
+/**
+ * Stops the search at the first shape in the pit whose centroid is above
+ * the top of the window
+ *
+ * @param body shape found near the top of the window
+ * @param aux set to true if body is above the top
+ * @return false to stop searching once a shape is found
+ */
+bool find_overflow(body_t *body, void *aux) {
+  if (body_get_centroid(body).y > HEIGHT - SIZE_ALL && *(char *)body_get_info(body) == 'p'){
+    *(bool *)aux = true;
+    return false;
+  }
+  return true;
+}
+
 /**
  * Checks to see if shapes in pit have reached the top of window
  * @ returns true if so, returns false if not
@@ -463,13 +546,10 @@ void on_mouse(char button, mouse_event_type_t type, void *s){
  * @param scene
  */
 bool game_over(scene_t *scene){
-  for (size_t i = 0; i < scene_bodies(scene); i++){
-    body_t *body = scene_get_body(scene, i);
-    if (body_get_centroid(body).y > HEIGHT - SIZE_ALL && *(char *)body_get_info(body) == 'p'){
-      return true;
-    }
-  }
-  return false;
+  bool over = false;
+  aabb_t above = {{-INFINITY, HEIGHT - SIZE_ALL}, {INFINITY, INFINITY}};
+  scene_query_aabb(scene, above, find_overflow, &over);
+  return over;
 }
 
 /**
@@ -514,10 +594,16 @@ int main(int argc, char *argv[]) {
       exit(EXIT_FAILURE);
   }
   scene_t *scene = scene_init();
+  // The pit is almost always at rest, so it is skipped while nothing hits it
+  scene_set_sleeping(scene, true);
+  scene_set_sleep_thresholds(scene, SLEEP_SPEED, SLEEP_ACCELERATION,
+    SLEEP_TIME);
+  init_collision_rules(scene);
   init_walls(scene);
   body_t *dropped = reset_dropped(scene);
   scene_set_top(scene, dropped);
   init_pit(scene);
+  stepper_t *stepper = stepper_init(PHYSICS_STEP, MAX_SUBSTEPS);
   double total_time = 0.0;
   double total_time_elapsed = 0.0;
   sdl_on_key((key_handler_t) on_key, dropped, scene);
@@ -534,6 +620,7 @@ int main(int argc, char *argv[]) {
         total_time_elapsed = 0.0;
         pit_up(scene);
         init_one_row(scene);
+        scene_refresh_queries(scene);
     }
     int score = scene_get_score(scene);
     char score_msg[15];
@@ -543,9 +630,9 @@ int main(int argc, char *argv[]) {
     if (!game_over(scene)) {
         get_text_and_rect(renderer, 580, 0, concat("Score: ", score_msg), font, &texture1, &rect1);
         get_text_and_rect(renderer, 590, rect1.y + rect1.h, concat("Time: ", time_msg), font, &texture2, &rect2);
-        scene_tick(scene, time_elapsed);
+        stepper_advance(stepper, scene, time_elapsed);
         bound(scene);
-        sdl_render_scene(scene);
+        sdl_render_scene_interpolated(scene, stepper_alpha(stepper));
     }
     else {
         game_ended = true;
@@ -560,6 +647,7 @@ int main(int argc, char *argv[]) {
   SDL_DestroyTexture(texture1);
   SDL_DestroyTexture(texture2);
   TTF_Quit();
+  stepper_free(stepper);
   scene_free(scene);
 
   return 0;
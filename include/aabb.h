@@ -0,0 +1,62 @@
+#ifndef __AABB_H__
+#define __AABB_H__
+
+#include <stdbool.h>
+#include "shape.h"
+#include "vector.h"
+
+/**
+ * An axis-aligned bounding box.
+ * aabb_t is defined here instead of aabb.c because it is passed *by value*.
+ */
+typedef struct {
+  vector_t min;
+  vector_t max;
+} aabb_t;
+
+/**
+ * Computes the smallest box containing every vertex of a shape.
+ * Asserts that the shape is non-empty.
+ *
+ * @param shape the vertices to bound
+ * @return the bounding box
+ */
+aabb_t aabb_of_shape(const shape_t *shape);
+
+/**
+ * Checks whether two boxes overlap. Boxes that only touch count as overlapping.
+ *
+ * @param a the first box
+ * @param b the second box
+ * @return whether the boxes intersect
+ */
+bool aabb_overlaps(aabb_t a, aabb_t b);
+
+/**
+ * Checks whether one box lies entirely inside another.
+ *
+ * @param outer the containing box
+ * @param inner the contained box
+ * @return whether inner is inside outer
+ */
+bool aabb_contains(aabb_t outer, aabb_t inner);
+
+/**
+ * Computes the smallest box containing two boxes.
+ *
+ * @param a the first box
+ * @param b the second box
+ * @return the union of the boxes
+ */
+aabb_t aabb_union(aabb_t a, aabb_t b);
+
+/**
+ * Grows a box by a margin on every side.
+ *
+ * @param box the box to grow
+ * @param margin the distance to move each side outwards
+ * @return the grown box
+ */
+aabb_t aabb_expand(aabb_t box, double margin);
+
+#endif // #ifndef __AABB_H__
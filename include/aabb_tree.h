@@ -0,0 +1,125 @@
+#ifndef __AABB_TREE_H__
+#define __AABB_TREE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "aabb.h"
+
+/**
+ * A dynamic bounding volume hierarchy over axis-aligned boxes.
+ * Each leaf (proxy) stores a box and a user pointer; internal nodes store the
+ * union of their children. Leaves are inserted next to the sibling that
+ * least increases the total perimeter, and the tree is rebalanced with
+ * rotations on the way back up, so its height stays logarithmic.
+ * Unlike a uniform grid, it copes with bodies of very different sizes.
+ */
+typedef struct aabb_tree aabb_tree_t;
+
+/**
+ * A function called for each leaf found by aabb_tree_query().
+ *
+ * @param aux the auxiliary value passed to aabb_tree_query()
+ * @param proxy the leaf whose box overlaps the query box
+ * @return true to keep searching, false to stop
+ */
+typedef bool (*aabb_tree_visitor_t)(void *aux, int proxy);
+
+/**
+ * Allocates memory for an empty tree.
+ * Asserts that the required memory is allocated.
+ *
+ * @return a pointer to the newly allocated tree
+ */
+aabb_tree_t *aabb_tree_init(void);
+
+/**
+ * Releases the memory allocated for a tree.
+ * Does not free the user pointers stored in its leaves.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ */
+void aabb_tree_free(aabb_tree_t *tree);
+
+/**
+ * Inserts a leaf with the given box.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param box the box of the new leaf (usually fattened by a margin)
+ * @param data a user pointer to associate with the leaf
+ * @return the id of the new leaf, which stays valid until it is removed
+ */
+int aabb_tree_insert(aabb_tree_t *tree, aabb_t box, void *data);
+
+/**
+ * Removes a leaf. Asserts that proxy is a leaf of the tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy a leaf id returned from aabb_tree_insert()
+ */
+void aabb_tree_remove(aabb_tree_t *tree, int proxy);
+
+/**
+ * Updates a leaf for an object whose tight bounding box is now box.
+ * If the leaf's stored box still contains box, nothing changes; otherwise the
+ * leaf is reinserted with box grown by margin on every side, so small
+ * movements do not touch the tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy a leaf id returned from aabb_tree_insert()
+ * @param box the object's current tight bounding box
+ * @param margin how far to fatten the box if the leaf has to move
+ * @return whether the leaf was reinserted
+ */
+bool aabb_tree_move(aabb_tree_t *tree, int proxy, aabb_t box, double margin);
+
+/**
+ * Checks whether an id currently names a leaf of the tree.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param proxy any id
+ * @return whether proxy is a live leaf
+ */
+bool aabb_tree_is_leaf(aabb_tree_t *tree, int proxy);
+
+/**
+ * Gets the (fattened) box stored in a leaf.
+ */
+aabb_t aabb_tree_get_box(aabb_tree_t *tree, int proxy);
+
+/**
+ * Gets the user pointer stored in a leaf.
+ */
+void *aabb_tree_get_data(aabb_tree_t *tree, int proxy);
+
+/**
+ * Gets one more than the largest id the tree has handed out,
+ * for callers that keep per-leaf arrays.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @return an upper bound on leaf ids
+ */
+size_t aabb_tree_capacity(aabb_tree_t *tree);
+
+/**
+ * Gets the height of the tree (0 for an empty tree or a single leaf).
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @return the number of edges on the longest root-to-leaf path
+ */
+int aabb_tree_height(aabb_tree_t *tree);
+
+/**
+ * Calls visit on every leaf whose stored box overlaps a query box.
+ * Does not allocate unless the tree is far out of balance, and keeps no
+ * state in the tree, so visit may query the tree again. Leaves must not be
+ * added, moved or removed from visit.
+ *
+ * @param tree a pointer to a tree returned from aabb_tree_init()
+ * @param box the query box
+ * @param visit the function to call on each overlapping leaf
+ * @param aux an auxiliary value to pass to visit
+ */
+void aabb_tree_query(aabb_tree_t *tree, aabb_t box, aabb_tree_visitor_t visit,
+  void *aux);
+
+#endif // #ifndef __AABB_TREE_H__
@@ -0,0 +1,63 @@
+#ifndef __AXIS_CACHE_H__
+#define __AXIS_CACHE_H__
+
+#include <stdbool.h>
+#include "body.h"
+#include "vector.h"
+
+/**
+ * Remembers, for each pair of bodies, the axis that decided their last
+ * narrowphase test (see find_body_collision_cached()), keyed by the
+ * identity of the two bodies in either order.
+ * Axes are remembered for one tick: lookups see the axes stored before the
+ * last axis_cache_next_tick(), so pairs that are not tested in a tick are
+ * forgotten. Lookups only read, so they may run on several threads at once
+ * as long as nothing is stored meanwhile.
+ */
+typedef struct axis_cache axis_cache_t;
+
+/**
+ * Allocates an empty axis cache.
+ *
+ * @return a pointer to the newly allocated cache
+ */
+axis_cache_t *axis_cache_init(void);
+
+/**
+ * Releases the memory allocated for an axis cache.
+ * Does not free any bodies.
+ *
+ * @param cache a pointer to a cache returned from axis_cache_init()
+ */
+void axis_cache_free(axis_cache_t *cache);
+
+/**
+ * Starts a new tick: the axes stored since the last call become the ones
+ * axis_cache_get() returns, and older ones are forgotten.
+ *
+ * @param cache a pointer to a cache returned from axis_cache_init()
+ */
+void axis_cache_next_tick(axis_cache_t *cache);
+
+/**
+ * Gets the axis remembered for a pair of bodies from the last tick.
+ *
+ * @param cache a pointer to a cache returned from axis_cache_init()
+ * @param body1 one body of the pair
+ * @param body2 the other body of the pair
+ * @return the remembered axis, or the zero vector if there is none
+ */
+vector_t axis_cache_get(axis_cache_t *cache, body_t *body1, body_t *body2);
+
+/**
+ * Remembers the axis that decided this tick's test of a pair of bodies.
+ *
+ * @param cache a pointer to a cache returned from axis_cache_init()
+ * @param body1 one body of the pair
+ * @param body2 the other body of the pair
+ * @param axis the axis to remember
+ */
+void axis_cache_put(axis_cache_t *cache, body_t *body1, body_t *body2,
+  vector_t axis);
+
+#endif // #ifndef __AXIS_CACHE_H__
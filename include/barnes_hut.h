@@ -0,0 +1,52 @@
+#ifndef __BARNES_HUT_H__
+#define __BARNES_HUT_H__
+
+#include "body.h"
+#include "job_pool.h"
+#include "list.h"
+
+/**
+ * Newtonian gravity between every pair of bodies in a scene, approximated
+ * with the Barnes-Hut method in O(n log n) per tick instead of the O(n^2)
+ * of one create_newtonian_gravity() per pair.
+ * Each update builds a quadtree over the body centroids; a cell whose width
+ * divided by its distance to a body is below the opening angle theta acts
+ * on that body as a single mass at its center of mass.
+ * A scene owns at most one gravity field; see scene_set_gravity_field().
+ */
+typedef struct barnes_hut barnes_hut_t;
+
+/**
+ * Allocates a Barnes-Hut gravity field.
+ * theta = 0 gives the exact pairwise forces; around 0.5 is a common
+ * compromise between speed and accuracy.
+ * Asserts that theta is non-negative.
+ *
+ * @param G the gravitational proportionality constant
+ * @param theta the opening angle
+ * @return a pointer to the newly allocated gravity field
+ */
+barnes_hut_t *barnes_hut_init(double G, double theta);
+
+/**
+ * Releases the memory allocated for a gravity field.
+ *
+ * @param bh a pointer to a gravity field returned from barnes_hut_init()
+ */
+void barnes_hut_free(barnes_hut_t *bh);
+
+/**
+ * Adds the gravitational pull of all the other bodies to each body.
+ * As with create_newtonian_gravity(), masses closer than MIN_DIST do not
+ * attract each other. Removed bodies and bodies with zero or infinite mass
+ * neither pull nor are pulled.
+ * The tree is built on the calling thread; the forces on the bodies are then
+ * computed in parallel, since each body's force only reads the tree.
+ *
+ * @param bh a pointer to a gravity field returned from barnes_hut_init()
+ * @param bodies the bodies to pull on each other
+ * @param pool a pool to spread the force evaluation over, or NULL
+ */
+void barnes_hut_apply(barnes_hut_t *bh, list_t *bodies, job_pool_t *pool);
+
+#endif // #ifndef __BARNES_HUT_H__
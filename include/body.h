@@ -2,18 +2,59 @@
 #define __BODY_H__
 
 #include <stdbool.h>
+#include "aabb.h"
 #include "color.h"
 #include "list.h"
+#include "shape.h"
 #include "vector.h"
 
+struct body_store;
+
+/**
+ * A convex piece of a concave body (see shape_decompose()), kept like the
+ * body's own shape: unrotated relative to the centroid, and in world space
+ * with the body's cached vertices.
+ */
+typedef struct {
+  shape_t local_shape;
+  shape_t local_normals;
+  shape_t world_shape;
+  shape_t world_normals;
+  aabb_t world_aabb;
+} body_piece_t;
+
 /**
  * A rigid body constrained to the plane.
  * Implemented as a polygon with uniform density.
  * Bodies can accumulate forces and impulses during each tick.
  * Angular physics (i.e. torques) are not currently implemented.
+ *
+ * The shape is stored once in local space (relative to the centroid, at
+ * orientation 0). World-space vertices are only computed when they are
+ * requested and are cached until the centroid or orientation changes,
+ * so moving a body is O(1) regardless of its vertex count.
  */
  typedef struct body {
-   list_t *shape;
+   // vertices relative to the centroid, unrotated
+   shape_t local_shape;
+   // cached world-space vertices, valid for world_centroid/world_orientation
+   shape_t world_shape;
+   vector_t world_centroid;
+   double world_orientation;
+   bool world_valid;
+   // bounding box of world_shape
+   aabb_t world_aabb;
+   // distance from the centroid to the furthest vertex, which moving or
+   // rotating the body does not change
+   double bounding_radius;
+   // unit normals of the edges, one per set of parallel edges, unrotated,
+   // and rotated to world_orientation along with world_shape
+   shape_t local_normals;
+   shape_t world_normals;
+   // convex pieces the body is tested as if its shape is concave, or 0
+   // pieces if the shape is convex and is tested whole
+   body_piece_t *pieces;
+   size_t piece_count;
    double mass;
    rgb_color_t color;
    vector_t centroid;
@@ -24,6 +65,39 @@
    void *info;
    free_func_t info_freer;
    int forRemoval;
+   // if non-NULL, centroid, velocity, force and impulse live in this store
+   // (see body_store.h) and the fields above are stale
+   struct body_store *store;
+   size_t store_index;
+   // bitmask matched against scene collision rules; 0 matches no rule
+   unsigned int category;
+   // leaf id of this body in a tree broadphase, or -1
+   int broadphase_proxy;
+   // leaf id of this body in its scene's query tree (see scene_query_aabb()),
+   // or -1
+   int query_proxy;
+   // index of this body in the contact solver solving it, or -1
+   int solver_slot;
+   // force creators registered on this body, so a scene can retire them
+   // when the body is removed without scanning every force
+   list_t *forces;
+   // set while a scene has queued forces for pruning from this list
+   bool forces_stale;
+   // position in the scene's body list, refreshed by scene_tick() before
+   // forces are accumulated into per-thread arrays
+   size_t scene_index;
+   // state saved by body_save_previous_state(), for render interpolation
+   vector_t previous_centroid;
+   double previous_orientation;
+   bool previous_valid;
+   // whether the body is resting (see body_set_asleep()), and for how long
+   // its scene has seen it moving slowly enough to fall asleep
+   bool asleep;
+   double sleep_time;
+   // the store to rejoin on waking, since sleeping bodies leave their store
+   struct body_store *sleep_store;
+   // whether scene_tick() sweeps the body's moves (see body_set_bullet())
+   bool bullet;
  } body_t;
 
 /**
@@ -37,7 +111,9 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color);
  * The body is initially at rest.
  * Asserts that the mass is positive and that the required memory is allocated.
  *
- * @param shape a list of vectors describing the initial shape of the body
+ * @param shape a list of vectors describing the initial shape of the body.
+ *   The vertices are copied into the body's packed vertex storage
+ *   and the list is freed.
  * @param mass the mass of the body (if INFINITY, stops the body from moving)
  * @param color the color of the body, used to draw it on the screen
  * @param info additional information to associate with the body,
@@ -69,6 +145,99 @@ void body_free(body_t *body);
  */
 list_t *body_get_shape(body_t *body);
 
+/**
+ * Gets the current vertices of a body without copying them.
+ * The world-space vertices are recomputed from the local shape only if the
+ * body has moved or rotated since they were last requested.
+ * The returned shape is owned by the body and must not be modified or freed.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the packed vertices describing the body's current position
+ */
+const shape_t *body_get_vertices(body_t *body);
+
+/**
+ * Gets the axis-aligned bounding box of a body's current vertices.
+ * Cached together with the world-space vertices (see body_get_vertices()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's bounding box
+ */
+aabb_t body_get_aabb(body_t *body);
+
+/**
+ * Gets the unit normals of a body's edges at its current orientation,
+ * one for each set of parallel edges (see shape_unique_normals()).
+ * They are computed once when the body is created and only rotated again
+ * when the body's orientation changes.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the normals, packed like vertices; owned by the body and valid
+ *   until the body is next rotated
+ */
+const shape_t *body_get_normals(body_t *body);
+
+/**
+ * Gets the number of convex pieces a concave body was split into when it
+ * was created (see shape_decompose()). Collision tests work on the pieces
+ * instead of the whole shape, since separating axis tests and GJK are only
+ * correct for convex shapes.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the number of pieces, or 0 if the body is convex
+ */
+size_t body_get_piece_count(body_t *body);
+
+/**
+ * Gets a convex piece of a concave body at the body's current position.
+ * Asserts that index is less than body_get_piece_count().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param index the index of the piece
+ * @return the piece's world-space vertices, unique edge normals and bounding
+ *   box; owned by the body and valid until the body next moves
+ */
+const body_piece_t *body_get_piece(body_t *body, size_t index);
+
+/**
+ * Gets the radius of a circle about a body's centroid that contains it.
+ * Computed once when the body is created, since it does not depend on the
+ * body's position or orientation.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the distance from the centroid to the furthest vertex
+ */
+double body_get_radius(body_t *body);
+
+/**
+ * Remembers a body's current centroid and orientation, so that it can be
+ * drawn part of the way between that state and a later one.
+ * Called by stepper_advance() before each physics step.
+ *
+ * @param body a pointer to a body returned from body_init()
+ */
+void body_save_previous_state(body_t *body);
+
+/**
+ * Writes a body's vertices as they were a fraction alpha of the way from
+ * the state saved by body_save_previous_state() to its current state.
+ * Bodies without a saved state are written at their current state.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param alpha how far to go from the saved state, from 0 to 1
+ * @param dest an initialized shape to overwrite with the vertices
+ */
+void body_get_interpolated_vertices(body_t *body, double alpha,
+  shape_t *dest);
+
+/**
+ * Gets the collision categories of a body.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the bitmask set with body_set_category(), initially 0
+ */
+unsigned int body_get_category(body_t *body);
+
 /**
  * Gets the current center of mass of a body.
  * While this could be calculated with polygon_centroid(), that becomes too slow
@@ -145,8 +314,22 @@ void *body_get_info(body_t *body);
  */
 void body_set_centroid(body_t *body, vector_t x);
 
+/**
+ * Moves a body to a new position instantly, outside of the physics.
+ * Unlike body_set_centroid(), also saves the new state as the previous one
+ * (see body_save_previous_state()), so interpolated rendering draws the
+ * body at its new position instead of sweeping it across the screen.
+ * To turn a body instantly, call body_save_previous_state() after
+ * body_set_rotation().
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param x the body's new centroid
+ */
+void body_teleport(body_t *body, vector_t x);
+
 /**
  * Changes a body's velocity (the time-derivative of its position).
+ * A nonzero velocity wakes a sleeping body.
  *
  * @param body a pointer to a body returned from body_init()
  * @param v the body's new velocity
@@ -179,6 +362,16 @@ void body_set_mass(body_t *body, double mass);
  */
 void body_set_rotation(body_t *body, double angle);
 
+/**
+ * Changes the collision categories of a body.
+ * Scene collision rules (see scene_add_collision_rule()) are matched against
+ * these bits, so a body can belong to several categories at once.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param category the body's new category bitmask
+ */
+void body_set_category(body_t *body, unsigned int category);
+
 /*
 * Changes a body's info
 *
@@ -226,6 +419,46 @@ void body_add_force(body_t *body, vector_t force);
  */
 void body_add_impulse(body_t *body, vector_t impulse);
 
+/**
+ * Puts a body to sleep or wakes it up.
+ * scene_tick() does not integrate a sleeping body, drops the forces applied
+ * to it, and skips the narrowphase on pairs of sleeping bodies.
+ * Putting a body to sleep stops it; a nonzero velocity or impulse wakes it.
+ * Scenes with sleeping enabled (see scene_set_sleeping()) do this by
+ * themselves for bodies at rest and for the bodies they touch.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param asleep whether the body should be asleep
+ */
+void body_set_asleep(body_t *body, bool asleep);
+
+/**
+ * Returns whether a body is asleep (see body_set_asleep()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is asleep, initially false
+ */
+bool body_is_asleep(body_t *body);
+
+/**
+ * Marks a body as a bullet, or clears the mark.
+ * scene_tick() sweeps a bullet's move each tick and stops it where it first
+ * overlaps a body that some collision rule covers, so a fast body cannot
+ * pass through a body thinner than its step.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param bullet whether the body should be a bullet
+ */
+void body_set_bullet(body_t *body, bool bullet);
+
+/**
+ * Returns whether a body is a bullet (see body_set_bullet()).
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is a bullet, initially false
+ */
+bool body_is_bullet(body_t *body);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
@@ -0,0 +1,145 @@
+#ifndef __BODY_STORE_H__
+#define __BODY_STORE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "body.h"
+#include "vector.h"
+
+/**
+ * Structure-of-arrays storage for the state that is touched every tick.
+ * Positions, velocities, accumulated forces and impulses, and masses
+ * of every stored body live in parallel arrays aligned to
+ * BODY_STORE_ALIGNMENT bytes, so the integrator can advance all bodies in one
+ * loop that the compiler (or the SSE2/AVX2 paths) can vectorize.
+ *
+ * A body added to a store keeps working through the usual body_t accessors;
+ * they read and write its slot in the store instead of the body's own fields.
+ * The order of slots is unrelated to the order of bodies in a scene.
+ */
+typedef struct body_store body_store_t;
+
+/**
+ * Alignment of every array in a body store, in bytes.
+ * Enough for aligned AVX loads of four doubles.
+ */
+#define BODY_STORE_ALIGNMENT 32
+
+/**
+ * The implementations of body_store_integrate(). The SIMD ones advance 2
+ * (SSE2) or 4 (AVX2) bodies with each instruction, and give exactly the same
+ * results as the scalar one and as body_tick().
+ */
+typedef enum {
+  BODY_STORE_SCALAR,
+  BODY_STORE_SSE2,
+  BODY_STORE_AVX2
+} body_store_kernel_t;
+
+/**
+ * Allocates memory for an empty body store.
+ * Asserts that the required memory is allocated.
+ *
+ * @param initial_capacity the number of bodies to allocate space for
+ * @return a pointer to the newly allocated store
+ */
+body_store_t *body_store_init(size_t initial_capacity);
+
+/**
+ * Releases the memory allocated for a body store.
+ * Bodies still in the store are detached first, so they keep their state.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ */
+void body_store_free(body_store_t *store);
+
+/**
+ * Gets the number of bodies in a store.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @return the number of bodies added with body_store_add()
+ */
+size_t body_store_size(body_store_t *store);
+
+/**
+ * Moves a body's position, velocity, force, impulse and mass into the store.
+ * Asserts that the body is not already in a store.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param body the body to add
+ */
+void body_store_add(body_store_t *store, body_t *body);
+
+/**
+ * Copies a body's state back into the body and removes it from the store.
+ * The last slot is moved into the freed one, so this is O(1).
+ * Asserts that the body is in this store.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param body the body to remove
+ */
+void body_store_remove(body_store_t *store, body_t *body);
+
+/**
+ * Advances every body in the store by dt, exactly as body_tick() would:
+ * applies the accumulated force and impulse, translates by the average of
+ * the old and new velocities, and resets the force and impulse.
+ * Runs the kernel chosen by body_store_set_kernel(), or else the widest one
+ * the CPU supports.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_store_integrate(body_store_t *store, double dt);
+
+/**
+ * Advances the bodies at indices begin to end - 1 like body_store_integrate().
+ * Disjoint ranges can be integrated concurrently.
+ * Asserts that begin is a multiple of BODY_STORE_ALIGNMENT / sizeof(double),
+ * so the vector loads stay aligned, and that end is at most the store size.
+ *
+ * @param store a pointer to a store returned from body_store_init()
+ * @param begin the first index to advance
+ * @param end one past the last index to advance
+ * @param dt the number of seconds elapsed since the last tick
+ */
+void body_store_integrate_range(body_store_t *store, size_t begin, size_t end,
+  double dt);
+
+/**
+ * Checks whether this build and CPU can run an integration kernel.
+ *
+ * @param kernel the kernel
+ * @return whether body_store_integrate() can use it
+ */
+bool body_store_kernel_supported(body_store_kernel_t kernel);
+
+/**
+ * Gets the kernel body_store_integrate() runs.
+ *
+ * @return the kernel in use
+ */
+body_store_kernel_t body_store_get_kernel(void);
+
+/**
+ * Makes body_store_integrate() run a given kernel, e.g. to compare kernels.
+ * Should not be called while other threads are integrating.
+ * Asserts that the kernel is supported.
+ *
+ * @param kernel the kernel to run
+ */
+void body_store_set_kernel(body_store_kernel_t kernel);
+
+// Accessors for a body's slot; used by the body_t getters and setters.
+vector_t body_store_get_centroid(body_store_t *store, size_t index);
+vector_t body_store_get_velocity(body_store_t *store, size_t index);
+vector_t body_store_get_force(body_store_t *store, size_t index);
+vector_t body_store_get_impulse(body_store_t *store, size_t index);
+void body_store_set_centroid(body_store_t *store, size_t index, vector_t x);
+void body_store_set_velocity(body_store_t *store, size_t index, vector_t v);
+void body_store_set_force(body_store_t *store, size_t index, vector_t force);
+void body_store_set_impulse(body_store_t *store, size_t index,
+  vector_t impulse);
+void body_store_set_mass(body_store_t *store, size_t index, double mass);
+
+#endif // #ifndef __BODY_STORE_H__
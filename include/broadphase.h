@@ -0,0 +1,87 @@
+#ifndef __BROADPHASE_H__
+#define __BROADPHASE_H__
+
+#include <stddef.h>
+#include "aabb.h"
+#include "body.h"
+#include "list.h"
+
+/**
+ * Finds pairs of bodies whose bounding boxes overlap, so that only those
+ * pairs need an exact (narrowphase) collision test.
+ * A scene owns at most one broadphase; see scene_set_broadphase().
+ */
+typedef struct broadphase broadphase_t;
+
+/**
+ * A candidate pair of bodies produced by a broadphase.
+ * Each unordered pair is reported at most once per update.
+ */
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+} body_pair_t;
+
+/**
+ * Allocates a uniform-grid broadphase (a spatial hash of grid cells).
+ * Each update, every body is hashed into each cell its bounding box covers,
+ * and bodies sharing a cell are tested against each other.
+ * Works best when the cell size is close to the size of a typical body.
+ * Asserts that cell_size is positive.
+ *
+ * @param cell_size the width and height of a grid cell
+ * @return a pointer to the newly allocated broadphase
+ */
+broadphase_t *broadphase_init_grid(double cell_size);
+
+/**
+ * Allocates a dynamic AABB tree broadphase (see aabb_tree.h).
+ * Bodies are inserted with their boxes grown by margin, and are only moved
+ * in the tree once they leave that fattened box; bodies that disappear from
+ * the list passed to broadphase_update() are removed.
+ * Unlike the grid, it handles bodies of very different sizes gracefully.
+ * Produces the same candidate pairs as the grid (possibly in another order).
+ * Asserts that margin is non-negative.
+ *
+ * @param margin how far to fatten each body's box
+ * @return a pointer to the newly allocated broadphase
+ */
+broadphase_t *broadphase_init_tree(double margin);
+
+/**
+ * Releases the memory allocated for a broadphase.
+ * Does not free any bodies.
+ *
+ * @param bp a pointer to a broadphase returned from broadphase_init_grid()
+ *   or broadphase_init_tree()
+ */
+void broadphase_free(broadphase_t *bp);
+
+/**
+ * Brings the broadphase up to date with the current positions of some bodies
+ * and recomputes the candidate pairs.
+ * Bodies marked for removal are ignored.
+ *
+ * @param bp a pointer to a broadphase
+ * @param bodies the list of bodies to consider
+ */
+void broadphase_update(broadphase_t *bp, list_t *bodies);
+
+/**
+ * Gets the number of candidate pairs found by the last broadphase_update().
+ *
+ * @param bp a pointer to a broadphase
+ * @return the number of pairs
+ */
+size_t broadphase_pair_count(broadphase_t *bp);
+
+/**
+ * Gets the candidate pairs found by the last broadphase_update().
+ * The array is owned by the broadphase and is overwritten by the next update.
+ *
+ * @param bp a pointer to a broadphase
+ * @return an array of broadphase_pair_count() pairs
+ */
+body_pair_t *broadphase_pairs(broadphase_t *bp);
+
+#endif // #ifndef __BROADPHASE_H__
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "body.h"
+#include "shape.h"
 #include "vector.h"
 #include <math.h>
 
@@ -20,36 +21,226 @@ typedef struct {
      * If the shapes are colliding, the axis they are colliding on.
      * This is a unit vector pointing from the first shape towards the second.
      * Normal impulses are applied along this axis.
-     * If collided is false, this value is undefined.
+     * If collided is false, this is the direction distance was measured in
+     * when the narrowphase measures it, and undefined otherwise.
      */
     vector_t axis;
+    /**
+     * If the shapes are colliding, how far the second shape would have to
+     * move along axis to stop overlapping the first.
+     * If collided is false, this value is undefined.
+     */
+    double depth;
+    /**
+     * If the shapes are colliding, the number of contact points, 1 or 2.
+     * Two points are found when an edge of one shape lies against an edge
+     * of the other, and one when a corner pokes into an edge.
+     */
+    size_t contact_count;
+    /**
+     * If the shapes are colliding, the points of contact: the vertices of
+     * one shape, clipped to the edge of the other, that lie inside it.
+     * Only the first contact_count entries are defined.
+     */
+    vector_t contacts[2];
+    /**
+     * If the shapes are not colliding, the distance between them, when the
+     * narrowphase measures it (find_shape_collision_gjk() does, and the
+     * separating axis tests leave it 0).
+     */
+    double distance;
     // // /** Whether the two shapes collided before in previous tick */
     //  bool collided_last_tick;
 } collision_info_t;
 
+/**
+ * The algorithms a scene can use to test pairs of bodies for collisions
+ * (see scene_set_narrowphase()).
+ */
+typedef enum {
+  // separating axis test over the edge normals (find_shape_collision())
+  NARROWPHASE_SAT,
+  // GJK with EPA (find_shape_collision_gjk()), cheaper for shapes with
+  // many vertices
+  NARROWPHASE_GJK
+} narrowphase_t;
+
+/**
+ * A function called when a collision occurs.
+ * @param body1 the first body passed to create_collision()
+ * @param body2 the second body passed to create_collision()
+ * @param axis a unit vector pointing from body1 towards body2
+ *   that defines the direction the two bodies are colliding in
+ * @param aux the auxiliary value passed to create_collision()
+ */
+typedef void (*collision_handler_t)
+    (body_t *body1, body_t *body2, vector_t axis, void *aux);
+
 /**
  * Computes the status of the collision between two convex polygons.
+ * Concave polygons are treated as if they were their convex hulls;
+ * test bodies with find_body_collision() to handle them.
  * The shapes are given as lists of vertices in counterclockwise order.
  * There is an edge between each pair of consecutive vertices,
  * and one between the first vertex and the last vertex.
  *
  * @param shape1 the first shape
  * @param shape2 the second shape
- * @return whether the shapes are colliding, and if so, the collision axis.
- * The axis should be a unit vector pointing from shape1 towards shape2.
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * the penetration depth along it, and the contact points.
+ * The axis is the unit normal of least overlap, pointing from shape1
+ * towards shape2.
  */
 collision_info_t find_collision(list_t *shape1, list_t *shape2);
 
+/**
+ * Computes the status of the collision between two convex polygons
+ * stored as packed vertex arrays (see find_collision()).
+ * Reads the vertices in place and does not allocate.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * the penetration depth along it, and the contact points.
+ */
+collision_info_t find_shape_collision(const shape_t *shape1,
+  const shape_t *shape2);
+
+/**
+ * Fills in the contact points of a collision whose axis is already known,
+ * by clipping the edges of the shapes that face each other along it, as
+ * find_shape_collision() does.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param info a collision of shape1 with shape2; its contact points are
+ *   replaced
+ */
+void find_shape_contacts(const shape_t *shape1, const shape_t *shape2,
+  collision_info_t *info);
+
+/**
+ * Computes the status of the collision between two bodies' current shapes
+ * (see find_body_collision()), testing a remembered axis first.
+ * Pairs that stay apart usually stay apart along the same axis from one
+ * tick to the next, so if the remembered axis still separates the shapes,
+ * none of their edge normals need to be tested.
+ * Does not check the bounding circles and boxes; see bodies_may_collide().
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param narrowphase the test to run if the remembered axis does not
+ *   separate the bodies
+ * @param axis the axis to try first, or the zero vector to run the full
+ *   test; replaced by the axis that decided the full test (the separating
+ *   axis, or the collision axis if the bodies collide)
+ * @param hit set to whether the remembered axis separated the bodies
+ * @return whether the bodies are colliding, as find_shape_collision()
+ */
+collision_info_t find_body_collision_cached(body_t *body1, body_t *body2,
+  narrowphase_t narrowphase, vector_t *axis, bool *hit);
+
+/**
+ * Cheaply checks whether two bodies could be colliding, before any
+ * separating axis test: first whether their bounding circles (see
+ * body_get_radius()) overlap, which needs only the centroids, and then
+ * whether their bounding boxes (see body_get_aabb()) overlap.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return false if the bodies are certainly apart
+ */
+bool bodies_may_collide(body_t *body1, body_t *body2);
+
+/**
+ * Computes the status of the collision between two bodies' current shapes
+ * (see find_shape_collision()), rejecting distant pairs with
+ * bodies_may_collide() first. Only tests the bodies' unique edge normals
+ * (see body_get_normals()), so parallel edges are projected onto once.
+ * Concave bodies are tested as their convex pieces (see body_get_piece()),
+ * and collide along the deepest of their pieces' collisions; pieces whose
+ * bounding boxes do not overlap the other body's are skipped.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @return whether the bodies are colliding, as find_shape_collision()
+ */
+collision_info_t find_body_collision(body_t *body1, body_t *body2);
+
+/**
+ * Turns the separating axis test's kernels specialized per vertex-count
+ * pair on or off, e.g. to compare them with the generic test. They are on
+ * by default, for polygons of up to SAT_KERNEL_MAX_VERTICES vertices (a
+ * build setting, 6 unless overridden), and give exactly the same results
+ * as the generic test.
+ * Should not be called while other threads are testing collisions.
+ *
+ * @param enabled whether to use the kernels
+ */
+void collision_set_sat_kernels(bool enabled);
+
+/**
+ * How far find_time_of_impact() lets bodies overlap before calling it an
+ * impact, so the collision test that follows sees them touching.
+ */
+extern const double TOI_SLOP;
+
+/**
+ * Finds how far body1 can move by displacement from its current position,
+ * with body2 standing still, before it overlaps body2 by TOI_SLOP
+ * (a swept separating axis test over both bodies' edge normals).
+ * Concave bodies are swept piece by piece (see body_get_piece()).
+ * Bodies that already overlap at the start are left to find_body_collision(),
+ * so this never stops a body that is resting on another.
+ *
+ * @param body1 the moving body
+ * @param displacement how far body1 moves
+ * @param body2 the body standing still
+ * @return the fraction of displacement body1 can move, in (0, 1], or 1.0
+ *   if it can make the whole move
+ */
+double find_time_of_impact(body_t *body1, vector_t displacement,
+  body_t *body2);
+
+/**
+ * Returns the smaller of two values.
+ */
 double find_min(double first, double second);
 
-vector_t *edge_perp(vector_t vec);
+/**
+ * Computes a vector perpendicular to the given edge.
+ * The result is not normalized.
+ *
+ * @param vec the edge vector
+ * @return vec rotated by 90 degrees counterclockwise
+ */
+vector_t edge_perp(vector_t vec);
 
-list_t *get_axes1(list_t *shape);
+/**
+ * Projects every vertex of a shape onto a line in a single pass.
+ * Does not allocate.
+ *
+ * @param shape the list of vertices of the shape
+ * @param line the direction to project onto (need not be normalized)
+ * @param min set to the smallest projection
+ * @param max set to the largest projection
+ */
+void polygon_proj(list_t *shape, vector_t line, double *min, double *max);
 
-list_t *get_axes2(list_t *shape1, list_t *shape2);
+/**
+ * Projects every vertex of a packed shape onto a line in a single pass.
+ * See polygon_proj().
+ */
+void shape_proj(const shape_t *shape, vector_t line, double *min, double *max);
 
+/**
+ * Returns the smallest projection of the shape's vertices onto a line.
+ */
 double polygon_proj_min(list_t *shape, vector_t line);
 
+/**
+ * Returns the largest projection of the shape's vertices onto a line.
+ */
 double polygon_proj_max(list_t *shape, vector_t line);
 
 #endif // #ifndef __COLLISION_H__
@@ -0,0 +1,91 @@
+#ifndef __CONTACT_SOLVER_H__
+#define __CONTACT_SOLVER_H__
+
+#include <stddef.h>
+#include "body.h"
+#include "collision.h"
+
+/**
+ * A sequential-impulse solver for the contacts found in one tick.
+ * Each contact is a non-penetration constraint along its collision axis.
+ * The solver sweeps over the contacts a fixed number of times, each time
+ * correcting the relative normal velocity of one pair at a time, and keeps
+ * the total normal impulse of every contact non-negative, so contacts can
+ * push but never pull. Overlap beyond a small slop is removed over several
+ * ticks by asking for a little extra separating velocity (Baumgarte
+ * stabilization). The final impulses are applied with body_add_impulse(),
+ * so body_tick() moves the bodies with the solved velocities.
+ */
+typedef struct contact_solver contact_solver_t;
+
+/**
+ * Allocates a contact solver with no contacts.
+ * Asserts that iterations is positive.
+ *
+ * @param iterations the number of sweeps over the contacts per solve
+ * @return a pointer to the newly allocated solver
+ */
+contact_solver_t *contact_solver_init(size_t iterations);
+
+/**
+ * Releases the memory allocated for a contact solver.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ */
+void contact_solver_free(contact_solver_t *solver);
+
+/**
+ * Changes the number of sweeps over the contacts per solve.
+ * More sweeps let impulses travel further through stacks.
+ * Asserts that iterations is positive.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param iterations the number of sweeps
+ */
+void contact_solver_set_iterations(contact_solver_t *solver,
+  size_t iterations);
+
+/**
+ * Changes how overlapping bodies are pushed apart.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param bias the fraction of the overlap to remove per tick, from 0 to 1
+ * @param slop how much overlap is left alone, so resting contacts stay
+ *   in contact instead of jittering
+ */
+void contact_solver_set_correction(contact_solver_t *solver, double bias,
+  double slop);
+
+/**
+ * Adds a contact to solve at the next contact_solver_solve().
+ * Contacts between two bodies of infinite mass are ignored.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param info the collision of body1 with body2 (see find_shape_collision())
+ * @param elasticity the coefficient of restitution, 0 for no bounce
+ */
+void contact_solver_add(contact_solver_t *solver, body_t *body1,
+  body_t *body2, collision_info_t info, double elasticity);
+
+/**
+ * Gets the number of contacts waiting to be solved.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @return the number of contacts added since the last solve
+ */
+size_t contact_solver_count(contact_solver_t *solver);
+
+/**
+ * Solves the contacts added since the last solve and applies the resulting
+ * impulses to their bodies, then forgets the contacts.
+ * Must be called after the forces of the tick have been applied, since the
+ * velocities being constrained include them.
+ *
+ * @param solver a pointer to a solver returned from contact_solver_init()
+ * @param dt the length of the tick the bodies are about to be moved by
+ */
+void contact_solver_solve(contact_solver_t *solver, double dt);
+
+#endif // #ifndef __CONTACT_SOLVER_H__
@@ -0,0 +1,267 @@
+#ifndef __FORCE_RECORDS_H__
+#define __FORCE_RECORDS_H__
+
+#include <stddef.h>
+#include "body.h"
+#include "collision.h"
+#include "contact_solver.h"
+#include "list.h"
+
+/**
+ * Distance below which gravity is not applied, because its magnitude
+ * blows up as two bodies get close.
+ */
+extern const double MIN_DIST;
+
+/**
+ * The kinds of force a scene can hold.
+ * FORCE_CALLBACK forces are arbitrary force_creator_t functions; every other
+ * kind is stored as a typed record in a force_records_t.
+ */
+typedef enum {
+  FORCE_CALLBACK,
+  FORCE_UNIFORM_GRAVITY,
+  FORCE_NEWTONIAN_GRAVITY,
+  FORCE_SPRING,
+  FORCE_DRAG,
+  FORCE_COLLISION
+} force_kind_t;
+
+/**
+ * Per-kind contiguous arrays of typed force records.
+ * force_records_apply() evaluates each kind in its own loop with direct calls,
+ * instead of one indirect call and one heap aux per force.
+ */
+typedef struct force_records force_records_t;
+
+/**
+ * Allocates memory for an empty set of force records.
+ * Asserts that the required memory was allocated.
+ *
+ * @return a pointer to the newly allocated records
+ */
+force_records_t *force_records_init(void);
+
+/**
+ * Releases the memory allocated for a set of force records,
+ * calling the freer of every remaining collision record on its aux.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ */
+void force_records_free(force_records_t *records);
+
+/**
+ * Adds a gravity, spring or drag record.
+ * Records move when others are removed; *slot is kept up to date with the
+ * record's current index so its owner can remove it later.
+ * Asserts that kind is not FORCE_CALLBACK or FORCE_COLLISION.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param kind the kind of force
+ * @param constant g, G, k or gamma, depending on the kind
+ * @param body1 the first body
+ * @param body2 the second body, or NULL for drag
+ * @param slot where to keep the index of the record
+ */
+void force_records_add(force_records_t *records, force_kind_t kind,
+  double constant, body_t *body1, body_t *body2, size_t *slot);
+
+/**
+ * Adds a collision record, which calls handler each tick the bodies collide
+ * and then stops body1, like collision_creator() does.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler a function to call whenever the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ * @param slot where to keep the index of the record
+ */
+void force_records_add_collision(force_records_t *records, body_t *body1,
+  body_t *body2, collision_handler_t handler, void *aux, free_func_t freer,
+  size_t *slot);
+
+/**
+ * Adds a contact record, a collision record without a handler that hands
+ * the bodies' contact to a contact solver each tick they collide.
+ * Removed like any other FORCE_COLLISION record.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param elasticity the coefficient of restitution of the contact
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param slot where to keep the index of the record
+ */
+void force_records_add_contact(force_records_t *records, double elasticity,
+  body_t *body1, body_t *body2, size_t *slot);
+
+/**
+ * Chooses the test contact records run on their bodies each tick.
+ * Records with handlers always use find_body_collision().
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param narrowphase the test to use, NARROWPHASE_SAT until this is called
+ */
+void force_records_set_narrowphase(force_records_t *records,
+  narrowphase_t narrowphase);
+
+/**
+ * Checks whether the bodies of a collision record collided the last time
+ * the record ran. Records skipped because both bodies were asleep keep
+ * their previous answer.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param index the index of a FORCE_COLLISION record, as kept in its slot
+ * @return whether the record's bodies were touching
+ */
+bool force_records_collision_touching(force_records_t *records,
+  size_t index);
+
+/**
+ * Removes the record at a given index by moving the last record of the same
+ * kind into its place, freeing a collision record's aux.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param kind the kind of the record
+ * @param index the index of the record, as kept in its slot
+ */
+void force_records_remove(force_records_t *records, force_kind_t kind,
+  size_t index);
+
+/**
+ * Gets the number of records of a given kind.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param kind a kind other than FORCE_CALLBACK
+ * @return the number of records of that kind
+ */
+size_t force_records_count(force_records_t *records, force_kind_t kind);
+
+/**
+ * Applies every record: uniform gravity, Newtonian gravity, springs and drag
+ * add their forces, and then collision records run their handlers or add
+ * their contacts to a solver.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param solver the solver to add contacts to
+ */
+void force_records_apply(force_records_t *records,
+  contact_solver_t *solver);
+
+/**
+ * Gets the number of gravity, spring and drag records, which
+ * force_records_accumulate() numbers from 0 in the order they are applied.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @return the number of records other than collisions
+ */
+size_t force_records_body_force_count(force_records_t *records);
+
+/**
+ * Adds the forces of the gravity, spring and drag records from begin to
+ * end - 1 into forces, indexed by each body's scene_index, instead of into
+ * the bodies themselves. Only reads the bodies, so disjoint ranges can be
+ * accumulated concurrently into different arrays.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param begin the first record to accumulate
+ * @param end one past the last record to accumulate
+ * @param forces the array to add each body's force to
+ */
+void force_records_accumulate(force_records_t *records, size_t begin,
+  size_t end, vector_t *forces);
+
+/**
+ * Writes the forces of the gravity, spring and drag records from begin to
+ * end - 1 into fixed slots: record r puts its force on its first body in
+ * contributions[2 * r] and on its second body in contributions[2 * r + 1].
+ * Unused slots are zero. Adding each body's slots to it in increasing order
+ * then gives the same result however the records were split among threads.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param begin the first record to evaluate
+ * @param end one past the last record to evaluate
+ * @param contributions an array of 2 * force_records_body_force_count()
+ *   forces
+ */
+void force_records_contribute(force_records_t *records, size_t begin,
+  size_t end, vector_t *contributions);
+
+/**
+ * Writes which body each slot of force_records_contribute() belongs to,
+ * or NULL for slots that never hold a force.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param bodies an array of 2 * force_records_body_force_count() bodies
+ */
+void force_records_contribution_bodies(force_records_t *records,
+  body_t **bodies);
+
+/**
+ * Checks whether a kind of force also pushes on its second body,
+ * as Newtonian gravity and springs do.
+ *
+ * @param kind the kind of force
+ * @return whether the force acts on both of its bodies
+ */
+bool force_kind_acts_on_body2(force_kind_t kind);
+
+/**
+ * Runs the collision records, as the end of force_records_apply() does.
+ * Records whose bodies are both asleep are skipped.
+ *
+ * @param records a pointer to records returned from force_records_init()
+ * @param solver the solver to add the contacts of contact records to
+ */
+void force_records_apply_collisions(force_records_t *records,
+  contact_solver_t *solver);
+
+/**
+ * Adds the uniform gravity force (0, -g * mass) to a body.
+ *
+ * @param g the gravitational acceleration
+ * @param body the body to pull down
+ */
+void force_apply_uniform_gravity(double g, body_t *body);
+
+/**
+ * Adds the Newtonian gravity between two bodies to both of them,
+ * unless they are within MIN_DIST of each other.
+ *
+ * @param G the gravitational constant
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void force_apply_newtonian_gravity(double G, body_t *body1, body_t *body2);
+
+/**
+ * Adds a Hooke's-law spring force between two bodies to both of them.
+ *
+ * @param k the spring constant
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void force_apply_spring(double k, body_t *body1, body_t *body2);
+
+/**
+ * Adds a drag force proportional and opposite to a body's velocity.
+ *
+ * @param gamma the drag constant
+ * @param body the body to slow down
+ */
+void force_apply_drag(double gamma, body_t *body);
+
+/**
+ * Calls handler if two bodies collide, and then stops body1.
+ *
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler a function to call if the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @return whether the bodies collided
+ */
+bool force_apply_collision(body_t *body1, body_t *body2,
+  collision_handler_t handler, void *aux);
+
+#endif // #ifndef __FORCE_RECORDS_H__
@@ -4,17 +4,6 @@
 #include "scene.h"
 #include "collision.h"
 
-/**
- * A function called when a collision occurs.
- * @param body1 the first body passed to create_collision()
- * @param body2 the second body passed to create_collision()
- * @param axis a unit vector pointing from body1 towards body2
- *   that defines the direction the two bodies are colliding in
- * @param aux the auxiliary value passed to create_collision()
- */
-typedef void (*collision_handler_t)
-    (body_t *body1, body_t *body2, vector_t axis, void *aux);
-
 /**
  * Structure to store miscellaneous information about bodies to which a force
  * is applied and constant for the force
@@ -201,15 +190,13 @@ void create_collision(
 void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2);
 
 /**
- * Adds a force creator to a scene that applies impulses
+ * Adds a force to a scene that applies impulses
  * to resolve collisions between two bodies in the scene.
- * This should be represented as an on-collision callback
- * registered with create_collision().
- *
- * You may remember from project01 that you should avoid applying impulses
- * multiple times while the bodies are still colliding.
- * You should also have a special case that allows either body1 or body2
- * to have mass INFINITY, as this is useful for simulating walls.
+ * The contact is resolved by the scene's contact solver together with all
+ * other contacts of the tick (see scene_add_contact_force()), so resting
+ * bodies stay in contact instead of being stopped and released.
+ * Either body1 or body2 may have mass INFINITY, which is useful for
+ * simulating walls.
  *
  * @param scene the scene containing the bodies
  * @param elasticity the "coefficient of restitution" of the collision;
@@ -224,4 +211,23 @@ void create_physics_collision(
     body_t *body2
 );
 
+/**
+ * Adds a collision rule to a scene that resolves collisions between every
+ * body in categories1 and every body in categories2 with the contact
+ * solver, like create_physics_collision() does for a single pair.
+ * Candidate pairs come from the scene's broadphase, so nothing has to be
+ * registered per pair.
+ *
+ * @param scene the scene containing the bodies
+ * @param elasticity the "coefficient of restitution" of the collisions
+ * @param categories1 category bits of the first body of each pair
+ * @param categories2 category bits of the second body of each pair
+ */
+void create_physics_collision_rule(
+    scene_t *scene,
+    double elasticity,
+    unsigned int categories1,
+    unsigned int categories2
+);
+
 #endif // #ifndef __FORCES_H__
@@ -0,0 +1,32 @@
+#ifndef __GJK_H__
+#define __GJK_H__
+
+#include "collision.h"
+#include "shape.h"
+#include "vector.h"
+
+/**
+ * Computes the status of the collision between two packed convex polygons
+ * with GJK, and their penetration with EPA if they overlap.
+ * Both only ever ask a shape for its support point (its furthest vertex in
+ * some direction), so the cost grows with the vertex counts times a small
+ * number of iterations, rather than with their product as in SAT.
+ * Unlike find_shape_collision(), this also measures how far apart shapes
+ * that do not collide are.
+ * Shapes that only touch are handed to find_shape_collision(), which gives
+ * them a well-defined axis.
+ *
+ * @param shape1 the first shape
+ * @param shape2 the second shape
+ * @param direction a guess at the direction from shape1 towards shape2,
+ *   such as last tick's axis, or the zero vector to start from their first
+ *   vertices
+ * @return whether the shapes are colliding, and if so, the collision axis,
+ * the penetration depth along it, and the contact points, as
+ * find_shape_collision() would compute them; if not, the distance between
+ * the shapes and the direction in which it was measured
+ */
+collision_info_t find_shape_collision_gjk(const shape_t *shape1,
+  const shape_t *shape2, vector_t direction);
+
+#endif // #ifndef __GJK_H__
@@ -0,0 +1,69 @@
+#ifndef __JOB_POOL_H__
+#define __JOB_POOL_H__
+
+#include <stddef.h>
+
+/**
+ * A fixed set of worker threads that run data-parallel loops.
+ * The items of a loop are cut into chunks and spread over one deque per
+ * thread; a thread that runs out of chunks steals half of the remaining
+ * chunks of another thread, so uneven chunks still balance out.
+ * A pool runs one loop at a time and must only be used from one thread.
+ */
+typedef struct job_pool job_pool_t;
+
+/**
+ * A function that processes the items from begin to end - 1 of a loop.
+ *
+ * @param aux the auxiliary value passed to job_pool_parallel_for()
+ * @param begin the first item to process
+ * @param end one past the last item to process
+ * @param worker the index of the thread running the chunk, less than
+ *   job_pool_threads(); useful for indexing per-thread scratch space
+ */
+typedef void (*job_func_t)(void *aux, size_t begin, size_t end,
+  size_t worker);
+
+/**
+ * Allocates a pool and starts thread_count - 1 worker threads;
+ * the calling thread takes part in every loop as worker 0.
+ * Asserts that thread_count is positive and that the threads started.
+ *
+ * @param thread_count the number of threads that run each loop
+ * @return a pointer to the newly allocated pool
+ */
+job_pool_t *job_pool_init(size_t thread_count);
+
+/**
+ * Stops the worker threads and releases the memory allocated for a pool.
+ *
+ * @param pool a pointer to a pool returned from job_pool_init()
+ */
+void job_pool_free(job_pool_t *pool);
+
+/**
+ * Gets the number of threads that run each loop, including the caller.
+ *
+ * @param pool a pointer to a pool returned from job_pool_init(), or NULL
+ * @return the number of threads, or 1 if pool is NULL
+ */
+size_t job_pool_threads(job_pool_t *pool);
+
+/**
+ * Calls func on chunks of at most grain items covering 0 to count - 1,
+ * spread over the pool's threads, and returns once every chunk is done.
+ * Every chunk starts at a multiple of grain.
+ * If pool is NULL, or there is only one chunk, func runs once on the whole
+ * range in the calling thread as worker 0.
+ * Asserts that grain is positive.
+ *
+ * @param pool a pointer to a pool returned from job_pool_init(), or NULL
+ * @param count the number of items
+ * @param grain the number of items per chunk
+ * @param func the function to run on each chunk
+ * @param aux an auxiliary value to pass to func
+ */
+void job_pool_parallel_for(job_pool_t *pool, size_t count, size_t grain,
+  job_func_t func, void *aux);
+
+#endif // #ifndef __JOB_POOL_H__
@@ -22,6 +22,12 @@ typedef void (*free_func_t)(void *);
  */
 typedef bool (*equality_func_t)(void *, void *);
 
+/**
+ * A function that decides whether a list element should be removed.
+ * It is passed the element and the auxiliary value given to list_remove_if().
+ */
+typedef bool (*predicate_func_t)(void *, void *);
+
 /**
  * Allocates memory for a new list with space for the given number of elements.
  * The list is initially empty.
@@ -70,6 +76,20 @@ void *list_get(list_t *list, size_t index);
  */
 void *list_remove(list_t *list, size_t index);
 
+/**
+ * Removes every element for which should_remove returns true in a single
+ * pass, moving the remaining elements towards the start of the list
+ * without changing their order.
+ * should_remove is called exactly once on each element, in order, so it may
+ * release an element it decides to remove; removed elements are not freed.
+ *
+ * @param list a pointer to a list returned from list_init()
+ * @param should_remove a function deciding which elements to remove
+ * @param aux an auxiliary value to pass to should_remove
+ * @return the number of elements removed
+ */
+size_t list_remove_if(list_t *list, predicate_func_t should_remove, void *aux);
+
 /**
  * Appends an element to the end of a list.
  * If the list is filled to capacity, resizes the list to fit more elements
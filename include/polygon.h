@@ -1,7 +1,9 @@
 #ifndef __POLYGON_H__
 #define __POLYGON_H__
 
+#include <stdbool.h>
 #include "list.h"
+#include "shape.h"
 #include "vector.h"
 
 /**
@@ -46,4 +48,133 @@ void polygon_translate(list_t *polygon, vector_t translation);
  */
 void polygon_rotate(list_t *polygon, double angle, vector_t point);
 
+/**
+ * Computes the area of a polygon stored as a packed vertex array.
+ * Equivalent to polygon_area().
+ *
+ * @param shape the vertices of the polygon, listed counterclockwise
+ * @return the area of the polygon
+ */
+double shape_area(const shape_t *shape);
+
+/**
+ * Computes the center of mass of a polygon stored as a packed vertex array.
+ * Equivalent to polygon_centroid().
+ *
+ * @param shape the vertices of the polygon, listed counterclockwise
+ * @return the centroid of the polygon
+ */
+vector_t shape_centroid(const shape_t *shape);
+
+/**
+ * Computes the distance from a point to the furthest vertex of a packed
+ * polygon, i.e. the radius of the smallest circle about the point that
+ * contains the polygon.
+ *
+ * @param shape the vertices of the polygon
+ * @param center the center of the circle
+ * @return the largest distance from center to a vertex
+ */
+double shape_radius(const shape_t *shape, vector_t center);
+
+/**
+ * Computes the unit normals of a packed polygon's edges, keeping only one
+ * normal for each set of parallel edges: a rectangle has two, a regular
+ * hexagon three. These are the only axes a separating axis test needs.
+ *
+ * @param shape the vertices of the polygon
+ * @param normals an empty initialized shape (used as an array of vectors)
+ *   to add the normals to, in the order of the edges they first appear on;
+ *   their signs are unspecified
+ */
+void shape_unique_normals(const shape_t *shape, shape_t *normals);
+
+/**
+ * Checks whether a packed polygon is convex, i.e. whether all of its turns
+ * are in the same direction. Straight angles count as either.
+ *
+ * @param shape the vertices of the polygon, in either order
+ * @return whether the polygon is convex
+ */
+bool shape_is_convex(const shape_t *shape);
+
+/**
+ * Splits a simple (not self-intersecting) polygon into convex pieces.
+ * The polygon is triangulated by ear clipping, and neighbouring pieces are
+ * then merged for as long as the result stays convex (Hertel-Mehlhorn),
+ * which gives at most four times the fewest possible pieces.
+ *
+ * @param shape the vertices of the polygon, in either order
+ * @param count set to the number of pieces
+ * @return a newly allocated array of count initialized shapes, listed
+ *   counterclockwise, which together cover the polygon; release each with
+ *   shape_release() and then free the array
+ */
+shape_t *shape_decompose(const shape_t *shape, size_t *count);
+
+/**
+ * Checks whether a point lies inside a packed polygon, convex or not.
+ *
+ * @param shape the vertices of the polygon, in either order
+ * @param point the point to check
+ * @return whether the point is inside the polygon
+ */
+bool shape_contains(const shape_t *shape, vector_t point);
+
+/**
+ * Computes the distance from a point to a packed polygon, convex or not.
+ *
+ * @param shape the vertices of the polygon, in either order
+ * @param point the point to measure from
+ * @return the distance to the nearest edge, or 0 if the point is inside
+ */
+double shape_distance(const shape_t *shape, vector_t point);
+
+/**
+ * Finds where a segment from origin to origin + translation first meets
+ * a packed polygon, convex or not.
+ *
+ * @param shape the vertices of the polygon, in either order
+ * @param origin the start of the segment
+ * @param translation the segment's direction and length
+ * @param fraction set to how far along the segment the first hit is,
+ *   from 0 to 1, or 0 if origin is inside the polygon
+ * @return whether the segment meets the polygon
+ */
+bool shape_ray_cast(const shape_t *shape, vector_t origin,
+  vector_t translation, double *fraction);
+
+/**
+ * Translates all vertices in a packed polygon by a given vector.
+ * Note: mutates the original shape.
+ *
+ * @param shape the vertices of the polygon
+ * @param translation the vector to add to each vertex's position
+ */
+void shape_translate(shape_t *shape, vector_t translation);
+
+/**
+ * Rotates vertices in a packed polygon by a given angle about a given point.
+ * Note: mutates the original shape.
+ *
+ * @param shape the vertices of the polygon
+ * @param angle the angle to rotate the polygon, in radians.
+ * A positive angle means counterclockwise.
+ * @param point the point to rotate around
+ */
+void shape_rotate(shape_t *shape, double angle, vector_t point);
+
+/**
+ * Writes a rotated and translated copy of a packed polygon into dest.
+ * Each vertex v of src becomes translation + (v rotated by angle about 0).
+ * dest must be initialized and must not be src.
+ *
+ * @param dest the shape to overwrite with the transformed vertices
+ * @param src the vertices to transform
+ * @param translation the vector to add after rotating
+ * @param angle the angle to rotate by, in radians, counterclockwise
+ */
+void shape_transform(shape_t *dest, const shape_t *src, vector_t translation,
+  double angle);
+
 #endif // #ifndef __POLYGON_H__
@@ -0,0 +1,62 @@
+#ifndef __PROJECTION_H__
+#define __PROJECTION_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "vector.h"
+
+/**
+ * The implementations of project_points(). The SIMD ones project a point
+ * onto 2 (SSE2) or 4 (AVX2) axes with each instruction, and give exactly
+ * the same results as the scalar one.
+ */
+typedef enum {
+  PROJECTION_SCALAR,
+  PROJECTION_SSE2,
+  PROJECTION_AVX2
+} projection_kernel_t;
+
+/**
+ * Projects points onto several axes at once, finding the smallest and
+ * largest dot product of any point with each axis.
+ * Runs the kernel chosen by projection_set_kernel(), or else the widest
+ * one the CPU supports.
+ * Asserts that there is at least one point.
+ *
+ * @param points the points to project
+ * @param n the number of points
+ * @param axes the axes to project onto; they need not be normalized
+ * @param axis_count the number of axes
+ * @param mins an array of axis_count values; mins[i] is set to the
+ *   smallest projection onto axes[i]
+ * @param maxes an array of axis_count values; maxes[i] is set to the
+ *   largest projection onto axes[i]
+ */
+void project_points(const vector_t *points, size_t n, const vector_t *axes,
+  size_t axis_count, double *mins, double *maxes);
+
+/**
+ * Checks whether this build and CPU can run a kernel.
+ *
+ * @param kernel the kernel
+ * @return whether project_points() can use it
+ */
+bool projection_kernel_supported(projection_kernel_t kernel);
+
+/**
+ * Gets the kernel project_points() runs.
+ *
+ * @return the kernel in use
+ */
+projection_kernel_t projection_get_kernel(void);
+
+/**
+ * Makes project_points() run a given kernel, e.g. to compare kernels.
+ * Should not be called while other threads are projecting.
+ * Asserts that the kernel is supported.
+ *
+ * @param kernel the kernel to run
+ */
+void projection_set_kernel(projection_kernel_t kernel);
+
+#endif // #ifndef __PROJECTION_H__
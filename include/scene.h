@@ -1,7 +1,12 @@
 #ifndef __SCENE_H__
 #define __SCENE_H__
 
+#include "aabb.h"
+#include "barnes_hut.h"
 #include "body.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "force_records.h"
 #include "list.h"
 
 /**
@@ -24,6 +29,39 @@ typedef struct force force_t;
  */
 typedef void (*force_creator_t)(void *aux);
 
+/**
+ * What the last scene_tick() did, and what sleeping saved it
+ * (see scene_set_sleeping()).
+ */
+typedef struct {
+  // bodies in the scene, and how many of them are asleep
+  size_t bodies;
+  size_t asleep;
+  double percent_asleep;
+  // groups of bodies linked by contacts and forces, or 0 without sleeping
+  size_t islands;
+  // bodies integrated, and bodies skipped because they were asleep
+  size_t integrated;
+  size_t integrations_skipped;
+  // broadphase pairs covered by a rule that went through the narrowphase,
+  // and those skipped because both bodies were asleep
+  size_t pairs_tested;
+  size_t pairs_skipped;
+  // tested pairs told apart by their bounding circles or boxes alone
+  size_t bounds_rejected;
+  // tested pairs that the axis remembered from the last tick showed to be
+  // apart, and those that needed the full separating axis test
+  size_t axis_cache_hits;
+  size_t axis_cache_misses;
+  // bullets whose moves were swept (see body_set_bullet()), and those
+  // stopped short where they first hit a body
+  size_t bullets_swept;
+  size_t bullets_stopped;
+  // bodies whose boxes overlapped a bullet's sweep, and so were tested for
+  // the time of impact
+  size_t bullet_candidates;
+} scene_stats_t;
+
 /**
  * Allocates memory for a force.
  * Asserts that the required memory is successfully allocated.
@@ -129,6 +167,18 @@ void scene_add_score(scene_t *scene, int to_add);
 
 void scene_add_body(scene_t *scene, body_t *body);
 
+/**
+ * Turns the scene's structure-of-arrays body store on or off.
+ * While it is on, every body's position, velocity, force, impulse and mass
+ * live in parallel aligned arrays (see body_store.h) and scene_tick()
+ * integrates them all in one vectorized loop instead of calling body_tick()
+ * on each body. The body_t accessors keep working either way.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param enabled whether bodies should be kept in the store
+ */
+void scene_use_body_store(scene_t *scene, bool enabled);
+
 /**
  * @deprecated Use body_remove() instead
  *
@@ -163,6 +213,8 @@ void scene_add_force_creator(
 /**
  * Adds a force creator to a scene,
  * to be invoked every time scene_tick() is called.
+ * Force creators run in the order they were added, before any typed forces.
+ * Prefer scene_add_typed_force() for the built-in kinds of force.
  * The auxiliary value is passed to the force creator each time it is called.
  * The force creator is registered with a list of bodies it applies to,
  * so it can be removed when any one of the bodies is removed.
@@ -183,9 +235,330 @@ void scene_add_bodies_force_creator(
     free_func_t freer
 );
 
+/**
+ * Adds a gravity, spring or drag force to a scene as a typed record
+ * (see force_records.h). Records of each kind are evaluated together in
+ * scene_tick(), after the force creators and before collision forces.
+ * The force is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param kind FORCE_UNIFORM_GRAVITY, FORCE_NEWTONIAN_GRAVITY, FORCE_SPRING
+ *   or FORCE_DRAG
+ * @param constant g, G, k or gamma, depending on the kind
+ * @param body1 the first body
+ * @param body2 the second body, or NULL for drag
+ */
+void scene_add_typed_force(scene_t *scene, force_kind_t kind, double constant,
+  body_t *body1, body_t *body2);
+
+/**
+ * Adds a collision force to a scene as a typed record. Each tick in which
+ * the bodies collide, handler is called and body1 is stopped.
+ * Collision records run after every other force.
+ * The force is removed when either body is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param body1 the first body
+ * @param body2 the second body
+ * @param handler a function to call whenever the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_collision_force(scene_t *scene, body_t *body1, body_t *body2,
+  collision_handler_t handler, void *aux, free_func_t freer);
+
+/**
+ * Adds a contact force to a scene: each tick in which the bodies collide,
+ * their contact is resolved by the scene's contact solver (see
+ * contact_solver.h) together with every other contact of the tick.
+ * Runs with the collision forces. The force is removed when either body
+ * is removed.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param elasticity the coefficient of restitution, 0 for no bounce
+ * @param body1 the first body
+ * @param body2 the second body
+ */
+void scene_add_contact_force(scene_t *scene, double elasticity,
+  body_t *body1, body_t *body2);
+
+/**
+ * Sets how many times per tick the contact solver sweeps over the contacts.
+ * Tall stacks need more sweeps to settle; the default is 10.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param iterations the number of sweeps, at least 1
+ */
+void scene_set_solver_iterations(scene_t *scene, size_t iterations);
+
+/**
+ * Sets how the contact solver pushes overlapping bodies apart
+ * (see contact_solver_set_correction()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param bias the fraction of the overlap to remove per tick, from 0 to 1
+ * @param slop how much overlap is left alone
+ */
+void scene_set_position_correction(scene_t *scene, double bias,
+  double slop);
+
+/**
+ * Sets how many threads scene_tick() uses, including the calling thread.
+ * With more than one, a work-stealing job pool (see job_pool.h) evaluates
+ * the gravity field, the gravity, spring and drag forces, the narrowphase
+ * of the collision rules, and the integration in parallel. Force creators,
+ * collision handlers and force removal still run on the calling thread,
+ * in the same order as with one thread. Summing per-thread forces can round
+ * differently from the single-threaded order.
+ * Every body a typed force acts on must have been added to the scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param threads the number of threads; 1 runs everything on the caller
+ */
+void scene_set_threads(scene_t *scene, size_t threads);
+
+/**
+ * Makes a threaded scene_tick() sum the gravity, spring and drag forces on
+ * each body in a fixed order that does not depend on the number of threads
+ * or on how the work was split, so a scene ends up in bit-identical states
+ * on any number of threads, and in the same state as with one thread.
+ * Each typed force writes its contribution to a fixed slot, and each body
+ * then adds up its own slots in creation order. This costs two vectors of
+ * scratch space per typed force, and an index that is rebuilt whenever
+ * bodies or typed forces are added or removed. Every other threaded phase
+ * is already deterministic.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param deterministic whether forces should be summed in a fixed order
+ */
+void scene_set_deterministic(scene_t *scene, bool deterministic);
+
+/**
+ * Turns automatic sleeping on or off. With sleeping on, scene_tick() tracks
+ * islands of bodies linked by contacts from the collision rules and by
+ * forces that act on both of their bodies. Once every body of an island has
+ * moved slowly for long enough (see scene_set_sleep_thresholds()), the whole
+ * island is put to sleep (see body_set_asleep()); as soon as one of its
+ * bodies moves, is removed, or touches a moving body, the whole island wakes.
+ * Bodies with infinite mass never link islands. Adding a force to a scene
+ * wakes the bodies it acts on. Turning sleeping off wakes every body.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param sleeping whether resting bodies should be put to sleep
+ */
+void scene_set_sleeping(scene_t *scene, bool sleeping);
+
+/**
+ * Sets when a body counts as resting: while its speed, before and after
+ * the tick, is at most speed, and the change in its velocity over the tick,
+ * from forces and impulses alike, is at most acceleration * dt.
+ * An island falls asleep after all of its bodies have rested for time.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param speed the highest speed of a resting body
+ * @param acceleration the highest acceleration of a resting body
+ * @param time the number of seconds an island must rest before sleeping
+ */
+void scene_set_sleep_thresholds(scene_t *scene, double speed,
+  double acceleration, double time);
+
+/**
+ * Gets the statistics of the last scene_tick().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @return what the last tick did
+ */
+scene_stats_t scene_get_stats(scene_t *scene);
+
+/**
+ * Replaces the gravity field that pulls every body in a scene towards every
+ * other, evaluated each tick after the force creators and before the typed
+ * forces. Use this instead of create_newtonian_gravity() on every pair.
+ * The scene takes ownership and frees the old gravity field.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param field a gravity field from barnes_hut_init(), or NULL for none
+ */
+void scene_set_gravity_field(scene_t *scene, barnes_hut_t *field);
+
+/**
+ * Replaces the broadphase a scene uses to find candidate pairs for its
+ * collision rules. The scene takes ownership and frees the old broadphase.
+ * If a rule is added before any broadphase is set, a uniform grid is used.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param broadphase a broadphase, e.g. from broadphase_init_grid() or
+ *   broadphase_init_tree()
+ */
+void scene_set_broadphase(scene_t *scene, broadphase_t *broadphase);
+
+/**
+ * Chooses how a scene tests the pairs of its collision rules and contact
+ * forces: with the separating axis test, or with GJK and EPA, which grow
+ * more slowly with the number of vertices (see find_shape_collision_gjk()).
+ * Both find the same collisions; GJK also reports the distance between
+ * bodies that do not collide. Collision forces with handlers keep using
+ * the separating axis test.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param narrowphase the test to use, NARROWPHASE_SAT until this is called
+ */
+void scene_set_narrowphase(scene_t *scene, narrowphase_t narrowphase);
+
+/**
+ * Adds a collision rule to a scene.
+ * Every tick, after the force creators run, the scene's broadphase finds
+ * pairs of bodies whose bounding boxes overlap. Each pair covered by some
+ * rule is tested with find_shape_collision(), and if the bodies collide,
+ * handler is called with body1 in categories1 and body2 in categories2
+ * (see body_set_category()). If both orderings of a pair match a rule,
+ * the handler is called once for each ordering.
+ * This replaces registering a collision force for every pair by hand.
+ * A NULL handler makes this a contact rule (see scene_add_contact_rule()).
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param categories1 category bits of the first body passed to handler
+ * @param categories2 category bits of the second body passed to handler
+ * @param handler a function to call whenever matching bodies collide
+ * @param aux an auxiliary value to pass to handler
+ * @param freer if non-NULL, a function to call in order to free aux
+ */
+void scene_add_collision_rule(
+    scene_t *scene,
+    unsigned int categories1,
+    unsigned int categories2,
+    collision_handler_t handler,
+    void *aux,
+    free_func_t freer
+);
+
+/**
+ * Adds a rule whose colliding pairs are resolved by the scene's contact
+ * solver, like scene_add_contact_force() does for a single pair.
+ * Each pair is solved once even if it matches the rule both ways round.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param categories1 category bits of the first body of each pair
+ * @param categories2 category bits of the second body of each pair
+ * @param elasticity the coefficient of restitution, 0 for no bounce
+ */
+void scene_add_contact_rule(scene_t *scene, unsigned int categories1,
+  unsigned int categories2, double elasticity);
+
+/**
+ * A function called for each body found by a scene query.
+ * It may run further queries, e.g. to search outwards from what it finds,
+ * and remove bodies (see body_remove()), which later queries then skip.
+ * It must not add bodies to the scene or call scene_refresh_queries().
+ *
+ * @param body a body that matches the query
+ * @param aux the auxiliary value passed to the query
+ * @return true to keep searching, false to stop
+ */
+typedef bool (*scene_query_visitor_t)(body_t *body, void *aux);
+
+/**
+ * Brings the scene's query tree up to date with where its bodies are.
+ * The first query builds the tree, and from then on scene_tick() refreshes
+ * it before running collision handlers and after moving bodies; bodies
+ * moved or added in between may be missed until this is called.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ */
+void scene_refresh_queries(scene_t *scene);
+
+/**
+ * Calls visit on every body whose bounding box (see body_get_aabb())
+ * overlaps a box. Bodies marked for removal are skipped.
+ * Looks the bodies up in a bounding box tree, so the cost grows with the
+ * number of bodies near the box rather than in the scene.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param box the box to search
+ * @param visit the function to call on each body found
+ * @param aux an auxiliary value to pass to visit
+ */
+void scene_query_aabb(scene_t *scene, aabb_t box, scene_query_visitor_t visit,
+  void *aux);
+
+/**
+ * Finds the bodies scene_query_aabb() would visit, without allocating.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param box the box to search
+ * @param bodies an array to store up to capacity of the bodies in
+ * @param capacity the length of bodies
+ * @return the number of bodies found, which may exceed capacity
+ */
+size_t scene_query_aabb_bodies(scene_t *scene, aabb_t box, body_t **bodies,
+  size_t capacity);
+
+/**
+ * Calls visit on every body with some point within a distance of a center,
+ * like scene_query_aabb().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param center the center of the circle to search
+ * @param radius the radius of the circle
+ * @param visit the function to call on each body found
+ * @param aux an auxiliary value to pass to visit
+ */
+void scene_query_radius(scene_t *scene, vector_t center, double radius,
+  scene_query_visitor_t visit, void *aux);
+
+/**
+ * Finds the bodies scene_query_radius() would visit, without allocating.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param center the center of the circle to search
+ * @param radius the radius of the circle
+ * @param bodies an array to store up to capacity of the bodies in
+ * @param capacity the length of bodies
+ * @return the number of bodies found, which may exceed capacity
+ */
+size_t scene_query_radius_bodies(scene_t *scene, vector_t center,
+  double radius, body_t **bodies, size_t capacity);
+
+/**
+ * Calls visit on every body containing a point, like scene_query_aabb().
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param point the point to search at
+ * @param visit the function to call on each body found
+ * @param aux an auxiliary value to pass to visit
+ */
+void scene_query_point(scene_t *scene, vector_t point,
+  scene_query_visitor_t visit, void *aux);
+
+/**
+ * Finds the bodies scene_query_point() would visit, without allocating.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param point the point to search at
+ * @param bodies an array to store up to capacity of the bodies in
+ * @param capacity the length of bodies
+ * @return the number of bodies found, which may exceed capacity
+ */
+size_t scene_query_point_bodies(scene_t *scene, vector_t point,
+  body_t **bodies, size_t capacity);
+
+/**
+ * Finds the first body a segment from origin to origin + translation
+ * meets, skipping bodies marked for removal.
+ *
+ * @param scene a pointer to a scene returned from scene_init()
+ * @param origin the start of the segment
+ * @param translation the segment's direction and length
+ * @param fraction if a body is hit, set to how far along the segment the
+ *   hit is, from 0 to 1
+ * @return the body hit first, or NULL if the segment meets no body
+ */
+body_t *scene_ray_cast(scene_t *scene, vector_t origin, vector_t translation,
+  double *fraction);
+
 /**
  * Executes a tick of a given scene over a small time interval.
- * This requires executing all the force creators
+ * This requires executing all the force creators and collision rules
  * and then ticking each body (see body_tick()).
  * If any bodies are marked for removal, they should be removed from the scene
  * and freed, along with any force creators acting on them.
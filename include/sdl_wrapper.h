@@ -5,6 +5,7 @@
 #include "color.h"
 #include "list.h"
 #include "scene.h"
+#include "shape.h"
 #include "vector.h"
 #include <assert.h>
 #include <math.h>
@@ -161,6 +162,15 @@ void sdl_clear(void);
  */
 void sdl_draw_polygon(list_t *points, rgb_color_t color);
 
+/**
+ * Draws a polygon from a packed vertex array and a color.
+ * Reads the vertices in place instead of copying them into a list.
+ *
+ * @param shape the vertices of the polygon
+ * @param color the color used to fill in the polygon
+ */
+void sdl_draw_shape(const shape_t *shape, rgb_color_t color);
+
 /**
  * Displays the rendered frame on the SDL window.
  * Must be called after drawing the polygons in order to show them.
@@ -176,6 +186,16 @@ void sdl_show(void);
  */
 void sdl_render_scene(scene_t *scene);
 
+/**
+ * Draws all bodies in a scene, each a fraction alpha of the way from its
+ * previous physics state to its current one (see stepper_alpha()).
+ * Like sdl_render_scene(), this calls sdl_clear() and sdl_draw_polygon().
+ *
+ * @param scene the scene to draw
+ * @param alpha how far to interpolate each body, from 0 to 1
+ */
+void sdl_render_scene_interpolated(scene_t *scene, double alpha);
+
 /**
  * Registers a function to be called every time a key is pressed.
  * Overwrites any existing handler.
@@ -0,0 +1,121 @@
+#ifndef __SHAPE_H__
+#define __SHAPE_H__
+
+#include <stddef.h>
+#include "list.h"
+#include "vector.h"
+
+/**
+ * The number of vertices a shape can hold without allocating.
+ * Every shape the game creates (3- to 9-gons, rectangles and 5-point stars)
+ * fits inline.
+ */
+#define SHAPE_INLINE_CAPACITY 10
+
+/**
+ * A packed array of polygon vertices.
+ * Small shapes keep their vertices inline; larger ones spill to the heap.
+ * Unlike a list_t of vector_t pointers, the vertices are contiguous,
+ * so walking a shape touches one or two cache lines instead of one heap
+ * node per vertex.
+ * shape_t is defined here instead of shape.c so it can be embedded in bodies.
+ */
+typedef struct shape {
+  size_t size;
+  size_t capacity;
+  // NULL while the vertices fit in inline_points
+  vector_t *heap_points;
+  vector_t inline_points[SHAPE_INLINE_CAPACITY];
+} shape_t;
+
+/**
+ * Initializes an empty shape in place with room for the given number of
+ * vertices. Only allocates if capacity exceeds SHAPE_INLINE_CAPACITY.
+ *
+ * @param shape the shape to initialize
+ * @param capacity the number of vertices to reserve space for
+ */
+void shape_init(shape_t *shape, size_t capacity);
+
+/**
+ * Initializes a shape in place with a copy of the vertices in a list.
+ * This is the compatibility constructor for code that still builds shapes
+ * as lists of vector_t pointers. The list is not modified or freed.
+ *
+ * @param shape the shape to initialize
+ * @param list a list of vector_t pointers
+ */
+void shape_init_from_list(shape_t *shape, list_t *list);
+
+/**
+ * Releases any heap memory held by a shape.
+ * Does not free the shape_t itself.
+ *
+ * @param shape a shape initialized with shape_init()
+ */
+void shape_release(shape_t *shape);
+
+/**
+ * Makes dest an independent copy of src.
+ * dest must be initialized; its previous vertices are discarded.
+ *
+ * @param dest the shape to overwrite
+ * @param src the shape to copy
+ */
+void shape_copy(shape_t *dest, const shape_t *src);
+
+/**
+ * Copies a shape into a newly allocated list of vector_t pointers,
+ * which must be list_free()d.
+ *
+ * @param shape the shape to copy
+ * @return a list of the shape's vertices
+ */
+list_t *shape_to_list(const shape_t *shape);
+
+/**
+ * Appends a vertex, growing the shape if it is full.
+ *
+ * @param shape the shape to add to
+ * @param point the vertex to add
+ */
+void shape_add(shape_t *shape, vector_t point);
+
+/**
+ * Gets the number of vertices in a shape.
+ *
+ * @param shape the shape
+ * @return the number of vertices
+ */
+size_t shape_size(const shape_t *shape);
+
+/**
+ * Gets the contiguous vertex array of a shape, for modifying the vertices.
+ * The pointer is invalidated by shape_add(), shape_copy() and
+ * shape_release().
+ *
+ * @param shape the shape
+ * @return a pointer to the first of shape_size() vertices
+ */
+vector_t *shape_points(shape_t *shape);
+
+/**
+ * Gets the contiguous vertex array of a shape, for reading the vertices.
+ * Like shape_points(), but usable on a const shape.
+ *
+ * @param shape the shape
+ * @return a pointer to the first of shape_size() vertices
+ */
+const vector_t *shape_const_points(const shape_t *shape);
+
+/**
+ * Gets the vertex at a given index in a shape.
+ * Asserts that the index is valid.
+ *
+ * @param shape the shape
+ * @param index the index of the vertex
+ * @return the vertex
+ */
+vector_t shape_get(const shape_t *shape, size_t index);
+
+#endif // #ifndef __SHAPE_H__
@@ -0,0 +1,75 @@
+#ifndef __STEPPER_H__
+#define __STEPPER_H__
+
+#include <stddef.h>
+#include "scene.h"
+
+/**
+ * Drives a scene at a fixed physics rate, independently of the frame rate.
+ * Elapsed frame time is added to an accumulator and the scene is ticked
+ * once per whole step in it, so every scene_tick() sees the same dt.
+ * What is left over (less than one step) tells the renderer how far to
+ * interpolate between the last two physics states.
+ */
+typedef struct stepper stepper_t;
+
+/**
+ * Allocates a stepper.
+ * Asserts that step and max_substeps are positive.
+ *
+ * @param step the number of seconds of simulation per scene_tick()
+ * @param max_substeps the most steps stepper_advance() may take in one call;
+ *   time beyond that is dropped, so the simulation slows down rather than
+ *   falling further and further behind when a step costs more than it covers
+ * @return a pointer to the newly allocated stepper
+ */
+stepper_t *stepper_init(double step, size_t max_substeps);
+
+/**
+ * Releases the memory allocated for a stepper.
+ *
+ * @param stepper a pointer to a stepper returned from stepper_init()
+ */
+void stepper_free(stepper_t *stepper);
+
+/**
+ * Changes the physics step, e.g. to a longer one when frames are slow.
+ * Time already accumulated is kept.
+ * Asserts that step is positive.
+ *
+ * @param stepper a pointer to a stepper returned from stepper_init()
+ * @param step the new number of seconds per scene_tick()
+ */
+void stepper_set_step(stepper_t *stepper, double step);
+
+/**
+ * Gets the physics step.
+ *
+ * @param stepper a pointer to a stepper returned from stepper_init()
+ * @return the number of seconds per scene_tick()
+ */
+double stepper_get_step(stepper_t *stepper);
+
+/**
+ * Adds elapsed time to the accumulator and ticks the scene once per whole
+ * step in it, up to the substep cap. Before each tick, every body's state
+ * is saved with body_save_previous_state() for interpolation.
+ *
+ * @param stepper a pointer to a stepper returned from stepper_init()
+ * @param scene the scene to advance
+ * @param elapsed the number of seconds since the last call
+ * @return the number of times scene_tick() was called
+ */
+size_t stepper_advance(stepper_t *stepper, scene_t *scene, double elapsed);
+
+/**
+ * Gets how far the accumulated time is into the next step, which is how far
+ * to interpolate from the previous physics state to the current one
+ * (see body_get_interpolated_vertices()).
+ *
+ * @param stepper a pointer to a stepper returned from stepper_init()
+ * @return a fraction from 0 (inclusive) to 1 (exclusive)
+ */
+double stepper_alpha(stepper_t *stepper);
+
+#endif // #ifndef __STEPPER_H__
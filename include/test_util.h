@@ -45,6 +45,18 @@ bool within(double epsilon, double d1, double d2);
  */
 bool vec_within(double epsilon, vector_t v1, vector_t v2);
 
+/**
+ * Returns a random double between min and max, drawn with rand() so that
+ * srand() makes the sequence repeatable.
+ */
+double random_double(double min, double max);
+
+/**
+ * Returns the current time in seconds from a monotonic clock, for timing
+ * benchmarks; only differences between calls are meaningful.
+ */
+double now(void);
+
 /**
  * Open the file 'filename', read one word into 'testname', and close the file.
  * If the file cannot be found, exit with error.
@@ -0,0 +1,60 @@
+#include "aabb.h"
+#include <assert.h>
+#include "shape.h"
+#include "vector.h"
+
+aabb_t aabb_of_shape(const shape_t *shape) {
+  size_t n = shape_size(shape);
+  assert(n > 0);
+  const vector_t *points = shape_const_points(shape);
+  aabb_t box = {points[0], points[0]};
+  for (size_t i = 1; i < n; i++) {
+    if (points[i].x < box.min.x) {
+      box.min.x = points[i].x;
+    }
+    else if (points[i].x > box.max.x) {
+      box.max.x = points[i].x;
+    }
+    if (points[i].y < box.min.y) {
+      box.min.y = points[i].y;
+    }
+    else if (points[i].y > box.max.y) {
+      box.max.y = points[i].y;
+    }
+  }
+  return box;
+}
+
+bool aabb_overlaps(aabb_t a, aabb_t b) {
+  return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+    a.min.y <= b.max.y && b.min.y <= a.max.y;
+}
+
+bool aabb_contains(aabb_t outer, aabb_t inner) {
+  return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y &&
+    inner.max.x <= outer.max.x && inner.max.y <= outer.max.y;
+}
+
+aabb_t aabb_union(aabb_t a, aabb_t b) {
+  aabb_t box = a;
+  if (b.min.x < box.min.x) {
+    box.min.x = b.min.x;
+  }
+  if (b.min.y < box.min.y) {
+    box.min.y = b.min.y;
+  }
+  if (b.max.x > box.max.x) {
+    box.max.x = b.max.x;
+  }
+  if (b.max.y > box.max.y) {
+    box.max.y = b.max.y;
+  }
+  return box;
+}
+
+aabb_t aabb_expand(aabb_t box, double margin) {
+  return (aabb_t) {
+    {box.min.x - margin, box.min.y - margin},
+    {box.max.x + margin, box.max.y + margin}
+  };
+}
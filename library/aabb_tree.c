@@ -0,0 +1,398 @@
+#include "aabb_tree.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aabb.h"
+
+const int NULL_NODE = -1;
+// Queries keep their traversal stack on the C stack up to this many nodes,
+// far deeper than any balanced tree of a realistic size
+#define QUERY_STACK_SIZE 64
+
+typedef struct tree_node {
+  aabb_t box;
+  void *data;
+  // parent for nodes in the tree, next free node for nodes on the free list
+  int parent;
+  int child1;
+  int child2;
+  // 0 for leaves, -1 for free nodes
+  int height;
+} tree_node_t;
+
+typedef struct aabb_tree {
+  int root;
+  tree_node_t *nodes;
+  int node_count;
+  int node_capacity;
+  int free_list;
+} aabb_tree_t;
+
+static double perimeter(aabb_t box) {
+  return 2.0 * ((box.max.x - box.min.x) + (box.max.y - box.min.y));
+}
+
+static int max_int(int a, int b) {
+  return a > b ? a : b;
+}
+
+/**
+ * Threads nodes [first, capacity) onto the free list.
+ */
+static void link_free_nodes(aabb_tree_t *tree, int first) {
+  for (int i = first; i < tree->node_capacity - 1; i++) {
+    tree->nodes[i].parent = i + 1;
+    tree->nodes[i].height = -1;
+  }
+  tree->nodes[tree->node_capacity - 1].parent = NULL_NODE;
+  tree->nodes[tree->node_capacity - 1].height = -1;
+  tree->free_list = first;
+}
+
+aabb_tree_t *aabb_tree_init(void) {
+  aabb_tree_t *tree = malloc(sizeof(aabb_tree_t));
+  assert(tree != NULL);
+  tree->root = NULL_NODE;
+  tree->node_count = 0;
+  tree->node_capacity = 16;
+  tree->nodes = malloc(tree->node_capacity * sizeof(tree_node_t));
+  assert(tree->nodes != NULL);
+  link_free_nodes(tree, 0);
+  return tree;
+}
+
+void aabb_tree_free(aabb_tree_t *tree) {
+  free(tree->nodes);
+  free(tree);
+}
+
+static int allocate_node(aabb_tree_t *tree) {
+  if (tree->free_list == NULL_NODE) {
+    int old_capacity = tree->node_capacity;
+    tree->node_capacity *= 2;
+    tree->nodes = realloc(tree->nodes,
+      tree->node_capacity * sizeof(tree_node_t));
+    assert(tree->nodes != NULL);
+    link_free_nodes(tree, old_capacity);
+  }
+  int id = tree->free_list;
+  tree_node_t *node = &tree->nodes[id];
+  tree->free_list = node->parent;
+  node->parent = NULL_NODE;
+  node->child1 = NULL_NODE;
+  node->child2 = NULL_NODE;
+  node->height = 0;
+  node->data = NULL;
+  tree->node_count++;
+  return id;
+}
+
+static void free_node(aabb_tree_t *tree, int id) {
+  tree->nodes[id].parent = tree->free_list;
+  tree->nodes[id].height = -1;
+  tree->free_list = id;
+  tree->node_count--;
+}
+
+/**
+ * Performs a left or right rotation if node a is imbalanced.
+ * Returns the new root of the subtree.
+ */
+static int balance(aabb_tree_t *tree, int a_id) {
+  tree_node_t *nodes = tree->nodes;
+  tree_node_t *a = &nodes[a_id];
+  if (a->height < 2) {
+    return a_id;
+  }
+  int b_id = a->child1;
+  int c_id = a->child2;
+  tree_node_t *b = &nodes[b_id];
+  tree_node_t *c = &nodes[c_id];
+  int skew = c->height - b->height;
+
+  if (skew > 1) {
+    // Rotates c up
+    int f_id = c->child1;
+    int g_id = c->child2;
+    tree_node_t *f = &nodes[f_id];
+    tree_node_t *g = &nodes[g_id];
+    c->child1 = a_id;
+    c->parent = a->parent;
+    a->parent = c_id;
+    if (c->parent != NULL_NODE) {
+      if (nodes[c->parent].child1 == a_id) {
+        nodes[c->parent].child1 = c_id;
+      }
+      else {
+        nodes[c->parent].child2 = c_id;
+      }
+    }
+    else {
+      tree->root = c_id;
+    }
+    if (f->height > g->height) {
+      c->child2 = f_id;
+      a->child2 = g_id;
+      g->parent = a_id;
+      a->box = aabb_union(b->box, g->box);
+      c->box = aabb_union(a->box, f->box);
+      a->height = 1 + max_int(b->height, g->height);
+      c->height = 1 + max_int(a->height, f->height);
+    }
+    else {
+      c->child2 = g_id;
+      a->child2 = f_id;
+      f->parent = a_id;
+      a->box = aabb_union(b->box, f->box);
+      c->box = aabb_union(a->box, g->box);
+      a->height = 1 + max_int(b->height, f->height);
+      c->height = 1 + max_int(a->height, g->height);
+    }
+    return c_id;
+  }
+
+  if (skew < -1) {
+    // Rotates b up
+    int d_id = b->child1;
+    int e_id = b->child2;
+    tree_node_t *d = &nodes[d_id];
+    tree_node_t *e = &nodes[e_id];
+    b->child1 = a_id;
+    b->parent = a->parent;
+    a->parent = b_id;
+    if (b->parent != NULL_NODE) {
+      if (nodes[b->parent].child1 == a_id) {
+        nodes[b->parent].child1 = b_id;
+      }
+      else {
+        nodes[b->parent].child2 = b_id;
+      }
+    }
+    else {
+      tree->root = b_id;
+    }
+    if (d->height > e->height) {
+      b->child2 = d_id;
+      a->child1 = e_id;
+      e->parent = a_id;
+      a->box = aabb_union(c->box, e->box);
+      b->box = aabb_union(a->box, d->box);
+      a->height = 1 + max_int(c->height, e->height);
+      b->height = 1 + max_int(a->height, d->height);
+    }
+    else {
+      b->child2 = e_id;
+      a->child1 = d_id;
+      d->parent = a_id;
+      a->box = aabb_union(c->box, d->box);
+      b->box = aabb_union(a->box, e->box);
+      a->height = 1 + max_int(c->height, d->height);
+      b->height = 1 + max_int(a->height, e->height);
+    }
+    return b_id;
+  }
+  return a_id;
+}
+
+/**
+ * Walks from a node to the root, refitting boxes and heights and
+ * rebalancing along the way.
+ */
+static void refit(aabb_tree_t *tree, int id) {
+  while (id != NULL_NODE) {
+    id = balance(tree, id);
+    tree_node_t *node = &tree->nodes[id];
+    tree_node_t *child1 = &tree->nodes[node->child1];
+    tree_node_t *child2 = &tree->nodes[node->child2];
+    node->height = 1 + max_int(child1->height, child2->height);
+    node->box = aabb_union(child1->box, child2->box);
+    id = node->parent;
+  }
+}
+
+static void insert_leaf(aabb_tree_t *tree, int leaf) {
+  if (tree->root == NULL_NODE) {
+    tree->root = leaf;
+    tree->nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // Descends towards the sibling that minimizes the added perimeter
+  aabb_t leaf_box = tree->nodes[leaf].box;
+  int index = tree->root;
+  while (tree->nodes[index].height > 0) {
+    tree_node_t *node = &tree->nodes[index];
+    double area = perimeter(node->box);
+    double combined = perimeter(aabb_union(node->box, leaf_box));
+    // Cost of making a new parent for this node and the leaf
+    double cost = 2.0 * combined;
+    // Minimum cost of pushing the leaf further down
+    double inheritance = 2.0 * (combined - area);
+
+    double costs[2];
+    int children[2] = {node->child1, node->child2};
+    for (int k = 0; k < 2; k++) {
+      tree_node_t *child = &tree->nodes[children[k]];
+      double enlarged = perimeter(aabb_union(leaf_box, child->box));
+      if (child->height == 0) {
+        costs[k] = enlarged + inheritance;
+      }
+      else {
+        costs[k] = enlarged - perimeter(child->box) + inheritance;
+      }
+    }
+    if (cost < costs[0] && cost < costs[1]) {
+      break;
+    }
+    index = costs[0] < costs[1] ? children[0] : children[1];
+  }
+
+  // Creates a new parent for the sibling and the leaf
+  int sibling = index;
+  int old_parent = tree->nodes[sibling].parent;
+  int new_parent = allocate_node(tree);
+  tree_node_t *parent = &tree->nodes[new_parent];
+  parent->parent = old_parent;
+  parent->box = aabb_union(leaf_box, tree->nodes[sibling].box);
+  parent->height = tree->nodes[sibling].height + 1;
+  parent->child1 = sibling;
+  parent->child2 = leaf;
+  if (old_parent != NULL_NODE) {
+    if (tree->nodes[old_parent].child1 == sibling) {
+      tree->nodes[old_parent].child1 = new_parent;
+    }
+    else {
+      tree->nodes[old_parent].child2 = new_parent;
+    }
+  }
+  else {
+    tree->root = new_parent;
+  }
+  tree->nodes[sibling].parent = new_parent;
+  tree->nodes[leaf].parent = new_parent;
+
+  refit(tree, tree->nodes[leaf].parent);
+}
+
+static void remove_leaf(aabb_tree_t *tree, int leaf) {
+  if (leaf == tree->root) {
+    tree->root = NULL_NODE;
+    return;
+  }
+  int parent = tree->nodes[leaf].parent;
+  int grand_parent = tree->nodes[parent].parent;
+  int sibling = tree->nodes[parent].child1 == leaf ?
+    tree->nodes[parent].child2 : tree->nodes[parent].child1;
+
+  if (grand_parent != NULL_NODE) {
+    // Replaces the parent with the sibling
+    if (tree->nodes[grand_parent].child1 == parent) {
+      tree->nodes[grand_parent].child1 = sibling;
+    }
+    else {
+      tree->nodes[grand_parent].child2 = sibling;
+    }
+    tree->nodes[sibling].parent = grand_parent;
+    free_node(tree, parent);
+    refit(tree, grand_parent);
+  }
+  else {
+    tree->root = sibling;
+    tree->nodes[sibling].parent = NULL_NODE;
+    free_node(tree, parent);
+  }
+}
+
+int aabb_tree_insert(aabb_tree_t *tree, aabb_t box, void *data) {
+  int proxy = allocate_node(tree);
+  tree->nodes[proxy].box = box;
+  tree->nodes[proxy].data = data;
+  insert_leaf(tree, proxy);
+  return proxy;
+}
+
+void aabb_tree_remove(aabb_tree_t *tree, int proxy) {
+  assert(aabb_tree_is_leaf(tree, proxy));
+  remove_leaf(tree, proxy);
+  free_node(tree, proxy);
+}
+
+bool aabb_tree_move(aabb_tree_t *tree, int proxy, aabb_t box, double margin) {
+  assert(aabb_tree_is_leaf(tree, proxy));
+  if (aabb_contains(tree->nodes[proxy].box, box)) {
+    return false;
+  }
+  remove_leaf(tree, proxy);
+  tree->nodes[proxy].box = aabb_expand(box, margin);
+  insert_leaf(tree, proxy);
+  return true;
+}
+
+bool aabb_tree_is_leaf(aabb_tree_t *tree, int proxy) {
+  return proxy >= 0 && proxy < tree->node_capacity &&
+    tree->nodes[proxy].height == 0;
+}
+
+aabb_t aabb_tree_get_box(aabb_tree_t *tree, int proxy) {
+  assert(aabb_tree_is_leaf(tree, proxy));
+  return tree->nodes[proxy].box;
+}
+
+void *aabb_tree_get_data(aabb_tree_t *tree, int proxy) {
+  assert(aabb_tree_is_leaf(tree, proxy));
+  return tree->nodes[proxy].data;
+}
+
+size_t aabb_tree_capacity(aabb_tree_t *tree) {
+  return (size_t) tree->node_capacity;
+}
+
+int aabb_tree_height(aabb_tree_t *tree) {
+  if (tree->root == NULL_NODE) {
+    return 0;
+  }
+  return tree->nodes[tree->root].height;
+}
+
+void aabb_tree_query(aabb_tree_t *tree, aabb_t box, aabb_tree_visitor_t visit,
+  void *aux) {
+  if (tree->root == NULL_NODE) {
+    return;
+  }
+  int local_stack[QUERY_STACK_SIZE];
+  int *stack = local_stack;
+  size_t capacity = QUERY_STACK_SIZE;
+  size_t top = 0;
+  stack[top++] = tree->root;
+  while (top > 0) {
+    int id = stack[--top];
+    tree_node_t *node = &tree->nodes[id];
+    if (!aabb_overlaps(node->box, box)) {
+      continue;
+    }
+    if (node->height == 0) {
+      if (!visit(aux, id)) {
+        break;
+      }
+      continue;
+    }
+    if (top + 2 > capacity) {
+      // Only a badly unbalanced tree gets this deep
+      capacity *= 2;
+      if (stack == local_stack) {
+        stack = malloc(capacity * sizeof(int));
+        assert(stack != NULL);
+        memcpy(stack, local_stack, top * sizeof(int));
+      }
+      else {
+        stack = realloc(stack, capacity * sizeof(int));
+        assert(stack != NULL);
+      }
+    }
+    stack[top++] = node->child1;
+    stack[top++] = node->child2;
+  }
+  if (stack != local_stack) {
+    free(stack);
+  }
+}
@@ -0,0 +1,135 @@
+#include "axis_cache.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "body.h"
+#include "vector.h"
+
+// Slots in a fresh table; always a power of two
+const size_t AXIS_CACHE_MIN_CAPACITY = 64;
+
+/**
+ * A remembered axis. The pair is stored with the lower address first;
+ * an empty slot has body1 == NULL.
+ */
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+  vector_t axis;
+} axis_entry_t;
+
+/**
+ * An open-addressing hash table with linear probing.
+ */
+typedef struct {
+  axis_entry_t *entries;
+  size_t capacity;
+  size_t count;
+} axis_table_t;
+
+typedef struct axis_cache {
+  // what axis_cache_get() reads, and what axis_cache_put() fills
+  axis_table_t previous;
+  axis_table_t current;
+} axis_cache_t;
+
+static void table_init(axis_table_t *table, size_t capacity) {
+  table->entries = calloc(capacity, sizeof(axis_entry_t));
+  assert(table->entries != NULL);
+  table->capacity = capacity;
+  table->count = 0;
+}
+
+axis_cache_t *axis_cache_init(void) {
+  axis_cache_t *cache = malloc(sizeof(axis_cache_t));
+  assert(cache != NULL);
+  table_init(&cache->previous, AXIS_CACHE_MIN_CAPACITY);
+  table_init(&cache->current, AXIS_CACHE_MIN_CAPACITY);
+  return cache;
+}
+
+void axis_cache_free(axis_cache_t *cache) {
+  free(cache->previous.entries);
+  free(cache->current.entries);
+  free(cache);
+}
+
+/**
+ * Puts a pair in its canonical order.
+ */
+static void order_pair(body_t **body1, body_t **body2) {
+  if ((uintptr_t) *body2 < (uintptr_t) *body1) {
+    body_t *swap = *body1;
+    *body1 = *body2;
+    *body2 = swap;
+  }
+}
+
+static size_t pair_hash(body_t *body1, body_t *body2) {
+  uint64_t hash = (uint64_t) (uintptr_t) body1 * 0x9E3779B97F4A7C15ull;
+  hash ^= (uint64_t) (uintptr_t) body2 * 0xC2B2AE3D27D4EB4Full;
+  return (size_t) (hash ^ (hash >> 29));
+}
+
+/**
+ * Finds the slot of an ordered pair, or the empty slot where it would go.
+ */
+static axis_entry_t *table_find(const axis_table_t *table, body_t *body1,
+  body_t *body2) {
+  size_t mask = table->capacity - 1;
+  size_t slot = pair_hash(body1, body2) & mask;
+  while (table->entries[slot].body1 != NULL &&
+    (table->entries[slot].body1 != body1 ||
+      table->entries[slot].body2 != body2)) {
+    slot = (slot + 1) & mask;
+  }
+  return &table->entries[slot];
+}
+
+/**
+ * Doubles the number of slots, keeping every entry.
+ */
+static void table_grow(axis_table_t *table) {
+  axis_table_t grown;
+  table_init(&grown, 2 * table->capacity);
+  for (size_t i = 0; i < table->capacity; i++) {
+    axis_entry_t *entry = &table->entries[i];
+    if (entry->body1 != NULL) {
+      *table_find(&grown, entry->body1, entry->body2) = *entry;
+    }
+  }
+  grown.count = table->count;
+  free(table->entries);
+  *table = grown;
+}
+
+void axis_cache_next_tick(axis_cache_t *cache) {
+  // Reuses the older table for this tick's axes
+  axis_table_t old = cache->previous;
+  cache->previous = cache->current;
+  memset(old.entries, 0, old.capacity * sizeof(axis_entry_t));
+  old.count = 0;
+  cache->current = old;
+}
+
+vector_t axis_cache_get(axis_cache_t *cache, body_t *body1, body_t *body2) {
+  order_pair(&body1, &body2);
+  axis_entry_t *entry = table_find(&cache->previous, body1, body2);
+  return entry->body1 == NULL ? VEC_ZERO : entry->axis;
+}
+
+void axis_cache_put(axis_cache_t *cache, body_t *body1, body_t *body2,
+  vector_t axis) {
+  order_pair(&body1, &body2);
+  axis_table_t *table = &cache->current;
+  // Keeps the table at most half full so probes stay short
+  if (2 * (table->count + 1) > table->capacity) {
+    table_grow(table);
+  }
+  axis_entry_t *entry = table_find(table, body1, body2);
+  if (entry->body1 == NULL) {
+    table->count++;
+  }
+  *entry = (axis_entry_t) {body1, body2, axis};
+}
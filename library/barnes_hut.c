@@ -0,0 +1,253 @@
+#include "barnes_hut.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include "body.h"
+#include "force_records.h"
+#include "vector.h"
+
+// Bodies closer together than the cells at this depth share one leaf
+#define BH_MAX_DEPTH 32
+// Each level of the traversal pops one node and pushes at most four
+#define BH_STACK_SIZE (3 * BH_MAX_DEPTH + 4)
+// Bodies per job_pool chunk
+const size_t BH_GRAIN = 256;
+
+/**
+ * A square quadtree cell. Internal cells have four consecutive children
+ * starting at first_child; leaves have first_child == -1.
+ */
+typedef struct {
+  double center_x;
+  double center_y;
+  double half_width;
+  double mass;
+  // mass-weighted sum of positions while building, center of mass after
+  double mass_x;
+  double mass_y;
+  int first_child;
+  // the body in a one-body leaf
+  size_t body;
+  size_t count;
+} bh_node_t;
+
+typedef struct barnes_hut {
+  double G;
+  double theta;
+  // bodies that take part this update, with their positions and masses
+  size_t body_count;
+  size_t body_capacity;
+  body_t **bodies;
+  vector_t *positions;
+  double *masses;
+  size_t node_count;
+  size_t node_capacity;
+  bh_node_t *nodes;
+} barnes_hut_t;
+
+barnes_hut_t *barnes_hut_init(double G, double theta) {
+  assert(theta >= 0);
+  barnes_hut_t *bh = malloc(sizeof(barnes_hut_t));
+  assert(bh != NULL);
+  bh->G = G;
+  bh->theta = theta;
+  bh->body_count = 0;
+  bh->body_capacity = 0;
+  bh->bodies = NULL;
+  bh->positions = NULL;
+  bh->masses = NULL;
+  bh->node_count = 0;
+  bh->node_capacity = 0;
+  bh->nodes = NULL;
+  return bh;
+}
+
+void barnes_hut_free(barnes_hut_t *bh) {
+  free(bh->bodies);
+  free(bh->positions);
+  free(bh->masses);
+  free(bh->nodes);
+  free(bh);
+}
+
+/**
+ * Copies the position and mass of every body that takes part.
+ */
+static void collect_bodies(barnes_hut_t *bh, list_t *bodies) {
+  size_t n = list_size(bodies);
+  if (n > bh->body_capacity) {
+    bh->bodies = realloc(bh->bodies, n * sizeof(body_t *));
+    bh->positions = realloc(bh->positions, n * sizeof(vector_t));
+    bh->masses = realloc(bh->masses, n * sizeof(double));
+    assert(bh->bodies != NULL && bh->positions != NULL && bh->masses != NULL);
+    bh->body_capacity = n;
+  }
+  bh->body_count = 0;
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = list_get(bodies, i);
+    double mass = body_get_mass(body);
+    if (body_is_removed(body) || mass == 0 || isinf(mass)) {
+      continue;
+    }
+    bh->bodies[bh->body_count] = body;
+    bh->positions[bh->body_count] = body_get_centroid(body);
+    bh->masses[bh->body_count] = mass;
+    bh->body_count++;
+  }
+}
+
+/**
+ * Appends an empty leaf and returns its index.
+ */
+static int add_node(barnes_hut_t *bh, double center_x, double center_y,
+  double half_width) {
+  if (bh->node_count == bh->node_capacity) {
+    bh->node_capacity = 2 * bh->node_capacity + 1;
+    bh->nodes = realloc(bh->nodes, bh->node_capacity * sizeof(bh_node_t));
+    assert(bh->nodes != NULL);
+  }
+  bh->nodes[bh->node_count] = (bh_node_t) {center_x, center_y, half_width,
+    0, 0, 0, -1, 0, 0};
+  return (int) bh->node_count++;
+}
+
+/**
+ * Gets which of a cell's children contains a point.
+ */
+static int quadrant(bh_node_t *node, vector_t p) {
+  return (p.x >= node->center_x ? 1 : 0) + (p.y >= node->center_y ? 2 : 0);
+}
+
+/**
+ * Splits a leaf into four children.
+ */
+static void subdivide(barnes_hut_t *bh, int node) {
+  double quarter = bh->nodes[node].half_width / 2;
+  double x = bh->nodes[node].center_x;
+  double y = bh->nodes[node].center_y;
+  int first = add_node(bh, x - quarter, y - quarter, quarter);
+  add_node(bh, x + quarter, y - quarter, quarter);
+  add_node(bh, x - quarter, y + quarter, quarter);
+  add_node(bh, x + quarter, y + quarter, quarter);
+  bh->nodes[node].first_child = first;
+}
+
+/**
+ * Adds a body's mass to a cell.
+ */
+static void accumulate(bh_node_t *node, vector_t p, double mass) {
+  node->mass += mass;
+  node->mass_x += mass * p.x;
+  node->mass_y += mass * p.y;
+  node->count++;
+}
+
+/**
+ * Adds a body to every cell on its way down to a leaf,
+ * splitting the occupied leaf it reaches.
+ */
+static void insert_body(barnes_hut_t *bh, size_t body) {
+  vector_t p = bh->positions[body];
+  double mass = bh->masses[body];
+  int node = 0;
+  for (int depth = 0; ; depth++) {
+    bh_node_t *current = &bh->nodes[node];
+    if (current->first_child == -1) {
+      if (current->count == 0 || depth == BH_MAX_DEPTH) {
+        current->body = body;
+        accumulate(current, p, mass);
+        return;
+      }
+      // Pushes the leaf's body down before descending
+      size_t other = current->body;
+      subdivide(bh, node);
+      current = &bh->nodes[node];
+      bh_node_t *child = &bh->nodes[current->first_child +
+        quadrant(current, bh->positions[other])];
+      child->body = other;
+      accumulate(child, bh->positions[other], bh->masses[other]);
+    }
+    accumulate(current, p, mass);
+    node = current->first_child + quadrant(current, p);
+  }
+}
+
+/**
+ * Builds the quadtree over the collected bodies.
+ */
+static void build_tree(barnes_hut_t *bh) {
+  bh->node_count = 0;
+  vector_t min = bh->positions[0];
+  vector_t max = bh->positions[0];
+  for (size_t i = 1; i < bh->body_count; i++) {
+    min.x = fmin(min.x, bh->positions[i].x);
+    min.y = fmin(min.y, bh->positions[i].y);
+    max.x = fmax(max.x, bh->positions[i].x);
+    max.y = fmax(max.y, bh->positions[i].y);
+  }
+  // Kept non-zero even if every body shares one position
+  double half_width = fmax(max.x - min.x, max.y - min.y) / 2 + 1;
+  add_node(bh, (min.x + max.x) / 2, (min.y + max.y) / 2, half_width);
+  for (size_t i = 0; i < bh->body_count; i++) {
+    insert_body(bh, i);
+  }
+  for (size_t n = 0; n < bh->node_count; n++) {
+    bh_node_t *node = &bh->nodes[n];
+    if (node->mass > 0) {
+      node->mass_x /= node->mass;
+      node->mass_y /= node->mass;
+    }
+  }
+}
+
+/**
+ * Sums the pull of every cell on one body.
+ */
+static vector_t field_at(barnes_hut_t *bh, size_t body) {
+  vector_t p = bh->positions[body];
+  vector_t force = VEC_ZERO;
+  double theta_squared = bh->theta * bh->theta;
+  int stack[BH_STACK_SIZE];
+  size_t top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    bh_node_t *node = &bh->nodes[stack[--top]];
+    if (node->count == 0 || (node->count == 1 && node->body == body)) {
+      continue;
+    }
+    double dx = node->mass_x - p.x;
+    double dy = node->mass_y - p.y;
+    double distance_squared = dx * dx + dy * dy;
+    double width = 2 * node->half_width;
+    if (node->first_child != -1 &&
+      width * width >= theta_squared * distance_squared) {
+      for (int c = 0; c < 4; c++) {
+        stack[top++] = node->first_child + c;
+      }
+      continue;
+    }
+    double distance = sqrt(distance_squared);
+    if (distance > MIN_DIST) {
+      double force_mag = bh->G * node->mass / distance_squared;
+      force.x += force_mag * dx / distance;
+      force.y += force_mag * dy / distance;
+    }
+  }
+  return vec_multiply(bh->masses[body], force);
+}
+
+static void apply_field(void *aux, size_t begin, size_t end, size_t worker) {
+  barnes_hut_t *bh = aux;
+  for (size_t i = begin; i < end; i++) {
+    body_add_force(bh->bodies[i], field_at(bh, i));
+  }
+}
+
+void barnes_hut_apply(barnes_hut_t *bh, list_t *bodies, job_pool_t *pool) {
+  collect_bodies(bh, bodies);
+  if (bh->body_count < 2) {
+    return;
+  }
+  build_tree(bh);
+  job_pool_parallel_for(pool, bh->body_count, BH_GRAIN, apply_field, bh);
+}
@@ -3,16 +3,53 @@
 #include <stdio.h>
 #include "color.h"
 #include <assert.h>
+#include "aabb.h"
+#include "body_store.h"
 #include "polygon.h"
+#include "shape.h"
 #include "vector.h"
 
+/**
+ * Splits a concave body's local shape into convex pieces.
+ */
+static void init_pieces(body_t *body) {
+  size_t count;
+  shape_t *shapes = shape_decompose(&body->local_shape, &count);
+  body->pieces = malloc(count * sizeof(body_piece_t));
+  assert(body->pieces != NULL);
+  body->piece_count = count;
+  for (size_t i = 0; i < count; i++) {
+    body_piece_t *piece = &body->pieces[i];
+    piece->local_shape = shapes[i];
+    shape_init(&piece->local_normals, shape_size(&piece->local_shape));
+    shape_unique_normals(&piece->local_shape, &piece->local_normals);
+    shape_init(&piece->world_shape, shape_size(&piece->local_shape));
+    shape_init(&piece->world_normals, shape_size(&piece->local_normals));
+  }
+  free(shapes);
+}
+
 body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
   body_t *toReturn = malloc(sizeof(body_t));
   assert(toReturn != NULL);
-  toReturn->shape = shape;
+  shape_init_from_list(&toReturn->local_shape, shape);
+  list_free(shape);
   toReturn->mass = mass;
   toReturn->color = color;
-  toReturn->centroid = polygon_centroid(shape);
+  // Stores the shape relative to its centroid
+  toReturn->centroid = shape_centroid(&toReturn->local_shape);
+  shape_translate(&toReturn->local_shape, vec_negate(toReturn->centroid));
+  toReturn->bounding_radius = shape_radius(&toReturn->local_shape, VEC_ZERO);
+  shape_init(&toReturn->local_normals, shape_size(&toReturn->local_shape));
+  shape_unique_normals(&toReturn->local_shape, &toReturn->local_normals);
+  shape_init(&toReturn->world_normals, shape_size(&toReturn->local_normals));
+  toReturn->pieces = NULL;
+  toReturn->piece_count = 0;
+  if (!shape_is_convex(&toReturn->local_shape)) {
+    init_pieces(toReturn);
+  }
+  shape_init(&toReturn->world_shape, shape_size(&toReturn->local_shape));
+  toReturn->world_valid = false;
   toReturn->velocity = (vector_t) {0.0, 0.0};
   toReturn->orientation = 0.0;
   toReturn->force = (vector_t) {0, 0};
@@ -20,6 +57,20 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
   toReturn->forRemoval = 0;
   toReturn->info = NULL;
   toReturn->info_freer = NULL;
+  toReturn->store = NULL;
+  toReturn->store_index = 0;
+  toReturn->category = 0;
+  toReturn->broadphase_proxy = -1;
+  toReturn->query_proxy = -1;
+  toReturn->solver_slot = -1;
+  toReturn->forces = list_init(1, NULL, NULL);
+  toReturn->forces_stale = false;
+  toReturn->scene_index = 0;
+  toReturn->previous_valid = false;
+  toReturn->asleep = false;
+  toReturn->sleep_time = 0.0;
+  toReturn->sleep_store = NULL;
+  toReturn->bullet = false;
   return toReturn;
 }
 
@@ -32,7 +83,22 @@ body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color, void
 }
 
 void body_free(body_t *body){
-  list_free(body->shape);
+  if (body->store != NULL) {
+    body_store_remove(body->store, body);
+  }
+  shape_release(&body->local_shape);
+  shape_release(&body->world_shape);
+  shape_release(&body->local_normals);
+  shape_release(&body->world_normals);
+  for (size_t i = 0; i < body->piece_count; i++) {
+    body_piece_t *piece = &body->pieces[i];
+    shape_release(&piece->local_shape);
+    shape_release(&piece->local_normals);
+    shape_release(&piece->world_shape);
+    shape_release(&piece->world_normals);
+  }
+  free(body->pieces);
+  list_free(body->forces);
   if (body->info_freer != NULL && body->info != NULL){
     body->info_freer(body->info);
   }
@@ -40,21 +106,99 @@ void body_free(body_t *body){
 }
 
 list_t *body_get_shape(body_t *body) {
-  list_t *copy = list_init(list_size(body->shape), free,
-    (equality_func_t) body_equals);
-  for (size_t i = 0; i < list_size(body->shape); i++) {
-    vector_t *vec_copy = malloc(sizeof(vector_t));
-    *vec_copy = *(vector_t *)(list_get(body->shape, i));
-    list_add(copy, vec_copy);
+  return shape_to_list(body_get_vertices(body));
+}
+
+const shape_t *body_get_vertices(body_t *body) {
+  vector_t centroid = body_get_centroid(body);
+  if (!body->world_valid || body->world_centroid.x != centroid.x ||
+    body->world_centroid.y != centroid.y ||
+    body->world_orientation != body->orientation) {
+    // Moving the body leaves its normals alone
+    bool rotated = !body->world_valid ||
+      body->world_orientation != body->orientation;
+    if (rotated) {
+      shape_transform(&body->world_normals, &body->local_normals, VEC_ZERO,
+        body->orientation);
+    }
+    shape_transform(&body->world_shape, &body->local_shape, centroid,
+      body->orientation);
+    for (size_t i = 0; i < body->piece_count; i++) {
+      body_piece_t *piece = &body->pieces[i];
+      if (rotated) {
+        shape_transform(&piece->world_normals, &piece->local_normals,
+          VEC_ZERO, body->orientation);
+      }
+      shape_transform(&piece->world_shape, &piece->local_shape, centroid,
+        body->orientation);
+      piece->world_aabb = aabb_of_shape(&piece->world_shape);
+    }
+    body->world_centroid = centroid;
+    body->world_orientation = body->orientation;
+    body->world_aabb = aabb_of_shape(&body->world_shape);
+    body->world_valid = true;
   }
-  return copy;
+  return &body->world_shape;
+}
+
+aabb_t body_get_aabb(body_t *body) {
+  body_get_vertices(body);
+  return body->world_aabb;
+}
+
+const shape_t *body_get_normals(body_t *body) {
+  body_get_vertices(body);
+  return &body->world_normals;
+}
+
+size_t body_get_piece_count(body_t *body) {
+  return body->piece_count;
+}
+
+const body_piece_t *body_get_piece(body_t *body, size_t index) {
+  assert(index < body->piece_count);
+  body_get_vertices(body);
+  return &body->pieces[index];
+}
+
+double body_get_radius(body_t *body) {
+  return body->bounding_radius;
+}
+
+void body_save_previous_state(body_t *body) {
+  body->previous_centroid = body_get_centroid(body);
+  body->previous_orientation = body->orientation;
+  body->previous_valid = true;
+}
+
+void body_get_interpolated_vertices(body_t *body, double alpha,
+  shape_t *dest) {
+  vector_t centroid = body_get_centroid(body);
+  double orientation = body->orientation;
+  if (body->previous_valid) {
+    centroid = vec_add(body->previous_centroid, vec_multiply(alpha,
+      vec_subtract(centroid, body->previous_centroid)));
+    orientation = body->previous_orientation +
+      alpha * (orientation - body->previous_orientation);
+  }
+  shape_transform(dest, &body->local_shape, centroid, orientation);
+}
+
+unsigned int body_get_category(body_t *body) {
+  return body->category;
 }
 
 vector_t body_get_centroid(body_t *body) {
+  if (body->store != NULL) {
+    return body_store_get_centroid(body->store, body->store_index);
+  }
   return body->centroid;
 }
 
 vector_t body_get_velocity(body_t *body) {
+  if (body->store != NULL) {
+    return body_store_get_velocity(body->store, body->store_index);
+  }
   return body->velocity;
 }
 
@@ -71,10 +215,16 @@ double body_get_orientation(body_t *body) {
 }
 
 vector_t body_get_force(body_t *body){
+  if (body->store != NULL) {
+    return body_store_get_force(body->store, body->store_index);
+  }
   return body->force;
 }
 
 vector_t body_get_impulse(body_t *body){
+  if (body->store != NULL) {
+    return body_store_get_impulse(body->store, body->store_index);
+  }
   return body->impulse;
 }
 
@@ -83,13 +233,26 @@ void *body_get_info(body_t *body){
 }
 
 void body_set_centroid(body_t *body, vector_t x) {
-  double x_disp = x.x - body->centroid.x;
-  double y_disp = x.y - body->centroid.y;
+  if (body->store != NULL) {
+    body_store_set_centroid(body->store, body->store_index, x);
+    return;
+  }
   body->centroid = x;
-  polygon_translate(body->shape, (vector_t) {x_disp, y_disp});
+}
+
+void body_teleport(body_t *body, vector_t x) {
+  body_set_centroid(body, x);
+  body_save_previous_state(body);
 }
 
 void body_set_velocity(body_t *body, vector_t v) {
+  if (body->asleep && (v.x != 0.0 || v.y != 0.0)) {
+    body_set_asleep(body, false);
+  }
+  if (body->store != NULL) {
+    body_store_set_velocity(body->store, body->store_index, v);
+    return;
+  }
   body->velocity = v;
 }
 
@@ -99,9 +262,16 @@ void body_set_color(body_t *body, rgb_color_t c) {
 
 void body_set_mass(body_t *body, double mass) {
   body->mass = mass;
+  if (body->store != NULL) {
+    body_store_set_mass(body->store, body->store_index, mass);
+  }
 }
 
 void body_set_force(body_t *body, vector_t force) {
+  if (body->store != NULL) {
+    body_store_set_force(body->store, body->store_index, force);
+    return;
+  }
   body->force = force;
 }
 
@@ -109,12 +279,16 @@ bool body_equals(body_t *body1, body_t *body2) {
     rgb_color_t c1 = body_get_color(body1);
     rgb_color_t c2 = body_get_color(body2);
     if (!(c1.r == c2.r && c1.g == c2.g && c1.b ==
-      c2.b) || list_size(body1->shape) != list_size(body2->shape)) {
+      c2.b) || shape_size(&body1->local_shape) !=
+      shape_size(&body2->local_shape)) {
         return false;
     }
-    for (size_t j = 0; j < list_size(body1->shape); j++) {
-        vector_t v1 = *(vector_t *)list_get(body1->shape, j);
-        vector_t v2 = *(vector_t *)list_get(body2->shape, j);
+    const vector_t *points1 = shape_const_points(body_get_vertices(body1));
+    const vector_t *points2 =
+      shape_const_points(body_get_vertices(body2));
+    for (size_t j = 0; j < shape_size(&body1->local_shape); j++) {
+        vector_t v1 = points1[j];
+        vector_t v2 = points2[j];
         if (v1.x != v2.x || v1.y != v2.y) {
             return false;
         }
@@ -123,39 +297,95 @@ bool body_equals(body_t *body1, body_t *body2) {
 }
 
 void body_set_rotation(body_t *body, double angle) {
-  polygon_rotate(body->shape, angle - body->orientation, body->centroid);
-  body->centroid = polygon_centroid(body->shape);
+  // The local shape is centered on the centroid, so rotating about it
+  // leaves the centroid unchanged
   body->orientation = angle;
 }
+void body_set_category(body_t *body, unsigned int category) {
+  body->category = category;
+}
+
 void body_set_info (body_t *body, void *info){
   body->info = info;
 }
 
 void body_add_force(body_t *body, vector_t force) {
-  body->force = vec_add(body->force, force);
+  body_set_force(body, vec_add(body_get_force(body), force));
 }
 
 void body_add_impulse(body_t *body, vector_t impulse) {
+  if (body->asleep && (impulse.x != 0.0 || impulse.y != 0.0)) {
+    body_set_asleep(body, false);
+  }
+  if (body->store != NULL) {
+    body_store_set_impulse(body->store, body->store_index,
+      vec_add(body_get_impulse(body), impulse));
+    return;
+  }
   body->impulse = vec_add(body->impulse, impulse);
 }
 
 void body_tick(body_t *body, double dt) {
+  vector_t force = body_get_force(body);
+  vector_t impulse = body_get_impulse(body);
+  vector_t velocity = body_get_velocity(body);
+
   // Adds force
-  double new_x = (body->force.x * dt)/ body->mass + body->velocity.x;
-  double new_y = (body->force.y * dt)/ body->mass + body->velocity.y;
+  double new_x = (force.x * dt)/ body->mass + velocity.x;
+  double new_y = (force.y * dt)/ body->mass + velocity.y;
 
   // Adds impulse
-  new_x += body->impulse.x/ body->mass;
-  new_y += body->impulse.y/ body->mass;
+  new_x += impulse.x/ body->mass;
+  new_y += impulse.y/ body->mass;
 
   // Translates body based on average of before and after velocity
-  double x_disp = (body->velocity.x + new_x) / 2.0 * dt;
-  double y_disp = (body->velocity.y + new_y) / 2.0 * dt;
-  body_set_centroid(body, vec_add(body->centroid, (vector_t) {x_disp, y_disp}));
+  double x_disp = (velocity.x + new_x) / 2.0 * dt;
+  double y_disp = (velocity.y + new_y) / 2.0 * dt;
+  body_set_centroid(body, vec_add(body_get_centroid(body),
+    (vector_t) {x_disp, y_disp}));
+
+  body_set_velocity(body, (vector_t) {new_x, new_y});
+  body_set_force(body, VEC_ZERO);
+  if (body->store != NULL) {
+    body_store_set_impulse(body->store, body->store_index, VEC_ZERO);
+  }
+  else {
+    body->impulse = VEC_ZERO;
+  }
+}
+
+void body_set_asleep(body_t *body, bool asleep) {
+  if (asleep == body->asleep) {
+    return;
+  }
+  body->asleep = asleep;
+  body->sleep_time = 0.0;
+  if (asleep) {
+    // Only awake bodies are integrated, so the store is left to them
+    if (body->store != NULL) {
+      body->sleep_store = body->store;
+      body_store_remove(body->store, body);
+    }
+    body->velocity = VEC_ZERO;
+    body->force = VEC_ZERO;
+    body->impulse = VEC_ZERO;
+  }
+  else if (body->sleep_store != NULL) {
+    body_store_add(body->sleep_store, body);
+    body->sleep_store = NULL;
+  }
+}
+
+bool body_is_asleep(body_t *body) {
+  return body->asleep;
+}
+
+void body_set_bullet(body_t *body, bool bullet) {
+  body->bullet = bullet;
+}
 
-  body->velocity = (vector_t) {new_x, new_y};
-  body->force = (vector_t) {0, 0};
-  body->impulse = (vector_t) {0, 0};
+bool body_is_bullet(body_t *body) {
+  return body->bullet;
 }
 
 void body_remove(body_t *body){
@@ -0,0 +1,384 @@
+#include "body_store.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "body.h"
+#include "vector.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BODY_STORE_X86
+#include <immintrin.h>
+#endif
+
+// Number of doubles per alignment unit; capacities are rounded up to this
+const size_t STORE_LANES = BODY_STORE_ALIGNMENT / sizeof(double);
+
+typedef struct body_store {
+  size_t size;
+  size_t capacity;
+  double *pos_x;
+  double *pos_y;
+  double *vel_x;
+  double *vel_y;
+  double *force_x;
+  double *force_y;
+  double *impulse_x;
+  double *impulse_y;
+  double *mass;
+  // the body occupying each slot, for fixing up indices on removal
+  body_t **bodies;
+} body_store_t;
+
+/**
+ * Allocates an aligned array of doubles, copying over the first size
+ * elements of old (which is freed) if it is non-NULL.
+ */
+static double *store_array(double *old, size_t size, size_t capacity) {
+  double *array = aligned_alloc(BODY_STORE_ALIGNMENT,
+    capacity * sizeof(double));
+  assert(array != NULL);
+  if (old != NULL) {
+    memcpy(array, old, size * sizeof(double));
+    free(old);
+  }
+  return array;
+}
+
+/**
+ * Grows every array in the store to hold at least capacity bodies.
+ */
+static void store_reserve(body_store_t *store, size_t capacity) {
+  // Keeps each array a whole number of SIMD lanes long
+  capacity = (capacity + STORE_LANES - 1) / STORE_LANES * STORE_LANES;
+  if (capacity == 0) {
+    capacity = STORE_LANES;
+  }
+  size_t size = store->size;
+  store->pos_x = store_array(store->pos_x, size, capacity);
+  store->pos_y = store_array(store->pos_y, size, capacity);
+  store->vel_x = store_array(store->vel_x, size, capacity);
+  store->vel_y = store_array(store->vel_y, size, capacity);
+  store->force_x = store_array(store->force_x, size, capacity);
+  store->force_y = store_array(store->force_y, size, capacity);
+  store->impulse_x = store_array(store->impulse_x, size, capacity);
+  store->impulse_y = store_array(store->impulse_y, size, capacity);
+  store->mass = store_array(store->mass, size, capacity);
+  store->bodies = realloc(store->bodies, capacity * sizeof(body_t *));
+  assert(store->bodies != NULL);
+  store->capacity = capacity;
+}
+
+body_store_t *body_store_init(size_t initial_capacity) {
+  body_store_t *store = malloc(sizeof(body_store_t));
+  assert(store != NULL);
+  memset(store, 0, sizeof(body_store_t));
+  store_reserve(store, initial_capacity);
+  return store;
+}
+
+void body_store_free(body_store_t *store) {
+  while (store->size > 0) {
+    body_store_remove(store, store->bodies[store->size - 1]);
+  }
+  free(store->pos_x);
+  free(store->pos_y);
+  free(store->vel_x);
+  free(store->vel_y);
+  free(store->force_x);
+  free(store->force_y);
+  free(store->impulse_x);
+  free(store->impulse_y);
+  free(store->mass);
+  free(store->bodies);
+  free(store);
+}
+
+size_t body_store_size(body_store_t *store) {
+  return store->size;
+}
+
+void body_store_add(body_store_t *store, body_t *body) {
+  assert(body->store == NULL);
+  if (store->size == store->capacity) {
+    store_reserve(store, 2 * store->capacity);
+  }
+  size_t i = store->size;
+  store->pos_x[i] = body->centroid.x;
+  store->pos_y[i] = body->centroid.y;
+  store->vel_x[i] = body->velocity.x;
+  store->vel_y[i] = body->velocity.y;
+  store->force_x[i] = body->force.x;
+  store->force_y[i] = body->force.y;
+  store->impulse_x[i] = body->impulse.x;
+  store->impulse_y[i] = body->impulse.y;
+  store->mass[i] = body->mass;
+  store->bodies[i] = body;
+  store->size++;
+  body->store = store;
+  body->store_index = i;
+}
+
+void body_store_remove(body_store_t *store, body_t *body) {
+  assert(body->store == store);
+  size_t i = body->store_index;
+  body->centroid = body_store_get_centroid(store, i);
+  body->velocity = body_store_get_velocity(store, i);
+  body->force = body_store_get_force(store, i);
+  body->impulse = body_store_get_impulse(store, i);
+  body->store = NULL;
+
+  // Moves the last slot into the hole
+  size_t last = store->size - 1;
+  if (i != last) {
+    store->pos_x[i] = store->pos_x[last];
+    store->pos_y[i] = store->pos_y[last];
+    store->vel_x[i] = store->vel_x[last];
+    store->vel_y[i] = store->vel_y[last];
+    store->force_x[i] = store->force_x[last];
+    store->force_y[i] = store->force_y[last];
+    store->impulse_x[i] = store->impulse_x[last];
+    store->impulse_y[i] = store->impulse_y[last];
+    store->mass[i] = store->mass[last];
+    store->bodies[i] = store->bodies[last];
+    store->bodies[i]->store_index = i;
+  }
+  store->size--;
+}
+
+typedef void (*integrate_func_t)(body_store_t *store, size_t begin,
+  size_t end, double dt);
+
+/**
+ * The reference integrator. It does the same operations in the same order
+ * as body_tick(), so a body gives bit-identical results in or out of a store.
+ */
+static void integrate_scalar(body_store_t *store, size_t begin, size_t end,
+  double dt) {
+  double *restrict px = store->pos_x;
+  double *restrict py = store->pos_y;
+  double *restrict vx = store->vel_x;
+  double *restrict vy = store->vel_y;
+  double *restrict fx = store->force_x;
+  double *restrict fy = store->force_y;
+  double *restrict jx = store->impulse_x;
+  double *restrict jy = store->impulse_y;
+  const double *restrict m = store->mass;
+  for (size_t i = begin; i < end; i++) {
+    double new_x = (fx[i] * dt) / m[i] + vx[i];
+    double new_y = (fy[i] * dt) / m[i] + vy[i];
+    new_x += jx[i] / m[i];
+    new_y += jy[i] / m[i];
+    px[i] += (vx[i] + new_x) / 2.0 * dt;
+    py[i] += (vy[i] + new_y) / 2.0 * dt;
+    vx[i] = new_x;
+    vy[i] = new_y;
+    fx[i] = 0.0;
+    fy[i] = 0.0;
+    jx[i] = 0.0;
+    jy[i] = 0.0;
+  }
+}
+
+#ifdef BODY_STORE_X86
+/**
+ * Integrates two bodies per instruction, like integrate_scalar().
+ * Halving by multiplying by 0.5 is exact, so it matches dividing by 2.
+ */
+__attribute__((target("sse2")))
+static void integrate_sse2(body_store_t *store, size_t begin, size_t end,
+  double dt) {
+  double *restrict px = store->pos_x;
+  double *restrict py = store->pos_y;
+  double *restrict vx = store->vel_x;
+  double *restrict vy = store->vel_y;
+  double *restrict fx = store->force_x;
+  double *restrict fy = store->force_y;
+  double *restrict jx = store->impulse_x;
+  double *restrict jy = store->impulse_y;
+  const double *restrict mass = store->mass;
+  __m128d vdt = _mm_set1_pd(dt);
+  __m128d half = _mm_set1_pd(0.5);
+  __m128d zero = _mm_setzero_pd();
+  size_t i = begin;
+  for (; i + 2 <= end; i += 2) {
+    __m128d m = _mm_load_pd(mass + i);
+    __m128d old_x = _mm_load_pd(vx + i);
+    __m128d old_y = _mm_load_pd(vy + i);
+    // v' = (f * dt) / m + v + j / m
+    __m128d new_x = _mm_add_pd(_mm_add_pd(
+      _mm_div_pd(_mm_mul_pd(_mm_load_pd(fx + i), vdt), m), old_x),
+      _mm_div_pd(_mm_load_pd(jx + i), m));
+    __m128d new_y = _mm_add_pd(_mm_add_pd(
+      _mm_div_pd(_mm_mul_pd(_mm_load_pd(fy + i), vdt), m), old_y),
+      _mm_div_pd(_mm_load_pd(jy + i), m));
+    // p' = p + (v + v') / 2 * dt
+    _mm_store_pd(px + i, _mm_add_pd(_mm_load_pd(px + i),
+      _mm_mul_pd(_mm_mul_pd(_mm_add_pd(old_x, new_x), half), vdt)));
+    _mm_store_pd(py + i, _mm_add_pd(_mm_load_pd(py + i),
+      _mm_mul_pd(_mm_mul_pd(_mm_add_pd(old_y, new_y), half), vdt)));
+    _mm_store_pd(vx + i, new_x);
+    _mm_store_pd(vy + i, new_y);
+    _mm_store_pd(fx + i, zero);
+    _mm_store_pd(fy + i, zero);
+    _mm_store_pd(jx + i, zero);
+    _mm_store_pd(jy + i, zero);
+  }
+  integrate_scalar(store, i, end, dt);
+}
+
+/**
+ * Integrates four bodies per instruction, like integrate_sse2().
+ */
+__attribute__((target("avx2")))
+static void integrate_avx2(body_store_t *store, size_t begin, size_t end,
+  double dt) {
+  double *restrict px = store->pos_x;
+  double *restrict py = store->pos_y;
+  double *restrict vx = store->vel_x;
+  double *restrict vy = store->vel_y;
+  double *restrict fx = store->force_x;
+  double *restrict fy = store->force_y;
+  double *restrict jx = store->impulse_x;
+  double *restrict jy = store->impulse_y;
+  const double *restrict mass = store->mass;
+  __m256d vdt = _mm256_set1_pd(dt);
+  __m256d half = _mm256_set1_pd(0.5);
+  __m256d zero = _mm256_setzero_pd();
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m256d m = _mm256_load_pd(mass + i);
+    __m256d old_x = _mm256_load_pd(vx + i);
+    __m256d old_y = _mm256_load_pd(vy + i);
+    __m256d new_x = _mm256_add_pd(_mm256_add_pd(
+      _mm256_div_pd(_mm256_mul_pd(_mm256_load_pd(fx + i), vdt), m), old_x),
+      _mm256_div_pd(_mm256_load_pd(jx + i), m));
+    __m256d new_y = _mm256_add_pd(_mm256_add_pd(
+      _mm256_div_pd(_mm256_mul_pd(_mm256_load_pd(fy + i), vdt), m), old_y),
+      _mm256_div_pd(_mm256_load_pd(jy + i), m));
+    _mm256_store_pd(px + i, _mm256_add_pd(_mm256_load_pd(px + i),
+      _mm256_mul_pd(_mm256_mul_pd(_mm256_add_pd(old_x, new_x), half), vdt)));
+    _mm256_store_pd(py + i, _mm256_add_pd(_mm256_load_pd(py + i),
+      _mm256_mul_pd(_mm256_mul_pd(_mm256_add_pd(old_y, new_y), half), vdt)));
+    _mm256_store_pd(vx + i, new_x);
+    _mm256_store_pd(vy + i, new_y);
+    _mm256_store_pd(fx + i, zero);
+    _mm256_store_pd(fy + i, zero);
+    _mm256_store_pd(jx + i, zero);
+    _mm256_store_pd(jy + i, zero);
+  }
+  // Avoids the penalty for mixing in SSE2 code with dirty upper halves
+  _mm256_zeroupper();
+  integrate_sse2(store, i, end, dt);
+}
+#endif
+
+static body_store_kernel_t kernel = BODY_STORE_SCALAR;
+static integrate_func_t kernel_func = integrate_scalar;
+static pthread_once_t kernel_chosen = PTHREAD_ONCE_INIT;
+
+static integrate_func_t find_kernel_func(body_store_kernel_t choice) {
+  switch (choice) {
+#ifdef BODY_STORE_X86
+    case BODY_STORE_SSE2:
+      return integrate_sse2;
+    case BODY_STORE_AVX2:
+      return integrate_avx2;
+#endif
+    default:
+      return integrate_scalar;
+  }
+}
+
+/**
+ * Picks the widest kernel the CPU supports, once per process.
+ */
+static void choose_kernel(void) {
+  if (body_store_kernel_supported(BODY_STORE_AVX2)) {
+    kernel = BODY_STORE_AVX2;
+  }
+  else if (body_store_kernel_supported(BODY_STORE_SSE2)) {
+    kernel = BODY_STORE_SSE2;
+  }
+  kernel_func = find_kernel_func(kernel);
+}
+
+void body_store_integrate(body_store_t *store, double dt) {
+  body_store_integrate_range(store, 0, store->size, dt);
+}
+
+void body_store_integrate_range(body_store_t *store, size_t begin, size_t end,
+  double dt) {
+  assert(begin % STORE_LANES == 0 && begin <= end && end <= store->size);
+  pthread_once(&kernel_chosen, choose_kernel);
+  kernel_func(store, begin, end, dt);
+}
+
+bool body_store_kernel_supported(body_store_kernel_t choice) {
+#ifdef BODY_STORE_X86
+  __builtin_cpu_init();
+  switch (choice) {
+    case BODY_STORE_SCALAR:
+      return true;
+    case BODY_STORE_SSE2:
+      return __builtin_cpu_supports("sse2");
+    case BODY_STORE_AVX2:
+      return __builtin_cpu_supports("avx2");
+  }
+  return false;
+#else
+  return choice == BODY_STORE_SCALAR;
+#endif
+}
+
+body_store_kernel_t body_store_get_kernel(void) {
+  pthread_once(&kernel_chosen, choose_kernel);
+  return kernel;
+}
+
+void body_store_set_kernel(body_store_kernel_t choice) {
+  assert(body_store_kernel_supported(choice));
+  pthread_once(&kernel_chosen, choose_kernel);
+  kernel = choice;
+  kernel_func = find_kernel_func(choice);
+}
+
+vector_t body_store_get_centroid(body_store_t *store, size_t index) {
+  return (vector_t) {store->pos_x[index], store->pos_y[index]};
+}
+
+vector_t body_store_get_velocity(body_store_t *store, size_t index) {
+  return (vector_t) {store->vel_x[index], store->vel_y[index]};
+}
+
+vector_t body_store_get_force(body_store_t *store, size_t index) {
+  return (vector_t) {store->force_x[index], store->force_y[index]};
+}
+
+vector_t body_store_get_impulse(body_store_t *store, size_t index) {
+  return (vector_t) {store->impulse_x[index], store->impulse_y[index]};
+}
+
+void body_store_set_centroid(body_store_t *store, size_t index, vector_t x) {
+  store->pos_x[index] = x.x;
+  store->pos_y[index] = x.y;
+}
+
+void body_store_set_velocity(body_store_t *store, size_t index, vector_t v) {
+  store->vel_x[index] = v.x;
+  store->vel_y[index] = v.y;
+}
+
+void body_store_set_force(body_store_t *store, size_t index, vector_t force) {
+  store->force_x[index] = force.x;
+  store->force_y[index] = force.y;
+}
+
+void body_store_set_impulse(body_store_t *store, size_t index,
+  vector_t impulse) {
+  store->impulse_x[index] = impulse.x;
+  store->impulse_y[index] = impulse.y;
+}
+
+void body_store_set_mass(body_store_t *store, size_t index, double mass) {
+  store->mass[index] = mass;
+}
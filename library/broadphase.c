@@ -0,0 +1,358 @@
+#include "broadphase.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aabb.h"
+#include "aabb_tree.h"
+#include "body.h"
+#include "list.h"
+
+// Bodies covering more cells than this are tested against everything instead
+const size_t GRID_MAX_CELLS = 256;
+
+typedef enum {
+  BROADPHASE_GRID,
+  BROADPHASE_TREE
+} broadphase_kind_t;
+
+/**
+ * One (cell, body) incidence in the grid.
+ */
+typedef struct {
+  int64_t cx;
+  int64_t cy;
+  size_t item;
+} grid_entry_t;
+
+typedef struct broadphase {
+  broadphase_kind_t kind;
+  double cell_size;
+
+  // bodies seen by the last update and their boxes and first cells
+  size_t item_count;
+  size_t item_capacity;
+  body_t **items;
+  aabb_t *boxes;
+  int64_t *first_cx;
+  int64_t *first_cy;
+  bool *oversized;
+
+  // (cell, body) entries, and the same entries grouped by hash bucket
+  size_t entry_count;
+  size_t entry_capacity;
+  grid_entry_t *entries;
+  size_t sorted_capacity;
+  grid_entry_t *sorted;
+  size_t bucket_capacity;
+  size_t *bucket_starts;
+
+  size_t pair_count;
+  size_t pair_capacity;
+  body_pair_t *pairs;
+
+  // tree broadphase state
+  aabb_tree_t *tree;
+  double margin;
+  // per leaf id: the update that last saw it, and its item index then
+  size_t stamp;
+  size_t proxy_capacity;
+  size_t *proxy_stamps;
+  size_t *proxy_items;
+  // the item whose pairs are being collected
+  size_t query_item;
+} broadphase_t;
+
+/**
+ * Grows a buffer to hold at least needed elements of the given size,
+ * doubling so that repeated updates stop allocating once warmed up.
+ */
+static void *reserve(void *buffer, size_t *capacity, size_t needed,
+  size_t elem_size) {
+  if (needed <= *capacity) {
+    return buffer;
+  }
+  size_t new_capacity = *capacity * 2 + 1;
+  if (new_capacity < needed) {
+    new_capacity = needed;
+  }
+  buffer = realloc(buffer, new_capacity * elem_size);
+  assert(buffer != NULL);
+  *capacity = new_capacity;
+  return buffer;
+}
+
+broadphase_t *broadphase_init_grid(double cell_size) {
+  assert(cell_size > 0);
+  broadphase_t *bp = malloc(sizeof(broadphase_t));
+  assert(bp != NULL);
+  memset(bp, 0, sizeof(broadphase_t));
+  bp->kind = BROADPHASE_GRID;
+  bp->cell_size = cell_size;
+  return bp;
+}
+
+broadphase_t *broadphase_init_tree(double margin) {
+  assert(margin >= 0);
+  broadphase_t *bp = malloc(sizeof(broadphase_t));
+  assert(bp != NULL);
+  memset(bp, 0, sizeof(broadphase_t));
+  bp->kind = BROADPHASE_TREE;
+  bp->tree = aabb_tree_init();
+  bp->margin = margin;
+  return bp;
+}
+
+void broadphase_free(broadphase_t *bp) {
+  if (bp->tree != NULL) {
+    aabb_tree_free(bp->tree);
+  }
+  free(bp->proxy_stamps);
+  free(bp->proxy_items);
+  free(bp->items);
+  free(bp->boxes);
+  free(bp->first_cx);
+  free(bp->first_cy);
+  free(bp->oversized);
+  free(bp->entries);
+  free(bp->sorted);
+  free(bp->bucket_starts);
+  free(bp->pairs);
+  free(bp);
+}
+
+/**
+ * Appends a candidate pair to the output.
+ */
+static void add_pair(broadphase_t *bp, body_t *body1, body_t *body2) {
+  bp->pairs = reserve(bp->pairs, &bp->pair_capacity, bp->pair_count + 1,
+    sizeof(body_pair_t));
+  bp->pairs[bp->pair_count] = (body_pair_t) {body1, body2};
+  bp->pair_count++;
+}
+
+/**
+ * Hashes a cell coordinate into one of bucket_count buckets,
+ * where bucket_count is a power of two.
+ */
+static size_t cell_hash(int64_t cx, int64_t cy, size_t bucket_count) {
+  uint64_t h = (uint64_t) cx * 73856093u ^ (uint64_t) cy * 19349663u;
+  return (size_t) (h ^ (h >> 29)) & (bucket_count - 1);
+}
+
+/**
+ * Grows every per-body array to hold at least n bodies.
+ */
+static void reserve_items(broadphase_t *bp, size_t n) {
+  if (n <= bp->item_capacity) {
+    return;
+  }
+  size_t capacity = bp->item_capacity * 2 + 1;
+  if (capacity < n) {
+    capacity = n;
+  }
+  bp->items = realloc(bp->items, capacity * sizeof(body_t *));
+  bp->boxes = realloc(bp->boxes, capacity * sizeof(aabb_t));
+  bp->first_cx = realloc(bp->first_cx, capacity * sizeof(int64_t));
+  bp->first_cy = realloc(bp->first_cy, capacity * sizeof(int64_t));
+  bp->oversized = realloc(bp->oversized, capacity * sizeof(bool));
+  assert(bp->items != NULL && bp->boxes != NULL && bp->first_cx != NULL &&
+    bp->first_cy != NULL && bp->oversized != NULL);
+  bp->item_capacity = capacity;
+}
+
+/**
+ * Copies the live bodies and their bounding boxes into the item arrays.
+ */
+static void collect_items(broadphase_t *bp, list_t *bodies) {
+  size_t n = list_size(bodies);
+  reserve_items(bp, n);
+  bp->item_count = 0;
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = list_get(bodies, i);
+    if (body_is_removed(body)) {
+      continue;
+    }
+    bp->items[bp->item_count] = body;
+    bp->boxes[bp->item_count] = body_get_aabb(body);
+    bp->item_count++;
+  }
+}
+
+/**
+ * Rebuilds the spatial hash and emits every overlapping pair once.
+ * A pair sharing several cells is only reported from the cell that holds
+ * the lower-left corner of the intersection of their boxes.
+ */
+static void grid_update(broadphase_t *bp) {
+  double cell = bp->cell_size;
+  bp->entry_count = 0;
+  for (size_t i = 0; i < bp->item_count; i++) {
+    aabb_t box = bp->boxes[i];
+    int64_t x0 = (int64_t) floor(box.min.x / cell);
+    int64_t y0 = (int64_t) floor(box.min.y / cell);
+    int64_t x1 = (int64_t) floor(box.max.x / cell);
+    int64_t y1 = (int64_t) floor(box.max.y / cell);
+    bp->first_cx[i] = x0;
+    bp->first_cy[i] = y0;
+    size_t cells = (size_t) (x1 - x0 + 1) * (size_t) (y1 - y0 + 1);
+    bp->oversized[i] = cells > GRID_MAX_CELLS;
+    if (bp->oversized[i]) {
+      continue;
+    }
+    bp->entries = reserve(bp->entries, &bp->entry_capacity,
+      bp->entry_count + cells, sizeof(grid_entry_t));
+    for (int64_t cx = x0; cx <= x1; cx++) {
+      for (int64_t cy = y0; cy <= y1; cy++) {
+        bp->entries[bp->entry_count] = (grid_entry_t) {cx, cy, i};
+        bp->entry_count++;
+      }
+    }
+  }
+
+  // Groups the entries by bucket with a counting sort
+  size_t bucket_count = 16;
+  while (bucket_count < 2 * bp->entry_count) {
+    bucket_count *= 2;
+  }
+  bp->bucket_starts = reserve(bp->bucket_starts, &bp->bucket_capacity,
+    bucket_count + 1, sizeof(size_t));
+  bp->sorted = reserve(bp->sorted, &bp->sorted_capacity, bp->entry_count,
+    sizeof(grid_entry_t));
+  memset(bp->bucket_starts, 0, (bucket_count + 1) * sizeof(size_t));
+  for (size_t e = 0; e < bp->entry_count; e++) {
+    grid_entry_t entry = bp->entries[e];
+    bp->bucket_starts[cell_hash(entry.cx, entry.cy, bucket_count) + 1]++;
+  }
+  for (size_t b = 0; b < bucket_count; b++) {
+    bp->bucket_starts[b + 1] += bp->bucket_starts[b];
+  }
+  for (size_t e = 0; e < bp->entry_count; e++) {
+    grid_entry_t entry = bp->entries[e];
+    size_t b = cell_hash(entry.cx, entry.cy, bucket_count);
+    // bucket_starts[b] is used as the insertion cursor for bucket b
+    bp->sorted[bp->bucket_starts[b]] = entry;
+    bp->bucket_starts[b]++;
+  }
+
+  // After the scatter, bucket b spans [starts[b - 1], starts[b])
+  size_t start = 0;
+  for (size_t b = 0; b < bucket_count; b++) {
+    size_t end = bp->bucket_starts[b];
+    for (size_t i = start; i < end; i++) {
+      grid_entry_t a = bp->sorted[i];
+      for (size_t j = i + 1; j < end; j++) {
+        grid_entry_t c = bp->sorted[j];
+        if (a.cx != c.cx || a.cy != c.cy ||
+          !aabb_overlaps(bp->boxes[a.item], bp->boxes[c.item])) {
+          continue;
+        }
+        int64_t owner_x = bp->first_cx[a.item] > bp->first_cx[c.item] ?
+          bp->first_cx[a.item] : bp->first_cx[c.item];
+        int64_t owner_y = bp->first_cy[a.item] > bp->first_cy[c.item] ?
+          bp->first_cy[a.item] : bp->first_cy[c.item];
+        if (a.cx == owner_x && a.cy == owner_y) {
+          add_pair(bp, bp->items[a.item], bp->items[c.item]);
+        }
+      }
+    }
+    start = end;
+  }
+
+  // Oversized bodies are tested against every other body directly
+  for (size_t i = 0; i < bp->item_count; i++) {
+    if (!bp->oversized[i]) {
+      continue;
+    }
+    for (size_t j = 0; j < bp->item_count; j++) {
+      if (j == i || (bp->oversized[j] && j < i)) {
+        continue;
+      }
+      if (aabb_overlaps(bp->boxes[i], bp->boxes[j])) {
+        add_pair(bp, bp->items[i], bp->items[j]);
+      }
+    }
+  }
+}
+
+/**
+ * Records a pair for every leaf found overlapping the query item
+ * that comes after it, so each pair is reported once.
+ */
+static bool tree_pair_visitor(void *aux, int proxy) {
+  broadphase_t *bp = aux;
+  size_t other = bp->proxy_items[proxy];
+  size_t item = bp->query_item;
+  if (other > item && aabb_overlaps(bp->boxes[item], bp->boxes[other])) {
+    add_pair(bp, bp->items[item], bp->items[other]);
+  }
+  return true;
+}
+
+/**
+ * Moves every live body's leaf, inserts new bodies, removes leaves of bodies
+ * that are gone, and then queries the tree once per body.
+ */
+static void tree_update(broadphase_t *bp) {
+  aabb_tree_t *tree = bp->tree;
+  bp->stamp++;
+  for (size_t i = 0; i < bp->item_count; i++) {
+    body_t *body = bp->items[i];
+    int proxy = body->broadphase_proxy;
+    if (aabb_tree_is_leaf(tree, proxy) &&
+      aabb_tree_get_data(tree, proxy) == body) {
+      aabb_tree_move(tree, proxy, bp->boxes[i], bp->margin);
+    }
+    else {
+      proxy = aabb_tree_insert(tree, aabb_expand(bp->boxes[i], bp->margin),
+        body);
+      body->broadphase_proxy = proxy;
+    }
+    size_t capacity = aabb_tree_capacity(tree);
+    if (capacity > bp->proxy_capacity) {
+      bp->proxy_stamps = realloc(bp->proxy_stamps, capacity * sizeof(size_t));
+      bp->proxy_items = realloc(bp->proxy_items, capacity * sizeof(size_t));
+      assert(bp->proxy_stamps != NULL && bp->proxy_items != NULL);
+      memset(bp->proxy_stamps + bp->proxy_capacity, 0,
+        (capacity - bp->proxy_capacity) * sizeof(size_t));
+      bp->proxy_capacity = capacity;
+    }
+    bp->proxy_stamps[proxy] = bp->stamp;
+    bp->proxy_items[proxy] = i;
+  }
+
+  // Removes leaves whose bodies were not in this update
+  for (size_t proxy = 0; proxy < bp->proxy_capacity; proxy++) {
+    if (aabb_tree_is_leaf(tree, (int) proxy) &&
+      bp->proxy_stamps[proxy] != bp->stamp) {
+      aabb_tree_remove(tree, (int) proxy);
+    }
+  }
+
+  for (size_t i = 0; i < bp->item_count; i++) {
+    bp->query_item = i;
+    aabb_tree_query(tree, bp->boxes[i], tree_pair_visitor, bp);
+  }
+}
+
+void broadphase_update(broadphase_t *bp, list_t *bodies) {
+  collect_items(bp, bodies);
+  bp->pair_count = 0;
+  switch (bp->kind) {
+    case BROADPHASE_GRID:
+      grid_update(bp);
+      break;
+    case BROADPHASE_TREE:
+      tree_update(bp);
+      break;
+  }
+}
+
+size_t broadphase_pair_count(broadphase_t *bp) {
+  return bp->pair_count;
+}
+
+body_pair_t *broadphase_pairs(broadphase_t *bp) {
+  return bp->pairs;
+}
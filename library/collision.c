@@ -3,37 +3,658 @@
 #include "list.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include "aabb.h"
 #include "body.h"
+#include "gjk.h"
+#include "projection.h"
+#include "shape.h"
 #include "vector.h"
 #include <assert.h>
 #include <math.h>
 
-const int LARGE = INFINITY;
+const double LARGE = INFINITY;
+const double TOI_SLOP = 1e-3;
 
-collision_info_t find_collision(list_t *shape1, list_t *shape2) {
-  list_t *axes = get_axes2(shape1, shape2);
+/**
+ * Projects a packed vertex array onto a line in a single pass.
+ * The dot products are written out rather than calling vec_dot(), which
+ * lives in another file and so cannot be inlined into the loop.
+ */
+static void points_proj(const vector_t *points, size_t n, vector_t line,
+  double *min, double *max) {
+  double lo = points[0].x * line.x + points[0].y * line.y;
+  double hi = lo;
+  for (size_t i = 1; i < n; i++) {
+    double proj = points[i].x * line.x + points[i].y * line.y;
+    if (proj < lo) {
+      lo = proj;
+    }
+    else if (proj > hi) {
+      hi = proj;
+    }
+  }
+  *min = lo;
+  *max = hi;
+}
+
+/**
+ * Records the overlap of two shapes' projections onto one axis if it is the
+ * smallest seen so far, with the axis turned to point from shape 1 to
+ * shape 2. The axis need not be normalized, so overlaps are compared as
+ * squared overlap per squared axis length, which needs no square root.
+ * Returns false if the axis separates the shapes.
+ */
+static bool test_extents(double min1, double max1, double min2, double max2,
+  vector_t axis, double *overlap, vector_t *collision_axis) {
+  if ((max2 < min1) || (max1 < min2)) {
+    return false;
+  }
+  // Pushing shape 2 forward along the axis, or back along it
+  double forward = max1 - min2;
+  double backward = max2 - min1;
+  double min = find_min(forward, backward);
+  double length_squared = vec_dot(axis, axis);
+  if (min * min < *overlap * length_squared) {
+    *overlap = min * min / length_squared;
+    *collision_axis = forward <= backward ? axis : vec_negate(axis);
+  }
+  return true;
+}
+
+/**
+ * Projects both shapes onto one axis and records their overlap, as
+ * test_extents() does.
+ */
+static bool test_axis(const vector_t *points1, size_t n1,
+  const vector_t *points2, size_t n2, vector_t axis, double *overlap,
+  vector_t *collision_axis) {
+  double min1, max1, min2, max2;
+  points_proj(points1, n1, axis, &min1, &max1);
+  points_proj(points2, n2, axis, &min2, &max2);
+  return test_extents(min1, max1, min2, max2, axis, overlap, collision_axis);
+}
+
+/**
+ * Tests every edge normal of the reference polygon against both shapes.
+ * The normals are computed on the fly, so no axis list is allocated.
+ * If one of them separates the shapes, it is stored in separating_axis.
+ */
+static bool test_edges(const vector_t *ref, size_t n_ref,
+  const vector_t *points1, size_t n1, const vector_t *points2, size_t n2,
+  double *overlap, vector_t *collision_axis, vector_t *separating_axis) {
+  for (size_t i = 0; i < n_ref; i++) {
+    vector_t normal = edge_perp(vec_subtract(ref[i], ref[(i + 1) % n_ref]));
+    if (!test_axis(points1, n1, points2, n2, normal, overlap,
+      collision_axis)) {
+      *separating_axis = normal;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Tests precomputed axes (e.g. a body's unique edge normals, see
+ * body_get_normals()) against both shapes, like test_edges().
+ * Each shape is projected onto every axis at once (see project_points()),
+ * which costs about as much as projecting it onto one or two.
+ */
+static bool test_normals(const vector_t *normals, size_t n_normals,
+  const vector_t *points1, size_t n1, const vector_t *points2, size_t n2,
+  double *overlap, vector_t *collision_axis, vector_t *separating_axis) {
+  // No axes separate the shapes, and a zero-length array is undefined
+  if (n_normals == 0) {
+    return true;
+  }
+  double min1[n_normals], max1[n_normals], min2[n_normals], max2[n_normals];
+  project_points(points1, n1, normals, n_normals, min1, max1);
+  project_points(points2, n2, normals, n_normals, min2, max2);
+  for (size_t i = 0; i < n_normals; i++) {
+    if (!test_extents(min1[i], max1[i], min2[i], max2[i], normals[i],
+      overlap, collision_axis)) {
+      *separating_axis = normals[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * An edge of a polygon, from start to end, and the vertex of the polygon
+ * that lies furthest along the direction the edge was picked for.
+ */
+typedef struct {
+  vector_t furthest;
+  vector_t start;
+  vector_t end;
+} feature_edge_t;
+
+/**
+ * Finds the edge of a polygon that faces a direction best: of the two edges
+ * meeting at the vertex furthest along the direction, the one closer to
+ * perpendicular to it. Works for either winding.
+ */
+static feature_edge_t best_edge(const vector_t *points, size_t n,
+  vector_t direction) {
+  size_t best = 0;
+  double max = vec_dot(points[0], direction);
+  for (size_t i = 1; i < n; i++) {
+    double proj = vec_dot(points[i], direction);
+    if (proj > max) {
+      max = proj;
+      best = i;
+    }
+  }
+  vector_t furthest = points[best];
+  vector_t prev = points[(best + n - 1) % n];
+  vector_t next = points[(best + 1) % n];
+  vector_t to_prev = vec_subtract(furthest, prev);
+  vector_t to_next = vec_subtract(furthest, next);
+  // Compares the cosines of both edges with the direction, squared
+  double along_prev = vec_dot(to_prev, direction);
+  double along_next = vec_dot(to_next, direction);
+  if (along_prev * along_prev * vec_dot(to_next, to_next) <=
+    along_next * along_next * vec_dot(to_prev, to_prev)) {
+    return (feature_edge_t) {furthest, prev, furthest};
+  }
+  return (feature_edge_t) {furthest, furthest, next};
+}
+
+/**
+ * Clips a segment to the half plane where the projection onto direction is
+ * at least offset, in place.
+ * Returns the number of points left, which is 2 unless the whole segment
+ * lies outside.
+ */
+static size_t clip_segment(vector_t *points, vector_t direction,
+  double offset) {
+  double dist1 = vec_dot(direction, points[0]) - offset;
+  double dist2 = vec_dot(direction, points[1]) - offset;
+  vector_t clipped[2];
+  size_t count = 0;
+  if (dist1 >= 0.0) {
+    clipped[count++] = points[0];
+  }
+  if (dist2 >= 0.0) {
+    clipped[count++] = points[1];
+  }
+  if (dist1 * dist2 < 0.0) {
+    vector_t edge = vec_subtract(points[1], points[0]);
+    clipped[count++] = vec_add(points[0],
+      vec_multiply(dist1 / (dist1 - dist2), edge));
+  }
+  for (size_t i = 0; i < count; i++) {
+    points[i] = clipped[i];
+  }
+  return count;
+}
+
+/**
+ * Fills in the contact points of a collision by clipping: the edge most
+ * perpendicular to the axis is the reference edge, the best edge of the
+ * other shape is clipped to the sides of it, and the clipped points that
+ * lie behind the reference edge are the contacts.
+ */
+static void find_contacts(const vector_t *points1, size_t n1,
+  const vector_t *points2, size_t n2, collision_info_t *info) {
+  feature_edge_t edge1 = best_edge(points1, n1, info->axis);
+  feature_edge_t edge2 = best_edge(points2, n2, vec_negate(info->axis));
+  vector_t dir1 = vec_subtract(edge1.end, edge1.start);
+  vector_t dir2 = vec_subtract(edge2.end, edge2.start);
+  double along1 = vec_dot(dir1, info->axis);
+  double along2 = vec_dot(dir2, info->axis);
+  bool flip = along1 * along1 * vec_dot(dir2, dir2) >
+    along2 * along2 * vec_dot(dir1, dir1);
+  feature_edge_t ref = flip ? edge2 : edge1;
+  feature_edge_t inc = flip ? edge1 : edge2;
+  vector_t ref_dir = flip ? dir2 : dir1;
+
+  vector_t contacts[2] = {inc.start, inc.end};
+  size_t count = clip_segment(contacts, ref_dir, vec_dot(ref_dir, ref.start));
+  if (count == 2) {
+    count = clip_segment(contacts, vec_negate(ref_dir),
+      -vec_dot(ref_dir, ref.end));
+  }
+  if (count < 2) {
+    // Degenerate edges; the deepest vertex is the best we can do
+    info->contacts[0] = inc.furthest;
+    info->contact_count = 1;
+    return;
+  }
+
+  // The outward normal of the reference edge
+  vector_t ref_normal = edge_perp(ref_dir);
+  if ((vec_dot(ref_normal, info->axis) < 0.0) != flip) {
+    ref_normal = vec_negate(ref_normal);
+  }
+  double face = vec_dot(ref_normal, ref.start);
+  info->contact_count = 0;
+  for (size_t i = 0; i < 2; i++) {
+    if (vec_dot(ref_normal, contacts[i]) <= face) {
+      info->contacts[info->contact_count++] = contacts[i];
+    }
+  }
+  if (info->contact_count == 0) {
+    info->contacts[0] = inc.furthest;
+    info->contact_count = 1;
+  }
+}
+
+// Polygons of up to this many vertices get specialized kernels, including
+// the 3- and 4-vertex pieces of the game's stars. From 7 vertices the
+// generic test's SIMD projections (see project_points()) are as fast as
+// the unrolled loops (see bench_sat_kernels). -DSAT_KERNEL_MAX_VERTICES=0
+// turns the kernels off; it must be a plain number no larger than
+// SAT_KERNEL_CEILING.
+#ifndef SAT_KERNEL_MAX_VERTICES
+#define SAT_KERNEL_MAX_VERTICES 6
+#endif
+#define SAT_KERNEL_CEILING 12
+#if SAT_KERNEL_MAX_VERTICES > SAT_KERNEL_CEILING
+#error "SAT_KERNEL_MAX_VERTICES is above SAT_KERNEL_CEILING"
+#endif
+
+// The ladder of vertex counts up to each cap, from 3 (the smallest
+// polygon). There are two copies so one can be expanded inside the other.
+#define SAT_KERNEL_UPTO_1_0(X, arg)
+#define SAT_KERNEL_UPTO_1_1(X, arg)
+#define SAT_KERNEL_UPTO_1_2(X, arg)
+#define SAT_KERNEL_UPTO_1_3(X, arg) X(arg, 3)
+#define SAT_KERNEL_UPTO_1_4(X, arg) SAT_KERNEL_UPTO_1_3(X, arg) X(arg, 4)
+#define SAT_KERNEL_UPTO_1_5(X, arg) SAT_KERNEL_UPTO_1_4(X, arg) X(arg, 5)
+#define SAT_KERNEL_UPTO_1_6(X, arg) SAT_KERNEL_UPTO_1_5(X, arg) X(arg, 6)
+#define SAT_KERNEL_UPTO_1_7(X, arg) SAT_KERNEL_UPTO_1_6(X, arg) X(arg, 7)
+#define SAT_KERNEL_UPTO_1_8(X, arg) SAT_KERNEL_UPTO_1_7(X, arg) X(arg, 8)
+#define SAT_KERNEL_UPTO_1_9(X, arg) SAT_KERNEL_UPTO_1_8(X, arg) X(arg, 9)
+#define SAT_KERNEL_UPTO_1_10(X, arg) SAT_KERNEL_UPTO_1_9(X, arg) X(arg, 10)
+#define SAT_KERNEL_UPTO_1_11(X, arg) SAT_KERNEL_UPTO_1_10(X, arg) X(arg, 11)
+#define SAT_KERNEL_UPTO_1_12(X, arg) SAT_KERNEL_UPTO_1_11(X, arg) X(arg, 12)
+#define SAT_KERNEL_UPTO_2_0(X, arg)
+#define SAT_KERNEL_UPTO_2_1(X, arg)
+#define SAT_KERNEL_UPTO_2_2(X, arg)
+#define SAT_KERNEL_UPTO_2_3(X, arg) X(arg, 3)
+#define SAT_KERNEL_UPTO_2_4(X, arg) SAT_KERNEL_UPTO_2_3(X, arg) X(arg, 4)
+#define SAT_KERNEL_UPTO_2_5(X, arg) SAT_KERNEL_UPTO_2_4(X, arg) X(arg, 5)
+#define SAT_KERNEL_UPTO_2_6(X, arg) SAT_KERNEL_UPTO_2_5(X, arg) X(arg, 6)
+#define SAT_KERNEL_UPTO_2_7(X, arg) SAT_KERNEL_UPTO_2_6(X, arg) X(arg, 7)
+#define SAT_KERNEL_UPTO_2_8(X, arg) SAT_KERNEL_UPTO_2_7(X, arg) X(arg, 8)
+#define SAT_KERNEL_UPTO_2_9(X, arg) SAT_KERNEL_UPTO_2_8(X, arg) X(arg, 9)
+#define SAT_KERNEL_UPTO_2_10(X, arg) SAT_KERNEL_UPTO_2_9(X, arg) X(arg, 10)
+#define SAT_KERNEL_UPTO_2_11(X, arg) SAT_KERNEL_UPTO_2_10(X, arg) X(arg, 11)
+#define SAT_KERNEL_UPTO_2_12(X, arg) SAT_KERNEL_UPTO_2_11(X, arg) X(arg, 12)
+#define SAT_KERNEL_UPTO(list, max) SAT_KERNEL_UPTO_EXPANDED(list, max)
+#define SAT_KERNEL_UPTO_EXPANDED(list, max) SAT_KERNEL_UPTO_##list##_##max
+#define SAT_KERNEL_COUNTS_1(X, arg) \
+  SAT_KERNEL_UPTO(1, SAT_KERNEL_MAX_VERTICES)(X, arg)
+#define SAT_KERNEL_COUNTS_2(X, arg) \
+  SAT_KERNEL_UPTO(2, SAT_KERNEL_MAX_VERTICES)(X, arg)
+#define SAT_KERNEL_TABLE_SIZE (SAT_KERNEL_MAX_VERTICES + 1)
+
+/**
+ * A separating axis test over precomputed normals, like test_normals() on
+ * each polygon's normals in turn, for polygons of fixed vertex counts.
+ */
+typedef bool (*sat_kernel_t)(const vector_t *points1,
+  const vector_t *normals1, size_t k1, const vector_t *points2,
+  const vector_t *normals2, size_t k2, double *overlap,
+  vector_t *collision_axis, vector_t *separating_axis);
+
+/**
+ * Projects a polygon with a vertex count known at compile time, so the
+ * loop is unrolled in each kernel it is inlined into.
+ */
+static inline void fixed_proj(const vector_t *points, size_t n,
+  vector_t line, double *min, double *max) {
+  double lo = points[0].x * line.x + points[0].y * line.y;
+  double hi = lo;
+#pragma GCC unroll 16
+  for (size_t i = 1; i < n; i++) {
+    double proj = points[i].x * line.x + points[i].y * line.y;
+    lo = proj < lo ? proj : lo;
+    hi = proj > hi ? proj : hi;
+  }
+  *min = lo;
+  *max = hi;
+}
+
+/**
+ * Tests axes one at a time with fixed_proj(), like test_normals().
+ */
+static inline bool fixed_normals(const vector_t *normals, size_t k,
+  const vector_t *points1, size_t n1, const vector_t *points2, size_t n2,
+  double *overlap, vector_t *collision_axis, vector_t *separating_axis) {
+  for (size_t i = 0; i < k; i++) {
+    double min1, max1, min2, max2;
+    fixed_proj(points1, n1, normals[i], &min1, &max1);
+    fixed_proj(points2, n2, normals[i], &min2, &max2);
+    if (!test_extents(min1, max1, min2, max2, normals[i], overlap,
+      collision_axis)) {
+      *separating_axis = normals[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+#define SAT_KERNEL(N1, N2) \
+  static bool sat_kernel_##N1##_##N2(const vector_t *points1, \
+    const vector_t *normals1, size_t k1, const vector_t *points2, \
+    const vector_t *normals2, size_t k2, double *overlap, \
+    vector_t *collision_axis, vector_t *separating_axis) { \
+    return fixed_normals(normals1, k1, points1, N1, points2, N2, overlap, \
+      collision_axis, separating_axis) && \
+      fixed_normals(normals2, k2, points1, N1, points2, N2, overlap, \
+      collision_axis, separating_axis); \
+  }
+#define SAT_KERNEL_ROW(unused, N1) SAT_KERNEL_COUNTS_2(SAT_KERNEL, N1)
+SAT_KERNEL_COUNTS_1(SAT_KERNEL_ROW, _)
+
+#define SAT_KERNEL_ENTRY(N1, N2) [N1][N2] = sat_kernel_##N1##_##N2,
+#define SAT_KERNEL_ENTRY_ROW(unused, N1) \
+  SAT_KERNEL_COUNTS_2(SAT_KERNEL_ENTRY, N1)
+// Indexed by the vertex counts of the two polygons; NULL for counts
+// without a kernel
+static const sat_kernel_t
+  SAT_KERNELS[SAT_KERNEL_TABLE_SIZE][SAT_KERNEL_TABLE_SIZE] = {
+  SAT_KERNEL_COUNTS_1(SAT_KERNEL_ENTRY_ROW, _)
+};
+
+// Whether points_collision() uses the kernels (see collision_set_sat_kernels())
+static bool sat_kernels_enabled = true;
+
+/**
+ * Finds the specialized kernel for two vertex counts, or NULL.
+ */
+static sat_kernel_t find_sat_kernel(size_t n1, size_t n2) {
+  if (!sat_kernels_enabled || n1 >= SAT_KERNEL_TABLE_SIZE ||
+    n2 >= SAT_KERNEL_TABLE_SIZE) {
+    return NULL;
+  }
+  return SAT_KERNELS[n1][n2];
+}
+
+void collision_set_sat_kernels(bool enabled) {
+  sat_kernels_enabled = enabled;
+}
+
+/**
+ * Separating axis test on two packed convex polygons.
+ * Tests the given axes of each polygon, or if they are NULL, the normals
+ * of all of its edges.
+ * Stores the axis that decided the test in axis: the separating axis if
+ * the polygons do not collide, or the collision axis if they do.
+ */
+static collision_info_t points_collision(const vector_t *points1, size_t n1,
+  const shape_t *normals1, const vector_t *points2, size_t n2,
+  const shape_t *normals2, vector_t *axis) {
+  // Squared overlap per squared axis length on the best axis so far
   double overlap = LARGE;
   vector_t collision_axis = {0.0, 0.0};
-  collision_info_t info = (collision_info_t){false, collision_axis};
-  for (size_t i = 0; i < list_size(axes); i++) {
-    double min1 = polygon_proj_min(shape1, *(vector_t*) list_get(axes, i));
-    double max1 = polygon_proj_max(shape1, *(vector_t*) list_get(axes, i));
-    double min2 = polygon_proj_min(shape2, *(vector_t*) list_get(axes, i));
-    double max2 = polygon_proj_max(shape2, *(vector_t*) list_get(axes, i));
+  collision_info_t info = {.collided = false, .axis = collision_axis};
+  bool separated;
+  sat_kernel_t kernel = normals1 != NULL ? find_sat_kernel(n1, n2) : NULL;
+  if (kernel != NULL) {
+    separated = !kernel(points1, shape_const_points(normals1),
+      shape_size(normals1), points2, shape_const_points(normals2),
+      shape_size(normals2), &overlap, &collision_axis, axis);
+  }
+  else if (normals1 != NULL) {
+    separated = !test_normals(shape_const_points(normals1),
+      shape_size(normals1), points1, n1, points2, n2, &overlap,
+      &collision_axis, axis) ||
+      !test_normals(shape_const_points(normals2), shape_size(normals2),
+      points1, n1, points2, n2, &overlap, &collision_axis, axis);
+  }
+  else {
+    separated = !test_edges(points1, n1, points1, n1, points2, n2, &overlap,
+      &collision_axis, axis) ||
+      !test_edges(points2, n2, points1, n1, points2, n2, &overlap,
+      &collision_axis, axis);
+  }
+  if (separated) {
+    return info;
+  }
+  double mag = sqrt(vec_dot(collision_axis, collision_axis));
+  info.collided = true;
+  info.axis = vec_multiply(1 / mag, collision_axis);
+  info.depth = sqrt(overlap);
+  find_contacts(points1, n1, points2, n2, &info);
+  *axis = info.axis;
+  return info;
+}
+
+collision_info_t find_collision(list_t *shape1, list_t *shape2) {
+  // Gathers the vertices onto the stack so the list is only walked once
+  size_t n1 = list_size(shape1);
+  size_t n2 = list_size(shape2);
+  vector_t points1[n1];
+  vector_t points2[n2];
+  for (size_t i = 0; i < n1; i++) {
+    points1[i] = *(vector_t *) list_get(shape1, i);
+  }
+  for (size_t i = 0; i < n2; i++) {
+    points2[i] = *(vector_t *) list_get(shape2, i);
+  }
+  vector_t axis;
+  return points_collision(points1, n1, NULL, points2, n2, NULL, &axis);
+}
+
+collision_info_t find_shape_collision(const shape_t *shape1,
+  const shape_t *shape2) {
+  vector_t axis;
+  return points_collision(shape_const_points(shape1), shape_size(shape1), NULL,
+    shape_const_points(shape2), shape_size(shape2), NULL, &axis);
+}
+
+void find_shape_contacts(const shape_t *shape1, const shape_t *shape2,
+  collision_info_t *info) {
+  find_contacts(shape_const_points(shape1), shape_size(shape1),
+    shape_const_points(shape2), shape_size(shape2), info);
+}
+
+/**
+ * A convex part of a body at its current position: the whole body, or one
+ * of the pieces of a concave body.
+ */
+typedef struct {
+  const shape_t *shape;
+  const shape_t *normals;
+  aabb_t box;
+} convex_part_t;
+
+static convex_part_t body_part(body_t *body, size_t index) {
+  if (body_get_piece_count(body) == 0) {
+    return (convex_part_t) {body_get_vertices(body), body_get_normals(body),
+      body_get_aabb(body)};
+  }
+  const body_piece_t *piece = body_get_piece(body, index);
+  return (convex_part_t) {&piece->world_shape, &piece->world_normals,
+    piece->world_aabb};
+}
+
+/**
+ * Runs a narrowphase on two convex parts, storing the axis that decided it.
+ */
+static collision_info_t part_collision(convex_part_t part1,
+  convex_part_t part2, narrowphase_t narrowphase, vector_t *axis) {
+  if (narrowphase == NARROWPHASE_GJK) {
+    collision_info_t info = find_shape_collision_gjk(part1.shape,
+      part2.shape, *axis);
+    // Either way the axis separates the shapes or is their collision axis
+    *axis = info.axis;
+    return info;
+  }
+  return points_collision(shape_const_points(part1.shape),
+    shape_size(part1.shape), part1.normals, shape_const_points(part2.shape),
+    shape_size(part2.shape), part2.normals, axis);
+}
+
+/**
+ * Runs a narrowphase on two bodies. Concave bodies are tested piece by
+ * piece, skipping pieces whose boxes do not overlap, and the deepest of
+ * the pieces' collisions is the bodies' collision.
+ */
+static collision_info_t body_collision(body_t *body1, body_t *body2,
+  narrowphase_t narrowphase, vector_t *axis) {
+  size_t parts1 = body_get_piece_count(body1);
+  size_t parts2 = body_get_piece_count(body2);
+  if (parts1 == 0 && parts2 == 0) {
+    return part_collision(body_part(body1, 0), body_part(body2, 0),
+      narrowphase, axis);
+  }
+  parts1 = parts1 == 0 ? 1 : parts1;
+  parts2 = parts2 == 0 ? 1 : parts2;
+  collision_info_t deepest = {.collided = false, .axis = VEC_ZERO};
+  for (size_t i = 0; i < parts1; i++) {
+    convex_part_t part1 = body_part(body1, i);
+    for (size_t j = 0; j < parts2; j++) {
+      convex_part_t part2 = body_part(body2, j);
+      if (!aabb_overlaps(part1.box, part2.box)) {
+        continue;
+      }
+      vector_t part_axis = VEC_ZERO;
+      collision_info_t info = part_collision(part1, part2, narrowphase,
+        &part_axis);
+      if (info.collided && (!deepest.collided || info.depth > deepest.depth)) {
+        deepest = info;
+      }
+    }
+  }
+  // Pieces are apart along different axes, so only a collision axis can be
+  // remembered for the whole body
+  *axis = deepest.collided ? deepest.axis : VEC_ZERO;
+  return deepest;
+}
+
+collision_info_t find_body_collision_cached(body_t *body1, body_t *body2,
+  narrowphase_t narrowphase, vector_t *axis, bool *hit) {
+  const shape_t *shape1 = body_get_vertices(body1);
+  const shape_t *shape2 = body_get_vertices(body2);
+  const vector_t *points1 = shape_const_points(shape1);
+  const vector_t *points2 = shape_const_points(shape2);
+  size_t n1 = shape_size(shape1);
+  size_t n2 = shape_size(shape2);
+  *hit = false;
+  if (axis->x != 0.0 || axis->y != 0.0) {
+    double min1, max1, min2, max2;
+    points_proj(points1, n1, *axis, &min1, &max1);
+    points_proj(points2, n2, *axis, &min2, &max2);
     if ((max2 < min1) || (max1 < min2)) {
-         return info;
-       }
-       else {
-         double min = find_min(fabs(max2 - min1), fabs(max1 - min2));
-         if (min < overlap) {
-           overlap = min;
-           collision_axis = *(vector_t *)(list_get(axes, i));
-           double mag = sqrt(pow(collision_axis.x, 2) + pow(collision_axis.y, 2));
-           collision_axis = vec_multiply(1 / mag, collision_axis);
-         }
-       }
+      *hit = true;
+      return (collision_info_t) {.collided = false, .axis = VEC_ZERO};
+    }
+  }
+  return body_collision(body1, body2, narrowphase, axis);
+}
+
+bool bodies_may_collide(body_t *body1, body_t *body2) {
+  vector_t offset = vec_subtract(body_get_centroid(body2),
+    body_get_centroid(body1));
+  double reach = body_get_radius(body1) + body_get_radius(body2);
+  if (vec_dot(offset, offset) > reach * reach) {
+    return false;
   }
-  return (collision_info_t){true, collision_axis};
+  return aabb_overlaps(body_get_aabb(body1), body_get_aabb(body2));
+}
+
+collision_info_t find_body_collision(body_t *body1, body_t *body2) {
+  if (!bodies_may_collide(body1, body2)) {
+    return (collision_info_t) {.collided = false, .axis = VEC_ZERO};
+  }
+  vector_t axis = VEC_ZERO;
+  return body_collision(body1, body2, NARROWPHASE_SAT, &axis);
+}
+
+/**
+ * Narrows [*enter, *exit], the fractions of a move during which part 1 could
+ * overlap part 2 by TOI_SLOP, to those during which it does along one axis.
+ */
+static void sweep_axis(convex_part_t part1, vector_t displacement,
+  convex_part_t part2, vector_t axis, double *enter, double *exit) {
+  double min1, max1, min2, max2;
+  points_proj(shape_const_points(part1.shape), shape_size(part1.shape), axis,
+    &min1, &max1);
+  points_proj(shape_const_points(part2.shape), shape_size(part2.shape), axis,
+    &min2, &max2);
+  double slop = TOI_SLOP * sqrt(vec_dot(axis, axis));
+  // Part 1 moved by t * displacement overlaps by slop when both are >= 0
+  double ahead = max1 - min2 - slop;
+  double behind = max2 - min1 - slop;
+  double speed = vec_dot(displacement, axis);
+  if (speed == 0.0) {
+    if (ahead < 0.0 || behind < 0.0) {
+      *exit = -LARGE;
+    }
+    return;
+  }
+  double first = -ahead / speed;
+  double last = behind / speed;
+  if (speed < 0.0) {
+    double swap = first;
+    first = last;
+    last = swap;
+  }
+  *enter = first > *enter ? first : *enter;
+  *exit = last < *exit ? last : *exit;
+}
+
+/**
+ * Swept separating axis test between two convex parts: since the parts do
+ * not rotate, they overlap exactly when they overlap along every edge
+ * normal. Returns 1.0 if the parts never overlap during the move, or
+ * already do at its start.
+ */
+static double part_time_of_impact(convex_part_t part1, vector_t displacement,
+  convex_part_t part2) {
+  double enter = -LARGE;
+  double exit = LARGE;
+  const shape_t *normal_sets[] = {part1.normals, part2.normals};
+  for (size_t s = 0; s < 2 && enter <= exit; s++) {
+    const vector_t *normals = shape_const_points(normal_sets[s]);
+    for (size_t i = 0; i < shape_size(normal_sets[s]) && enter <= exit;
+      i++) {
+      sweep_axis(part1, displacement, part2, normals[i], &enter, &exit);
+    }
+  }
+  if (enter > exit || enter <= 0.0 || enter >= 1.0) {
+    return 1.0;
+  }
+  return enter;
+}
+
+/**
+ * Bounds a box along its whole move.
+ */
+static aabb_t swept_box(aabb_t box, vector_t displacement) {
+  aabb_t moved = {vec_add(box.min, displacement),
+    vec_add(box.max, displacement)};
+  return aabb_union(box, moved);
+}
+
+double find_time_of_impact(body_t *body1, vector_t displacement,
+  body_t *body2) {
+  if (!aabb_overlaps(swept_box(body_get_aabb(body1), displacement),
+    body_get_aabb(body2))) {
+    return 1.0;
+  }
+  size_t parts1 = body_get_piece_count(body1);
+  size_t parts2 = body_get_piece_count(body2);
+  parts1 = parts1 == 0 ? 1 : parts1;
+  parts2 = parts2 == 0 ? 1 : parts2;
+  double toi = 1.0;
+  for (size_t i = 0; i < parts1; i++) {
+    convex_part_t part1 = body_part(body1, i);
+    aabb_t swept = swept_box(part1.box, displacement);
+    for (size_t j = 0; j < parts2; j++) {
+      convex_part_t part2 = body_part(body2, j);
+      if (!aabb_overlaps(swept, part2.box)) {
+        continue;
+      }
+      double t = part_time_of_impact(part1, displacement, part2);
+      toi = t < toi ? t : toi;
+    }
+  }
+  return toi;
 }
 
 double find_min(double first, double second) {
@@ -42,51 +663,40 @@ double find_min(double first, double second) {
   }
   return second;
 }
-vector_t *edge_perp(vector_t vec) {
-  vector_t *vec_normal = malloc(sizeof(vector_t));
-  vec_normal->x =  -1 * vec.y;
-  vec_normal->y = vec.x;
-  return vec_normal;
+
+vector_t edge_perp(vector_t vec) {
+  return (vector_t) {-1 * vec.y, vec.x};
 }
-list_t *get_axes1(list_t *shape) {
-  size_t len = list_size(shape);
-  list_t *result = list_init(len, free, NULL);
-  for (size_t i = 0; i < len; i++) {
-    vector_t vec = *(vector_t *)(list_get(shape, i % len));
-    vec = vec_subtract(vec, *(vector_t *)(list_get(shape, (i + 1) % len)));
-    list_add(result, (void *) edge_perp(vec));
+
+void polygon_proj(list_t *shape, vector_t line, double *min, double *max) {
+  double lo = vec_dot(*(vector_t *) list_get(shape, 0), line);
+  double hi = lo;
+  for (size_t i = 1; i < list_size(shape); i++) {
+    double proj = vec_dot(*(vector_t *) list_get(shape, i), line);
+    if (proj < lo) {
+      lo = proj;
+    }
+    else if (proj > hi) {
+      hi = proj;
+    }
   }
-  return result;
+  *min = lo;
+  *max = hi;
 }
-list_t *get_axes2(list_t *shape1, list_t *shape2) {
-  list_t *result = list_init(list_size(shape1) + list_size(shape2), free, NULL);
-  list_t *axes1 = get_axes1(shape1);
-  list_t *axes2 = get_axes1(shape2);
-  for (size_t i = 0; i < list_size(shape1); i++) {
-    list_add(result, list_get(axes1, i));
-  }
-  for (size_t i = 0; i < list_size(shape2); i++) {
-    list_add(result, list_get(axes2, i));
-  }
-  return result;
+
+void shape_proj(const shape_t *shape, vector_t line, double *min,
+  double *max) {
+  points_proj(shape_const_points(shape), shape_size(shape), line, min, max);
 }
 
 double polygon_proj_min(list_t *shape, vector_t line) {
-  double min = vec_dot(*(vector_t*) list_get(shape, 0), line);
-  for (size_t i = 0; i < list_size(shape); i++) {
-    if (vec_dot(*((vector_t*) list_get(shape, i)), line) < min) {
-      min = vec_dot(*((vector_t*) list_get(shape, i)), line);
-    }
-  }
+  double min, max;
+  polygon_proj(shape, line, &min, &max);
   return min;
 }
 
 double polygon_proj_max(list_t *shape, vector_t line) {
-  double max = vec_dot(*((vector_t*) list_get(shape, 0)), line);
-  for (size_t i = 0; i < list_size(shape); i++) {
-    if (vec_dot(*((vector_t*) list_get(shape, i)), line) > max) {
-      max = vec_dot(*((vector_t*) list_get(shape, i)), line);
-    }
-  }
+  double min, max;
+  polygon_proj(shape, line, &min, &max);
   return max;
 }
@@ -0,0 +1,202 @@
+#include "contact_solver.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include "body.h"
+#include "collision.h"
+#include "vector.h"
+
+// Position correction until contact_solver_set_correction() is called
+const double DEFAULT_CONTACT_BIAS = 0.2;
+const double DEFAULT_CONTACT_SLOP = 0.5;
+
+/**
+ * A body taking part in the solve, with the velocity it is being given.
+ */
+typedef struct {
+  body_t *body;
+  vector_t velocity;
+  double inverse_mass;
+} solver_body_t;
+
+typedef struct {
+  // indices into the solver's bodies
+  size_t body1;
+  size_t body2;
+  vector_t normal;
+  double depth;
+  double elasticity;
+  // set up by contact_solver_solve()
+  double target_speed;
+  double normal_mass;
+  double impulse;
+} contact_t;
+
+typedef struct contact_solver {
+  size_t iterations;
+  double bias;
+  double slop;
+  contact_t *contacts;
+  size_t contact_count;
+  size_t contact_capacity;
+  solver_body_t *bodies;
+  size_t body_count;
+  size_t body_capacity;
+} contact_solver_t;
+
+contact_solver_t *contact_solver_init(size_t iterations) {
+  assert(iterations > 0);
+  contact_solver_t *solver = malloc(sizeof(contact_solver_t));
+  assert(solver != NULL);
+  solver->iterations = iterations;
+  solver->bias = DEFAULT_CONTACT_BIAS;
+  solver->slop = DEFAULT_CONTACT_SLOP;
+  solver->contacts = NULL;
+  solver->contact_count = 0;
+  solver->contact_capacity = 0;
+  solver->bodies = NULL;
+  solver->body_count = 0;
+  solver->body_capacity = 0;
+  return solver;
+}
+
+void contact_solver_free(contact_solver_t *solver) {
+  free(solver->contacts);
+  free(solver->bodies);
+  free(solver);
+}
+
+void contact_solver_set_iterations(contact_solver_t *solver,
+  size_t iterations) {
+  assert(iterations > 0);
+  solver->iterations = iterations;
+}
+
+void contact_solver_set_correction(contact_solver_t *solver, double bias,
+  double slop) {
+  solver->bias = bias;
+  solver->slop = slop;
+}
+
+static double inverse_mass(body_t *body) {
+  double mass = body_get_mass(body);
+  return mass == INFINITY ? 0.0 : 1.0 / mass;
+}
+
+/**
+ * Gets the index of a body in the solve, adding the body if it is new.
+ */
+static size_t solver_body(contact_solver_t *solver, body_t *body) {
+  if (body->solver_slot >= 0) {
+    return body->solver_slot;
+  }
+  if (solver->body_count == solver->body_capacity) {
+    solver->body_capacity = 2 * solver->body_capacity + 1;
+    solver->bodies = realloc(solver->bodies,
+      solver->body_capacity * sizeof(solver_body_t));
+    assert(solver->bodies != NULL);
+  }
+  size_t index = solver->body_count++;
+  solver->bodies[index] = (solver_body_t) {body, VEC_ZERO,
+    inverse_mass(body)};
+  body->solver_slot = index;
+  return index;
+}
+
+void contact_solver_add(contact_solver_t *solver, body_t *body1,
+  body_t *body2, collision_info_t info, double elasticity) {
+  if (inverse_mass(body1) == 0.0 && inverse_mass(body2) == 0.0) {
+    return;
+  }
+  if (solver->contact_count == solver->contact_capacity) {
+    solver->contact_capacity = 2 * solver->contact_capacity + 1;
+    solver->contacts = realloc(solver->contacts,
+      solver->contact_capacity * sizeof(contact_t));
+    assert(solver->contacts != NULL);
+  }
+  contact_t *contact = &solver->contacts[solver->contact_count++];
+  contact->body1 = solver_body(solver, body1);
+  contact->body2 = solver_body(solver, body2);
+  contact->normal = info.axis;
+  contact->depth = info.depth;
+  contact->elasticity = elasticity;
+}
+
+size_t contact_solver_count(contact_solver_t *solver) {
+  return solver->contact_count;
+}
+
+/**
+ * Gets the velocity of body2 relative to body1 along a contact's normal;
+ * negative while the bodies approach each other.
+ */
+static double normal_speed(contact_solver_t *solver, contact_t *contact) {
+  vector_t relative = vec_subtract(solver->bodies[contact->body2].velocity,
+    solver->bodies[contact->body1].velocity);
+  return vec_dot(relative, contact->normal);
+}
+
+void contact_solver_solve(contact_solver_t *solver, double dt) {
+  // The velocities the bodies would end the tick with, without contacts
+  for (size_t i = 0; i < solver->body_count; i++) {
+    solver_body_t *body = &solver->bodies[i];
+    vector_t push = vec_add(vec_multiply(dt, body_get_force(body->body)),
+      body_get_impulse(body->body));
+    body->velocity = vec_add(body_get_velocity(body->body),
+      vec_multiply(body->inverse_mass, push));
+  }
+
+  for (size_t c = 0; c < solver->contact_count; c++) {
+    contact_t *contact = &solver->contacts[c];
+    double approach = normal_speed(solver, contact);
+    double bounce = approach < 0.0 ? -contact->elasticity * approach : 0.0;
+    double correction = 0.0;
+    if (dt > 0.0 && contact->depth > solver->slop) {
+      correction = solver->bias / dt * (contact->depth - solver->slop);
+    }
+    contact->target_speed = bounce > correction ? bounce : correction;
+    contact->normal_mass = 1.0 / (solver->bodies[contact->body1].inverse_mass +
+      solver->bodies[contact->body2].inverse_mass);
+    contact->impulse = 0.0;
+  }
+
+  for (size_t k = 0; k < solver->iterations; k++) {
+    for (size_t c = 0; c < solver->contact_count; c++) {
+      contact_t *contact = &solver->contacts[c];
+      solver_body_t *body1 = &solver->bodies[contact->body1];
+      solver_body_t *body2 = &solver->bodies[contact->body2];
+      double change = contact->normal_mass *
+        (contact->target_speed - normal_speed(solver, contact));
+      // The total impulse may only push the bodies apart
+      double impulse = fmax(contact->impulse + change, 0.0);
+      change = impulse - contact->impulse;
+      contact->impulse = impulse;
+      vector_t push = vec_multiply(change, contact->normal);
+      body1->velocity = vec_subtract(body1->velocity,
+        vec_multiply(body1->inverse_mass, push));
+      body2->velocity = vec_add(body2->velocity,
+        vec_multiply(body2->inverse_mass, push));
+    }
+  }
+
+  for (size_t c = 0; c < solver->contact_count; c++) {
+    contact_t *contact = &solver->contacts[c];
+    if (contact->impulse == 0.0) {
+      continue;
+    }
+    vector_t push = vec_multiply(contact->impulse, contact->normal);
+    // Bodies of infinite mass are left alone, so they are not woken up
+    if (solver->bodies[contact->body1].inverse_mass > 0.0) {
+      body_add_impulse(solver->bodies[contact->body1].body, vec_negate(push));
+    }
+    if (solver->bodies[contact->body2].inverse_mass > 0.0) {
+      body_add_impulse(solver->bodies[contact->body2].body, push);
+    }
+  }
+
+  for (size_t i = 0; i < solver->body_count; i++) {
+    solver->bodies[i].body->solver_slot = -1;
+  }
+  solver->body_count = 0;
+  solver->contact_count = 0;
+}
@@ -0,0 +1,419 @@
+#include "force_records.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include "body.h"
+#include "collision.h"
+#include "contact_solver.h"
+#include "vector.h"
+
+const double MIN_DIST = 5.0;
+// Number of kinds stored as pair_record_t, starting at FORCE_UNIFORM_GRAVITY
+#define PAIR_KIND_COUNT (FORCE_DRAG - FORCE_UNIFORM_GRAVITY + 1)
+
+/**
+ * A gravity, spring or drag force: one constant and up to two bodies.
+ */
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+  double constant;
+  size_t *slot;
+} pair_record_t;
+
+/**
+ * A collision force: calls handler on the bodies when they collide, or if
+ * handler is NULL, hands their contact to a contact solver.
+ */
+typedef struct {
+  body_t *body1;
+  body_t *body2;
+  collision_handler_t handler;
+  void *aux;
+  free_func_t freer;
+  double elasticity;
+  // whether the bodies collided the last time the record ran, and the axis
+  // that decided it (see find_body_collision_cached())
+  bool touching;
+  vector_t axis;
+  size_t *slot;
+} collision_record_t;
+
+typedef struct force_records {
+  pair_record_t *pairs[PAIR_KIND_COUNT];
+  size_t pair_counts[PAIR_KIND_COUNT];
+  size_t pair_capacities[PAIR_KIND_COUNT];
+  collision_record_t *collisions;
+  size_t collision_count;
+  size_t collision_capacity;
+  // the test contact records run
+  narrowphase_t narrowphase;
+} force_records_t;
+
+force_records_t *force_records_init(void) {
+  force_records_t *records = malloc(sizeof(force_records_t));
+  assert(records != NULL);
+  for (size_t k = 0; k < PAIR_KIND_COUNT; k++) {
+    records->pairs[k] = NULL;
+    records->pair_counts[k] = 0;
+    records->pair_capacities[k] = 0;
+  }
+  records->collisions = NULL;
+  records->collision_count = 0;
+  records->collision_capacity = 0;
+  records->narrowphase = NARROWPHASE_SAT;
+  return records;
+}
+
+void force_records_free(force_records_t *records) {
+  for (size_t k = 0; k < PAIR_KIND_COUNT; k++) {
+    free(records->pairs[k]);
+  }
+  for (size_t i = 0; i < records->collision_count; i++) {
+    collision_record_t *record = &records->collisions[i];
+    if (record->freer != NULL) {
+      record->freer(record->aux);
+    }
+  }
+  free(records->collisions);
+  free(records);
+}
+
+/**
+ * Makes room for one more element in a growable array.
+ */
+static void *reserve_one(void *array, size_t count, size_t *capacity,
+  size_t elem_size) {
+  if (count < *capacity) {
+    return array;
+  }
+  *capacity = 2 * *capacity + 1;
+  array = realloc(array, *capacity * elem_size);
+  assert(array != NULL);
+  return array;
+}
+
+void force_records_add(force_records_t *records, force_kind_t kind,
+  double constant, body_t *body1, body_t *body2, size_t *slot) {
+  assert(kind >= FORCE_UNIFORM_GRAVITY && kind <= FORCE_DRAG);
+  size_t k = kind - FORCE_UNIFORM_GRAVITY;
+  size_t count = records->pair_counts[k];
+  records->pairs[k] = reserve_one(records->pairs[k], count,
+    &records->pair_capacities[k], sizeof(pair_record_t));
+  records->pairs[k][count] = (pair_record_t) {body1, body2, constant, slot};
+  records->pair_counts[k]++;
+  *slot = count;
+}
+
+void force_records_add_collision(force_records_t *records, body_t *body1,
+  body_t *body2, collision_handler_t handler, void *aux, free_func_t freer,
+  size_t *slot) {
+  size_t count = records->collision_count;
+  records->collisions = reserve_one(records->collisions, count,
+    &records->collision_capacity, sizeof(collision_record_t));
+  records->collisions[count] = (collision_record_t) {body1, body2, handler,
+    aux, freer, 0.0, false, VEC_ZERO, slot};
+  records->collision_count++;
+  *slot = count;
+}
+
+void force_records_add_contact(force_records_t *records, double elasticity,
+  body_t *body1, body_t *body2, size_t *slot) {
+  force_records_add_collision(records, body1, body2, NULL, NULL, NULL, slot);
+  records->collisions[*slot].elasticity = elasticity;
+}
+
+void force_records_set_narrowphase(force_records_t *records,
+  narrowphase_t narrowphase) {
+  records->narrowphase = narrowphase;
+}
+
+bool force_records_collision_touching(force_records_t *records,
+  size_t index) {
+  assert(index < records->collision_count);
+  return records->collisions[index].touching;
+}
+
+void force_records_remove(force_records_t *records, force_kind_t kind,
+  size_t index) {
+  if (kind == FORCE_COLLISION) {
+    assert(index < records->collision_count);
+    collision_record_t *record = &records->collisions[index];
+    if (record->freer != NULL) {
+      record->freer(record->aux);
+    }
+    size_t last = --records->collision_count;
+    if (index != last) {
+      *record = records->collisions[last];
+      *record->slot = index;
+    }
+    return;
+  }
+  assert(kind >= FORCE_UNIFORM_GRAVITY && kind <= FORCE_DRAG);
+  size_t k = kind - FORCE_UNIFORM_GRAVITY;
+  assert(index < records->pair_counts[k]);
+  size_t last = --records->pair_counts[k];
+  if (index != last) {
+    records->pairs[k][index] = records->pairs[k][last];
+    *records->pairs[k][index].slot = index;
+  }
+}
+
+size_t force_records_count(force_records_t *records, force_kind_t kind) {
+  if (kind == FORCE_COLLISION) {
+    return records->collision_count;
+  }
+  assert(kind >= FORCE_UNIFORM_GRAVITY && kind <= FORCE_DRAG);
+  return records->pair_counts[kind - FORCE_UNIFORM_GRAVITY];
+}
+
+/**
+ * The uniform gravity force on a body.
+ */
+static vector_t uniform_gravity_force(double g, body_t *body) {
+  return (vector_t) {0, -1 * g * body_get_mass(body)};
+}
+
+/**
+ * The Newtonian gravity force on body1 (body2 feels the opposite),
+ * or false if the bodies are within MIN_DIST.
+ */
+static bool newtonian_gravity_force(double G, body_t *body1, body_t *body2,
+  vector_t *force) {
+  vector_t pos1 = body_get_centroid(body1);
+  vector_t pos2 = body_get_centroid(body2);
+  double distance = sqrt(pow((pos2.x - pos1.x), 2) + pow((pos2.y - pos1.y), 2));
+  if (distance <= MIN_DIST) {
+    return false;
+  }
+  vector_t unit = (vector_t) {(pos2.x - pos1.x) / distance, \
+    (pos2.y - pos1.y) / distance};
+  double force_mag = G * body_get_mass(body1) * body_get_mass(body2) / \
+    pow(distance, 2);
+  *force = vec_multiply(force_mag, unit);
+  return true;
+}
+
+/**
+ * The spring force on body1 (body2 feels the opposite).
+ */
+static vector_t spring_force(double k, body_t *body1, body_t *body2) {
+  vector_t pos1 = body_get_centroid(body1);
+  vector_t pos2 = body_get_centroid(body2);
+  return vec_multiply(k, vec_subtract(pos2, pos1));
+}
+
+static vector_t drag_force(double gamma, body_t *body) {
+  vector_t vel = body_get_velocity(body);
+  return vec_multiply(gamma, (vector_t) {-1 * vel.x, -1 * vel.y});
+}
+
+void force_apply_uniform_gravity(double g, body_t *body) {
+  body_add_force(body, uniform_gravity_force(g, body));
+}
+
+void force_apply_newtonian_gravity(double G, body_t *body1, body_t *body2) {
+  vector_t force;
+  if (newtonian_gravity_force(G, body1, body2, &force)) {
+    body_add_force(body1, force);
+    body_add_force(body2, vec_negate(force));
+  }
+}
+
+void force_apply_spring(double k, body_t *body1, body_t *body2) {
+  vector_t force = spring_force(k, body1, body2);
+  body_add_force(body1, force);
+  body_add_force(body2, vec_negate(force));
+}
+
+void force_apply_drag(double gamma, body_t *body) {
+  body_add_force(body, drag_force(gamma, body));
+}
+
+bool force_apply_collision(body_t *body1, body_t *body2,
+  collision_handler_t handler, void *aux) {
+  collision_info_t info = find_body_collision(body1, body2);
+  if (info.collided) {
+    handler(body1, body2, info.axis, aux);
+    //essentially applies normal force by setting force back to 0,0
+    body_set_force(body1, VEC_ZERO);
+    body_set_velocity(body1, VEC_ZERO);
+  }
+  return info.collided;
+}
+
+void force_records_apply(force_records_t *records,
+  contact_solver_t *solver) {
+  pair_record_t *pairs = records->pairs[FORCE_UNIFORM_GRAVITY -
+    FORCE_UNIFORM_GRAVITY];
+  size_t count = records->pair_counts[FORCE_UNIFORM_GRAVITY -
+    FORCE_UNIFORM_GRAVITY];
+  for (size_t i = 0; i < count; i++) {
+    force_apply_uniform_gravity(pairs[i].constant, pairs[i].body1);
+  }
+
+  pairs = records->pairs[FORCE_NEWTONIAN_GRAVITY - FORCE_UNIFORM_GRAVITY];
+  count = records->pair_counts[FORCE_NEWTONIAN_GRAVITY - FORCE_UNIFORM_GRAVITY];
+  for (size_t i = 0; i < count; i++) {
+    force_apply_newtonian_gravity(pairs[i].constant, pairs[i].body1,
+      pairs[i].body2);
+  }
+
+  pairs = records->pairs[FORCE_SPRING - FORCE_UNIFORM_GRAVITY];
+  count = records->pair_counts[FORCE_SPRING - FORCE_UNIFORM_GRAVITY];
+  for (size_t i = 0; i < count; i++) {
+    force_apply_spring(pairs[i].constant, pairs[i].body1, pairs[i].body2);
+  }
+
+  pairs = records->pairs[FORCE_DRAG - FORCE_UNIFORM_GRAVITY];
+  count = records->pair_counts[FORCE_DRAG - FORCE_UNIFORM_GRAVITY];
+  for (size_t i = 0; i < count; i++) {
+    force_apply_drag(pairs[i].constant, pairs[i].body1);
+  }
+
+  force_records_apply_collisions(records, solver);
+}
+
+size_t force_records_body_force_count(force_records_t *records) {
+  size_t count = 0;
+  for (size_t k = 0; k < PAIR_KIND_COUNT; k++) {
+    count += records->pair_counts[k];
+  }
+  return count;
+}
+
+bool force_kind_acts_on_body2(force_kind_t kind) {
+  return kind == FORCE_NEWTONIAN_GRAVITY || kind == FORCE_SPRING;
+}
+
+/**
+ * Computes the forces a record puts on its bodies; force2 is zero unless
+ * force_kind_acts_on_body2(kind). Returns false if the record puts no force
+ * on them.
+ */
+static bool record_forces(force_kind_t kind, pair_record_t *record,
+  vector_t *force1, vector_t *force2) {
+  *force2 = VEC_ZERO;
+  switch (kind) {
+    case FORCE_UNIFORM_GRAVITY:
+      *force1 = uniform_gravity_force(record->constant, record->body1);
+      return true;
+    case FORCE_NEWTONIAN_GRAVITY:
+      if (!newtonian_gravity_force(record->constant, record->body1,
+        record->body2, force1)) {
+        return false;
+      }
+      break;
+    case FORCE_SPRING:
+      *force1 = spring_force(record->constant, record->body1, record->body2);
+      break;
+    case FORCE_DRAG:
+      *force1 = drag_force(record->constant, record->body1);
+      return true;
+    default:
+      assert(false);
+      return false;
+  }
+  *force2 = vec_negate(*force1);
+  return true;
+}
+
+/**
+ * Finds the part of the records from begin to end - 1, numbered across all
+ * gravity, spring and drag kinds, that falls within kind k, whose first
+ * record is numbered offset.
+ */
+static void kind_range(force_records_t *records, size_t k, size_t offset,
+  size_t begin, size_t end, size_t *first, size_t *last) {
+  size_t count = records->pair_counts[k];
+  *first = begin > offset ? begin - offset : 0;
+  *last = end <= offset ? 0 : (end - offset < count ? end - offset : count);
+}
+
+void force_records_accumulate(force_records_t *records, size_t begin,
+  size_t end, vector_t *forces) {
+  size_t offset = 0;
+  for (size_t k = 0; k < PAIR_KIND_COUNT && offset < end; k++) {
+    size_t first, last;
+    kind_range(records, k, offset, begin, end, &first, &last);
+    force_kind_t kind = FORCE_UNIFORM_GRAVITY + k;
+    for (size_t i = first; i < last; i++) {
+      pair_record_t *record = &records->pairs[k][i];
+      vector_t force1, force2;
+      if (!record_forces(kind, record, &force1, &force2)) {
+        continue;
+      }
+      vector_t *total1 = &forces[record->body1->scene_index];
+      *total1 = vec_add(*total1, force1);
+      if (force_kind_acts_on_body2(kind)) {
+        vector_t *total2 = &forces[record->body2->scene_index];
+        *total2 = vec_add(*total2, force2);
+      }
+    }
+    offset += records->pair_counts[k];
+  }
+}
+
+void force_records_contribute(force_records_t *records, size_t begin,
+  size_t end, vector_t *contributions) {
+  size_t offset = 0;
+  for (size_t k = 0; k < PAIR_KIND_COUNT && offset < end; k++) {
+    size_t first, last;
+    kind_range(records, k, offset, begin, end, &first, &last);
+    force_kind_t kind = FORCE_UNIFORM_GRAVITY + k;
+    for (size_t i = first; i < last; i++) {
+      vector_t *slots = &contributions[2 * (offset + i)];
+      if (!record_forces(kind, &records->pairs[k][i], &slots[0], &slots[1])) {
+        slots[0] = VEC_ZERO;
+      }
+    }
+    offset += records->pair_counts[k];
+  }
+}
+
+void force_records_contribution_bodies(force_records_t *records,
+  body_t **bodies) {
+  size_t r = 0;
+  for (size_t k = 0; k < PAIR_KIND_COUNT; k++) {
+    force_kind_t kind = FORCE_UNIFORM_GRAVITY + k;
+    for (size_t i = 0; i < records->pair_counts[k]; i++, r++) {
+      pair_record_t *record = &records->pairs[k][i];
+      bodies[2 * r] = record->body1;
+      bodies[2 * r + 1] = force_kind_acts_on_body2(kind) ? record->body2 :
+        NULL;
+    }
+  }
+}
+
+void force_records_apply_collisions(force_records_t *records,
+  contact_solver_t *solver) {
+  // Handlers may add forces, which can move the array, so each record is
+  // copied out before its handler runs
+  for (size_t i = 0; i < records->collision_count; i++) {
+    collision_record_t record = records->collisions[i];
+    // Two resting bodies cannot have started touching
+    if (body_is_asleep(record.body1) && body_is_asleep(record.body2)) {
+      continue;
+    }
+    bool touching;
+    if (record.handler == NULL) {
+      touching = false;
+      if (bodies_may_collide(record.body1, record.body2)) {
+        bool hit;
+        collision_info_t info = find_body_collision_cached(record.body1,
+          record.body2, records->narrowphase, &records->collisions[i].axis,
+          &hit);
+        touching = info.collided;
+        if (touching) {
+          contact_solver_add(solver, record.body1, record.body2, info,
+            record.elasticity);
+        }
+      }
+    }
+    else {
+      touching = force_apply_collision(record.body1, record.body2,
+        record.handler, record.aux);
+    }
+    records->collisions[i].touching = touching;
+  }
+}
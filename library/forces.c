@@ -5,24 +5,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "collision.h"
-
-const double MIN_DIST = 5.0;
+#include "force_records.h"
 
 
 void gravity_creator(void *aux) {
-  body_t *bod1 = ((aux_t *) aux)->body1;
-  body_t *bod2 = ((aux_t *) aux)->body2;
-  vector_t pos1 = body_get_centroid(bod1);
-  vector_t pos2 = body_get_centroid(bod2);
-  double distance = sqrt(pow((pos2.x - pos1.x), 2) + pow((pos2.y - pos1.y), 2));
-  if (distance > MIN_DIST) {
-    vector_t unit = (vector_t) {(pos2.x - pos1.x) / distance, \
-      (pos2.y - pos1.y) / distance};
-    double force_mag = ((aux_t *) aux)->constant * body_get_mass(bod1) * \
-      body_get_mass(bod2) / pow(distance, 2);
-    body_add_force(bod1, vec_multiply(force_mag, unit));
-    body_add_force(bod2, vec_negate(vec_multiply(force_mag, unit)));
-  }
+  force_apply_newtonian_gravity(((aux_t *) aux)->constant,
+    ((aux_t *) aux)->body1, ((aux_t *) aux)->body2);
 }
 
 vector_t get_gravity_one(void *aux){
@@ -32,43 +20,30 @@ vector_t get_gravity_one(void *aux){
 }
 
 void gravity_creator_one(void *aux){
-  body_t *bod1 = ((aux_t *) aux)->body1;
-  body_add_force(bod1, get_gravity_one(aux));
+  force_apply_uniform_gravity(((aux_t *) aux)->constant,
+    ((aux_t *) aux)->body1);
 }
 
 
 void spring_creator(void *aux) {
-  vector_t pos1 = body_get_centroid(((aux_t*) aux)->body1);
-  vector_t pos2 = body_get_centroid(((aux_t*) aux)->body2);
-  vector_t force = vec_multiply(((aux_t*) aux)->constant, vec_subtract(pos2, pos1));
-  body_add_force(((aux_t*) aux)->body1, force);
-  body_add_force(((aux_t*) aux)->body2, vec_negate(force));
+  force_apply_spring(((aux_t*) aux)->constant, ((aux_t*) aux)->body1,
+    ((aux_t*) aux)->body2);
 }
 
 void drag_creator(void *aux) {
-  vector_t vel = body_get_velocity(((aux_t*) aux)->body1);
-  vector_t force = vec_multiply(((aux_t*) aux)->constant, (vector_t) \
-    {-1 * vel.x, -1 * vel.y});
-  body_add_force(((aux_t*) aux)->body1, force);
+  force_apply_drag(((aux_t*) aux)->constant, ((aux_t*) aux)->body1);
 }
 
 
 void collision_handler_1(body_t *body1, body_t *body2, vector_t axis, void *aux){
-  if (find_collision(body1->shape, body2->shape).collided){
-    body_remove(body1);
-    body_remove(body2);
-  }
+  // Only called for colliding bodies, so there is nothing to test again
+  body_remove(body1);
+  body_remove(body2);
 }
 
 void collision_creator(void *aux) {
-  collision_info_t info = find_collision((((aux_t*) aux)->body1)->shape, (((aux_t*) aux)->body2)->shape);
-  if (info.collided) {
-    ((aux_t*) aux)->handler(((aux_t*) aux)->body1, ((aux_t*) aux)->body2, info.axis, ((aux_t*) aux)->aux);
-    //essentially applies normal force by setting force back to 0,0
-    body_set_force(((aux_t *) aux)->body1, VEC_ZERO);
-    body_set_velocity(((aux_t *) aux)->body1, VEC_ZERO);
-  }
-  ((aux_t *) aux)->collided = info.collided;
+  ((aux_t *) aux)->collided = force_apply_collision(((aux_t*) aux)->body1,
+    ((aux_t*) aux)->body2, ((aux_t*) aux)->handler, ((aux_t*) aux)->aux);
 }
 
 
@@ -102,64 +77,26 @@ void collision_handler_3(body_t *body1, body_t *body2, vector_t axis, void *aux)
   ((aux_t *) aux)->collided = !((aux_t *) aux)->collided;
 }
 
-
 void create_gravity_one(scene_t *scene, double g, body_t *body1, body_t *body2){
-  aux_t *aux = malloc(sizeof(aux_t));
-  aux->constant = g;
-  aux->body1 = body1;
-  aux->body2 = body2;
-  aux->collided = false;
-  aux->handler = NULL;
-  scene_add_force_creator(scene, (force_creator_t) gravity_creator_one, \
-    aux, free);
+  scene_add_typed_force(scene, FORCE_UNIFORM_GRAVITY, g, body1, body2);
 }
+
 void create_newtonian_gravity(scene_t *scene, double g, body_t *body1, body_t *body2) {
-  aux_t *aux = malloc(sizeof(aux_t));
-  aux->constant = g;
-  aux->body1 = body1;
-  aux->body2 = body2;
-  aux->collided = false;
-  aux->handler = NULL;
-  scene_add_force_creator(scene, (force_creator_t) gravity_creator, \
-    aux, free);
+  scene_add_typed_force(scene, FORCE_NEWTONIAN_GRAVITY, g, body1, body2);
 }
 
 void create_spring(scene_t *scene, double k, body_t *body1, body_t *body2) {
-  aux_t *aux = malloc(sizeof(aux_t));
-  aux->constant = k;
-  aux->body1 = body1;
-  aux->body2 = body2;
-  aux->collided = false;
-  aux->handler = NULL;
-  scene_add_force_creator(scene, (force_creator_t) spring_creator, \
-   aux, free);
+  scene_add_typed_force(scene, FORCE_SPRING, k, body1, body2);
 }
 
 void create_drag(scene_t *scene, double gamma, body_t *body) {
-  aux_t *aux = malloc(sizeof(aux_t));
-  aux->constant = gamma;
-  aux->body1 = body;
-  aux->body2 = NULL;
-  aux->collided = false;
-  aux->handler = NULL;
-  scene_add_force_creator(scene, (force_creator_t) drag_creator, \
-  aux, free);
+  scene_add_typed_force(scene, FORCE_DRAG, gamma, body, NULL);
 }
 
 void create_collision(scene_t *scene, body_t *body1, body_t *body2, \
   collision_handler_t handler, void *aux, free_func_t freer){
-    aux_t *aux_copy = malloc(sizeof(aux_t));
-    aux_copy->body1 = body1;
-    aux_copy->body2 = body2;
-    aux_copy->aux = aux;
-    aux_copy->handler = handler;
-    list_t *b_list = list_init(2, (free_func_t)body_free,
-      (equality_func_t) body_equals);
-    list_add(b_list, body1);
-    list_add(b_list, body2);
-    scene_add_bodies_force_creator(scene, (force_creator_t) collision_creator, \
-    aux_copy, b_list, freer);
-  }
+  scene_add_collision_force(scene, body1, body2, handler, aux, freer);
+}
 
 void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2) {
   aux_t *aux = malloc(sizeof(aux_t));
@@ -173,10 +110,10 @@ void create_destructive_collision(scene_t *scene, body_t *body1, body_t *body2)
 
 
 void create_physics_collision(scene_t *scene, double elasticity, body_t *body1, body_t *body2) {
-  aux_t *aux = malloc(sizeof(aux_t));
-  aux->constant = elasticity;
-  aux->body1 = body1;
-  aux->body2 = body2;
-  aux->collided = false;
-  create_collision(scene, body1, body2, (collision_handler_t) collision_handler_3, aux, free);
+  scene_add_contact_force(scene, elasticity, body1, body2);
+}
+
+void create_physics_collision_rule(scene_t *scene, double elasticity,
+  unsigned int categories1, unsigned int categories2) {
+  scene_add_contact_rule(scene, categories1, categories2, elasticity);
 }
@@ -0,0 +1,226 @@
+#include "gjk.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "collision.h"
+#include "shape.h"
+#include "vector.h"
+
+// GJK stops when a new support point gets the simplex closer to the origin
+// by less than this fraction of the squared distance
+const double GJK_TOLERANCE = 1e-10;
+// Squared distances below this mean the origin lies on the simplex
+const double GJK_TOUCHING = 1e-18;
+// EPA stops when no support point lies further out than this
+const double EPA_TOLERANCE = 1e-9;
+
+/**
+ * Finds the vertex of a packed polygon that lies furthest along a direction.
+ */
+static vector_t support(const vector_t *points, size_t n,
+  vector_t direction) {
+  size_t best = 0;
+  double max = vec_dot(points[0], direction);
+  for (size_t i = 1; i < n; i++) {
+    double proj = vec_dot(points[i], direction);
+    if (proj > max) {
+      max = proj;
+      best = i;
+    }
+  }
+  return points[best];
+}
+
+/**
+ * Finds the point of the Minkowski difference shape1 - shape2 that lies
+ * furthest along a direction.
+ */
+static vector_t minkowski_support(const vector_t *points1, size_t n1,
+  const vector_t *points2, size_t n2, vector_t direction) {
+  return vec_subtract(support(points1, n1, direction),
+    support(points2, n2, vec_negate(direction)));
+}
+
+/**
+ * Finds the point of a segment closest to the origin, and drops the
+ * endpoint that is not needed to reach it.
+ */
+static vector_t closest_on_segment(vector_t *simplex, size_t *count) {
+  vector_t a = simplex[0];
+  vector_t edge = vec_subtract(simplex[1], a);
+  double length_squared = vec_dot(edge, edge);
+  double t = length_squared == 0.0 ? 0.0 :
+    -vec_dot(a, edge) / length_squared;
+  if (t <= 0.0) {
+    *count = 1;
+    return a;
+  }
+  if (t >= 1.0) {
+    simplex[0] = simplex[1];
+    *count = 1;
+    return simplex[0];
+  }
+  return vec_add(a, vec_multiply(t, edge));
+}
+
+/**
+ * Finds the point of a simplex (a point, segment or triangle) closest to
+ * the origin, reducing the simplex to the smallest one containing that
+ * point. Returns the zero vector if a triangle contains the origin, in
+ * which case the triangle is kept.
+ */
+static vector_t closest_on_simplex(vector_t *simplex, size_t *count) {
+  if (*count == 1) {
+    return simplex[0];
+  }
+  if (*count == 2) {
+    return closest_on_segment(simplex, count);
+  }
+  vector_t a = simplex[0];
+  vector_t b = simplex[1];
+  vector_t c = simplex[2];
+  double area = vec_cross(vec_subtract(b, a), vec_subtract(c, a));
+  // A flat triangle contains nothing
+  if (area != 0.0 &&
+    vec_cross(vec_subtract(b, a), vec_negate(a)) * area >= 0.0 &&
+    vec_cross(vec_subtract(c, b), vec_negate(b)) * area >= 0.0 &&
+    vec_cross(vec_subtract(a, c), vec_negate(c)) * area >= 0.0) {
+    return VEC_ZERO;
+  }
+  // Outside the triangle, so the closest point is on one of its edges
+  vector_t best = VEC_ZERO;
+  vector_t best_simplex[2];
+  size_t best_count = 0;
+  double best_squared = INFINITY;
+  for (size_t i = 0; i < 3; i++) {
+    vector_t edge[2] = {simplex[i], simplex[(i + 1) % 3]};
+    size_t edge_count = 2;
+    vector_t closest = closest_on_segment(edge, &edge_count);
+    double squared = vec_dot(closest, closest);
+    if (squared < best_squared) {
+      best_squared = squared;
+      best = closest;
+      best_simplex[0] = edge[0];
+      best_simplex[1] = edge[1];
+      best_count = edge_count;
+    }
+  }
+  for (size_t i = 0; i < best_count; i++) {
+    simplex[i] = best_simplex[i];
+  }
+  *count = best_count;
+  return best;
+}
+
+/**
+ * Expands a triangle of the Minkowski difference that contains the origin
+ * until its edge closest to the origin is an edge of the difference itself.
+ * That edge's outward normal is the collision axis, and its distance from
+ * the origin the penetration depth.
+ */
+static void expand_polytope(const vector_t *points1, size_t n1,
+  const vector_t *points2, size_t n2, const vector_t *triangle,
+  collision_info_t *info) {
+  // The difference has at most n1 + n2 vertices, and each step adds one
+  size_t capacity = n1 + n2 + 3;
+  vector_t polytope[capacity];
+  size_t count = 3;
+  polytope[0] = triangle[0];
+  // Counterclockwise, so outward normals are the edges turned clockwise
+  if (vec_cross(vec_subtract(triangle[1], triangle[0]),
+    vec_subtract(triangle[2], triangle[0])) > 0.0) {
+    polytope[1] = triangle[1];
+    polytope[2] = triangle[2];
+  }
+  else {
+    polytope[1] = triangle[2];
+    polytope[2] = triangle[1];
+  }
+
+  while (true) {
+    size_t closest = 0;
+    double closest_distance = INFINITY;
+    vector_t closest_normal = VEC_ZERO;
+    for (size_t i = 0; i < count; i++) {
+      vector_t edge = vec_subtract(polytope[(i + 1) % count], polytope[i]);
+      double length = sqrt(vec_dot(edge, edge));
+      if (length == 0.0) {
+        continue;
+      }
+      vector_t normal = {edge.y / length, -edge.x / length};
+      double distance = vec_dot(normal, polytope[i]);
+      if (distance < closest_distance) {
+        closest_distance = distance;
+        closest = i;
+        closest_normal = normal;
+      }
+    }
+    vector_t point = minkowski_support(points1, n1, points2, n2,
+      closest_normal);
+    if (vec_dot(point, closest_normal) - closest_distance <= EPA_TOLERANCE ||
+      count == capacity) {
+      // Moving shape2 by the normal times the distance separates them
+      info->axis = closest_normal;
+      info->depth = closest_distance;
+      return;
+    }
+    for (size_t i = count; i > closest + 1; i--) {
+      polytope[i] = polytope[i - 1];
+    }
+    polytope[closest + 1] = point;
+    count++;
+  }
+}
+
+collision_info_t find_shape_collision_gjk(const shape_t *shape1,
+  const shape_t *shape2, vector_t direction) {
+  const vector_t *points1 = shape_const_points(shape1);
+  const vector_t *points2 = shape_const_points(shape2);
+  size_t n1 = shape_size(shape1);
+  size_t n2 = shape_size(shape2);
+  if (direction.x == 0.0 && direction.y == 0.0) {
+    direction = vec_subtract(points2[0], points1[0]);
+  }
+
+  // The simplex points, and the point of the simplex closest to the origin;
+  // the difference's support against -direction is as close as shape1
+  // gets to shape2 along direction
+  vector_t simplex[3];
+  size_t count = 1;
+  simplex[0] = minkowski_support(points1, n1, points2, n2,
+    vec_negate(direction));
+  vector_t closest = simplex[0];
+  collision_info_t info = {.collided = false, .axis = VEC_ZERO};
+  size_t max_iterations = n1 + n2 + 3;
+  for (size_t k = 0; k < max_iterations; k++) {
+    double squared = vec_dot(closest, closest);
+    if (squared < GJK_TOUCHING) {
+      break;
+    }
+    vector_t point = minkowski_support(points1, n1, points2, n2,
+      vec_negate(closest));
+    if (squared - vec_dot(point, closest) <= GJK_TOLERANCE * squared) {
+      // No point of the difference is closer to the origin
+      double distance = sqrt(squared);
+      info.distance = distance;
+      info.axis = vec_multiply(-1 / distance, closest);
+      return info;
+    }
+    simplex[count++] = point;
+    closest = closest_on_simplex(simplex, &count);
+  }
+
+  if (count < 3 || vec_dot(closest, closest) > 0.0) {
+    // The shapes only touch, so the penetration has no direction yet
+    return find_shape_collision(shape1, shape2);
+  }
+  info.collided = true;
+  info.distance = 0.0;
+  expand_polytope(points1, n1, points2, n2, simplex, &info);
+  if (info.depth <= EPA_TOLERANCE) {
+    // Within rounding of touching, where SAT's answer is the reference
+    return find_shape_collision(shape1, shape2);
+  }
+  find_shape_contacts(shape1, shape2, &info);
+  return info;
+}
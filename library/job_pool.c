@@ -0,0 +1,218 @@
+#include "job_pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * The chunks a thread still has to run, from head to tail - 1.
+ * The owner takes chunks from the head; thieves split off the tail.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  size_t head;
+  size_t tail;
+} job_deque_t;
+
+typedef struct {
+  struct job_pool *pool;
+  size_t index;
+} job_worker_t;
+
+typedef struct job_pool {
+  size_t thread_count;
+  pthread_t *threads;
+  job_worker_t *workers;
+  job_deque_t *deques;
+
+  // guards everything below
+  pthread_mutex_t lock;
+  // signalled when a loop is posted or the pool shuts down
+  pthread_cond_t start;
+  // signalled when the last worker finishes a loop
+  pthread_cond_t done;
+  size_t generation;
+  size_t busy;
+  bool shutdown;
+
+  // the loop being run
+  job_func_t func;
+  void *aux;
+  size_t count;
+  size_t grain;
+} job_pool_t;
+
+/**
+ * Takes the next chunk from a thread's own deque.
+ */
+static bool pop_chunk(job_deque_t *deque, size_t *chunk) {
+  pthread_mutex_lock(&deque->lock);
+  bool found = deque->head < deque->tail;
+  if (found) {
+    *chunk = deque->head++;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return found;
+}
+
+/**
+ * Moves half of the remaining chunks of some other thread into self's deque.
+ */
+static bool steal_chunks(job_pool_t *pool, size_t self) {
+  for (size_t k = 1; k < pool->thread_count; k++) {
+    job_deque_t *victim = &pool->deques[(self + k) % pool->thread_count];
+    pthread_mutex_lock(&victim->lock);
+    size_t left = victim->tail - victim->head;
+    size_t taken = (left + 1) / 2;
+    size_t mid = victim->tail - taken;
+    victim->tail = mid;
+    pthread_mutex_unlock(&victim->lock);
+    if (taken > 0) {
+      job_deque_t *own = &pool->deques[self];
+      pthread_mutex_lock(&own->lock);
+      own->head = mid;
+      own->tail = mid + taken;
+      pthread_mutex_unlock(&own->lock);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Runs chunks of the current loop until no thread has any left.
+ */
+static void run_chunks(job_pool_t *pool, size_t self) {
+  job_deque_t *own = &pool->deques[self];
+  while (true) {
+    size_t chunk;
+    if (pop_chunk(own, &chunk)) {
+      size_t begin = chunk * pool->grain;
+      size_t end = begin + pool->grain < pool->count ?
+        begin + pool->grain : pool->count;
+      pool->func(pool->aux, begin, end, self);
+    }
+    else if (!steal_chunks(pool, self)) {
+      return;
+    }
+  }
+}
+
+static void *worker_main(void *arg) {
+  job_worker_t *worker = arg;
+  job_pool_t *pool = worker->pool;
+  size_t seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (!pool->shutdown && pool->generation == seen) {
+      pthread_cond_wait(&pool->start, &pool->lock);
+    }
+    if (pool->shutdown) {
+      break;
+    }
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+    run_chunks(pool, worker->index);
+    pthread_mutex_lock(&pool->lock);
+    pool->busy--;
+    if (pool->busy == 0) {
+      pthread_cond_signal(&pool->done);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+job_pool_t *job_pool_init(size_t thread_count) {
+  assert(thread_count > 0);
+  job_pool_t *pool = malloc(sizeof(job_pool_t));
+  assert(pool != NULL);
+  pool->thread_count = thread_count;
+  pool->threads = malloc(thread_count * sizeof(pthread_t));
+  pool->workers = malloc(thread_count * sizeof(job_worker_t));
+  pool->deques = malloc(thread_count * sizeof(job_deque_t));
+  assert(pool->threads != NULL && pool->workers != NULL &&
+    pool->deques != NULL);
+  for (size_t t = 0; t < thread_count; t++) {
+    pthread_mutex_init(&pool->deques[t].lock, NULL);
+    pool->deques[t].head = 0;
+    pool->deques[t].tail = 0;
+    pool->workers[t] = (job_worker_t) {pool, t};
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  pool->generation = 0;
+  pool->busy = 0;
+  pool->shutdown = false;
+  pool->func = NULL;
+  pool->aux = NULL;
+  pool->count = 0;
+  pool->grain = 1;
+  // Thread 0 is whoever calls job_pool_parallel_for()
+  for (size_t t = 1; t < thread_count; t++) {
+    int error = pthread_create(&pool->threads[t], NULL, worker_main,
+      &pool->workers[t]);
+    assert(error == 0);
+  }
+  return pool;
+}
+
+void job_pool_free(job_pool_t *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t t = 1; t < pool->thread_count; t++) {
+    pthread_join(pool->threads[t], NULL);
+  }
+  for (size_t t = 0; t < pool->thread_count; t++) {
+    pthread_mutex_destroy(&pool->deques[t].lock);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->start);
+  pthread_cond_destroy(&pool->done);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool->deques);
+  free(pool);
+}
+
+size_t job_pool_threads(job_pool_t *pool) {
+  return pool == NULL ? 1 : pool->thread_count;
+}
+
+void job_pool_parallel_for(job_pool_t *pool, size_t count, size_t grain,
+  job_func_t func, void *aux) {
+  assert(grain > 0);
+  size_t chunks = (count + grain - 1) / grain;
+  if (pool == NULL || pool->thread_count == 1 || chunks <= 1) {
+    if (count > 0) {
+      func(aux, 0, count, 0);
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->func = func;
+  pool->aux = aux;
+  pool->count = count;
+  pool->grain = grain;
+  // Each thread starts with a contiguous block of chunks
+  for (size_t t = 0; t < pool->thread_count; t++) {
+    pool->deques[t].head = chunks * t / pool->thread_count;
+    pool->deques[t].tail = chunks * (t + 1) / pool->thread_count;
+  }
+  pool->busy = pool->thread_count - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  run_chunks(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy > 0) {
+    pthread_cond_wait(&pool->done, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
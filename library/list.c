@@ -26,8 +26,10 @@ list_t *list_init(size_t initial_size, free_func_t freer, equality_func_t eqr){
 }
 
 void list_free(list_t *list) {
-  for (int k = 0; k < (int)(list->size); k++) {
-      list->freer(list->lst[k]);
+  if (list->freer != NULL) {
+    for (int k = 0; k < (int)(list->size); k++) {
+        list->freer(list->lst[k]);
+    }
   }
   free(list->lst);
   free(list);
@@ -63,6 +65,24 @@ void *list_remove(list_t *list, size_t index) {
   return toReturn;
 }
 
+size_t list_remove_if(list_t *list, predicate_func_t should_remove,
+  void *aux) {
+  size_t kept = 0;
+  for (size_t k = 0; k < list->size; k++) {
+    void *value = list->lst[k];
+    if (!should_remove(value, aux)) {
+      list->lst[kept] = value;
+      kept++;
+    }
+  }
+  size_t removed = list->size - kept;
+  for (size_t k = kept; k < list->size; k++) {
+    list->lst[k] = NULL;
+  }
+  list->size = kept;
+  return removed;
+}
+
 bool list_contains(list_t *list, void *value) {
   for (size_t i = 0; i < list->size; i++) {
     if (list->eqr(value, list_get(list, i))) {
@@ -1,8 +1,15 @@
 #include "polygon.h"
+#include <assert.h>
+#include <stdlib.h>
 #include "list.h"
+#include "shape.h"
 #include "vector.h"
+#include <math.h>
+#include <stdbool.h>
 
 const double SIX = 6.0;
+// Unit normals whose cross product is smaller than this are parallel
+const double PARALLEL_TOLERANCE = 1e-9;
 
 double polygon_area(list_t *polygon) {
     double det_sum = 0.0;
@@ -50,3 +57,328 @@ void polygon_rotate(list_t *polygon, double angle, vector_t point) {
     // Translates polygon back to its original frame
     polygon_translate(polygon, point);
 }
+
+double shape_area(const shape_t *shape) {
+    double det_sum = 0.0;
+    size_t num_vertices = shape_size(shape);
+    const vector_t *points = shape_const_points(shape);
+    for (size_t k = 0; k < num_vertices; k++) {
+      det_sum += vec_cross(points[k], points[(k + 1) % num_vertices]);
+    }
+    return det_sum / 2;
+}
+
+vector_t shape_centroid(const shape_t *shape) {
+    double area = shape_area(shape);
+    double centroid_x = 0.0;
+    double centroid_y = 0.0;
+    size_t num_vertices = shape_size(shape);
+    const vector_t *points = shape_const_points(shape);
+    for (size_t k = 0; k < num_vertices; k++) {
+        vector_t coord_k = points[k];
+        vector_t coord_k1 = points[(k + 1) % num_vertices];
+        double det = vec_cross(coord_k, coord_k1);
+        centroid_x += (1 / (SIX * area) * (coord_k.x + coord_k1.x) * det);
+        centroid_y += (1 / (SIX * area) * (coord_k.y + coord_k1.y) * det);
+    }
+    vector_t ans = {centroid_x, centroid_y};
+    return ans;
+}
+
+double shape_radius(const shape_t *shape, vector_t center) {
+    double max_squared = 0.0;
+    size_t num_vertices = shape_size(shape);
+    const vector_t *points = shape_const_points(shape);
+    for (size_t k = 0; k < num_vertices; k++) {
+        vector_t offset = vec_subtract(points[k], center);
+        double squared = vec_dot(offset, offset);
+        if (squared > max_squared) {
+            max_squared = squared;
+        }
+    }
+    return sqrt(max_squared);
+}
+
+void shape_unique_normals(const shape_t *shape, shape_t *normals) {
+    size_t num_vertices = shape_size(shape);
+    const vector_t *points = shape_const_points(shape);
+    for (size_t k = 0; k < num_vertices; k++) {
+        vector_t edge = vec_subtract(points[(k + 1) % num_vertices],
+          points[k]);
+        double length = sqrt(vec_dot(edge, edge));
+        if (length == 0.0) {
+            continue;
+        }
+        vector_t normal = {edge.y / length, -edge.x / length};
+        bool parallel = false;
+        for (size_t j = 0; j < shape_size(normals) && !parallel; j++) {
+            parallel = fabs(vec_cross(normal, shape_get(normals, j))) <
+              PARALLEL_TOLERANCE;
+        }
+        if (!parallel) {
+            shape_add(normals, normal);
+        }
+    }
+}
+
+bool shape_is_convex(const shape_t *shape) {
+    size_t num_vertices = shape_size(shape);
+    const vector_t *points = shape_const_points(shape);
+    bool left = false;
+    bool right = false;
+    for (size_t k = 0; k < num_vertices; k++) {
+        vector_t a = points[k];
+        vector_t b = points[(k + 1) % num_vertices];
+        vector_t c = points[(k + 2) % num_vertices];
+        double turn = vec_cross(vec_subtract(b, a), vec_subtract(c, b));
+        left = left || turn > 0.0;
+        right = right || turn < 0.0;
+    }
+    return !(left && right);
+}
+
+/**
+ * Checks whether p lies inside or on the counterclockwise triangle abc.
+ */
+static bool in_triangle(vector_t p, vector_t a, vector_t b, vector_t c) {
+    return vec_cross(vec_subtract(b, a), vec_subtract(p, a)) >= 0.0 &&
+      vec_cross(vec_subtract(c, b), vec_subtract(p, b)) >= 0.0 &&
+      vec_cross(vec_subtract(a, c), vec_subtract(p, c)) >= 0.0;
+}
+
+/**
+ * Checks whether the vertex at position i of the remaining polygon can be
+ * cut off as a triangle: it turns left, and no other remaining vertex lies
+ * in the triangle.
+ */
+static bool is_ear(const vector_t *points, const size_t *remaining,
+  size_t count, size_t i) {
+    vector_t a = points[remaining[(i + count - 1) % count]];
+    vector_t b = points[remaining[i]];
+    vector_t c = points[remaining[(i + 1) % count]];
+    if (vec_cross(vec_subtract(b, a), vec_subtract(c, b)) <= 0.0) {
+        return false;
+    }
+    for (size_t k = 0; k < count; k++) {
+        size_t j = remaining[k];
+        if (k == i || k == (i + 1) % count || k == (i + count - 1) % count) {
+            continue;
+        }
+        if (in_triangle(points[j], a, b, c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Merges two counterclockwise polygons that share the edge from a to b in
+ * the first (and from b to a in the second) into dest.
+ */
+static void merge_pieces(const shape_t *first, size_t a, const shape_t *second,
+  size_t b, shape_t *dest) {
+    size_t n1 = shape_size(first);
+    size_t n2 = shape_size(second);
+    shape_init(dest, n1 + n2 - 2);
+    // The first piece from the end of the shared edge round to its start,
+    // then the second piece between the shared vertices
+    for (size_t k = 1; k <= n1; k++) {
+        shape_add(dest, shape_get(first, (a + k) % n1));
+    }
+    for (size_t k = 2; k < n2; k++) {
+        shape_add(dest, shape_get(second, (b + k) % n2));
+    }
+}
+
+static bool same_point(vector_t a, vector_t b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+/**
+ * Merges one pair of neighbouring pieces whose union is convex.
+ * Returns false if there is no such pair.
+ */
+static bool merge_one(shape_t *pieces, size_t *count) {
+    for (size_t i = 0; i < *count; i++) {
+        size_t n1 = shape_size(&pieces[i]);
+        for (size_t a = 0; a < n1; a++) {
+            vector_t start = shape_get(&pieces[i], a);
+            vector_t end = shape_get(&pieces[i], (a + 1) % n1);
+            for (size_t j = i + 1; j < *count; j++) {
+                size_t n2 = shape_size(&pieces[j]);
+                for (size_t b = 0; b < n2; b++) {
+                    if (!same_point(shape_get(&pieces[j], b), end) ||
+                      !same_point(shape_get(&pieces[j], (b + 1) % n2),
+                      start)) {
+                        continue;
+                    }
+                    shape_t merged;
+                    merge_pieces(&pieces[i], a, &pieces[j], b, &merged);
+                    if (!shape_is_convex(&merged)) {
+                        shape_release(&merged);
+                        continue;
+                    }
+                    shape_release(&pieces[i]);
+                    shape_release(&pieces[j]);
+                    pieces[i] = merged;
+                    pieces[j] = pieces[--*count];
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+shape_t *shape_decompose(const shape_t *shape, size_t *count) {
+    size_t num_vertices = shape_size(shape);
+    assert(num_vertices >= 3);
+    // Ear clipping wants the vertices counterclockwise
+    vector_t points[num_vertices];
+    bool reversed = shape_area(shape) < 0.0;
+    for (size_t k = 0; k < num_vertices; k++) {
+        points[k] = shape_get(shape, reversed ? num_vertices - 1 - k : k);
+    }
+    size_t remaining[num_vertices];
+    for (size_t k = 0; k < num_vertices; k++) {
+        remaining[k] = k;
+    }
+
+    // A triangulation has num_vertices - 2 triangles
+    shape_t *pieces = malloc((num_vertices - 2) * sizeof(shape_t));
+    assert(pieces != NULL);
+    *count = 0;
+    size_t left = num_vertices;
+    while (left > 3) {
+        size_t ear = 0;
+        while (ear < left && !is_ear(points, remaining, left, ear)) {
+            ear++;
+        }
+        // Rounding can leave no ear in a nearly degenerate polygon; cutting
+        // any corner still covers it
+        if (ear == left) {
+            ear = 0;
+        }
+        shape_t *triangle = &pieces[(*count)++];
+        shape_init(triangle, 3);
+        shape_add(triangle, points[remaining[(ear + left - 1) % left]]);
+        shape_add(triangle, points[remaining[ear]]);
+        shape_add(triangle, points[remaining[(ear + 1) % left]]);
+        for (size_t k = ear; k + 1 < left; k++) {
+            remaining[k] = remaining[k + 1];
+        }
+        left--;
+    }
+    shape_t *triangle = &pieces[(*count)++];
+    shape_init(triangle, 3);
+    for (size_t k = 0; k < 3; k++) {
+        shape_add(triangle, points[remaining[k]]);
+    }
+
+    while (merge_one(pieces, count)) {
+    }
+    return pieces;
+}
+
+bool shape_contains(const shape_t *shape, vector_t point) {
+  const vector_t *points = shape_const_points(shape);
+  size_t n = shape_size(shape);
+  // Counts the edges crossed by a ray from the point towards +x
+  bool inside = false;
+  for (size_t i = 0, j = n - 1; i < n; j = i++) {
+    vector_t a = points[i];
+    vector_t b = points[j];
+    if ((a.y > point.y) != (b.y > point.y) &&
+      point.x < a.x + (point.y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+double shape_distance(const shape_t *shape, vector_t point) {
+  if (shape_contains(shape, point)) {
+    return 0.0;
+  }
+  const vector_t *points = shape_const_points(shape);
+  size_t n = shape_size(shape);
+  double best = INFINITY;
+  for (size_t i = 0; i < n; i++) {
+    vector_t a = points[i];
+    vector_t edge = vec_subtract(points[(i + 1) % n], a);
+    vector_t offset = vec_subtract(point, a);
+    double length_squared = vec_dot(edge, edge);
+    double t = length_squared == 0.0 ? 0.0 :
+      vec_dot(offset, edge) / length_squared;
+    t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+    vector_t gap = vec_subtract(offset, vec_multiply(t, edge));
+    double distance_squared = vec_dot(gap, gap);
+    best = distance_squared < best ? distance_squared : best;
+  }
+  return sqrt(best);
+}
+
+bool shape_ray_cast(const shape_t *shape, vector_t origin,
+  vector_t translation, double *fraction) {
+  if (shape_contains(shape, origin)) {
+    *fraction = 0.0;
+    return true;
+  }
+  const vector_t *points = shape_const_points(shape);
+  size_t n = shape_size(shape);
+  bool hit = false;
+  double first = 1.0;
+  for (size_t i = 0; i < n; i++) {
+    vector_t a = points[i];
+    vector_t edge = vec_subtract(points[(i + 1) % n], a);
+    double denominator = vec_cross(translation, edge);
+    // Segments parallel to an edge meet it at the neighbouring edges
+    if (denominator == 0.0) {
+      continue;
+    }
+    vector_t offset = vec_subtract(a, origin);
+    double t = vec_cross(offset, edge) / denominator;
+    double u = vec_cross(offset, translation) / denominator;
+    if (t >= 0.0 && t <= first && u >= 0.0 && u <= 1.0) {
+      first = t;
+      hit = true;
+    }
+  }
+  if (hit) {
+    *fraction = first;
+  }
+  return hit;
+}
+
+void shape_translate(shape_t *shape, vector_t translation) {
+  size_t num_vertices = shape_size(shape);
+  vector_t *points = shape_points(shape);
+  for (size_t k = 0; k < num_vertices; k++) {
+      points[k] = vec_add(points[k], translation);
+  }
+}
+
+void shape_rotate(shape_t *shape, double angle, vector_t point) {
+    size_t num_vertices = shape_size(shape);
+    vector_t *points = shape_points(shape);
+    for (size_t k = 0; k < num_vertices; k++) {
+        vector_t rotated = vec_rotate(vec_subtract(points[k], point), angle);
+        points[k] = vec_add(rotated, point);
+    }
+}
+
+void shape_transform(shape_t *dest, const shape_t *src, vector_t translation,
+  double angle) {
+    shape_copy(dest, src);
+    size_t num_vertices = shape_size(dest);
+    vector_t *points = shape_points(dest);
+    double c = cos(angle);
+    double s = sin(angle);
+    for (size_t k = 0; k < num_vertices; k++) {
+        vector_t v = points[k];
+        points[k] = (vector_t) {
+          translation.x + v.x * c - v.y * s,
+          translation.y + v.x * s + v.y * c
+        };
+    }
+}
@@ -0,0 +1,163 @@
+#include "projection.h"
+#include <assert.h>
+#include <pthread.h>
+#include "vector.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROJECTION_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*project_func_t)(const vector_t *points, size_t n,
+  const vector_t *axes, size_t axis_count, double *mins, double *maxes);
+
+/**
+ * The reference kernel, one axis at a time. The SIMD kernels compute each
+ * projection with the same multiplications and addition, and keep the
+ * same extreme when two projections tie, so they match it exactly.
+ */
+static void project_scalar(const vector_t *points, size_t n,
+  const vector_t *axes, size_t axis_count, double *mins, double *maxes) {
+  for (size_t a = 0; a < axis_count; a++) {
+    vector_t axis = axes[a];
+    double lo = points[0].x * axis.x + points[0].y * axis.y;
+    double hi = lo;
+    for (size_t i = 1; i < n; i++) {
+      double proj = points[i].x * axis.x + points[i].y * axis.y;
+      lo = proj < lo ? proj : lo;
+      hi = proj > hi ? proj : hi;
+    }
+    mins[a] = lo;
+    maxes[a] = hi;
+  }
+}
+
+#ifdef PROJECTION_X86
+/**
+ * Projects onto two axes at a time, with the x coordinates of both axes in
+ * one register and the y coordinates in another.
+ */
+__attribute__((target("sse2")))
+static void project_sse2(const vector_t *points, size_t n,
+  const vector_t *axes, size_t axis_count, double *mins, double *maxes) {
+  size_t a = 0;
+  for (; a + 2 <= axis_count; a += 2) {
+    __m128d first = _mm_loadu_pd(&axes[a].x);
+    __m128d second = _mm_loadu_pd(&axes[a + 1].x);
+    __m128d ax = _mm_unpacklo_pd(first, second);
+    __m128d ay = _mm_unpackhi_pd(first, second);
+    __m128d lo = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(points[0].x), ax),
+      _mm_mul_pd(_mm_set1_pd(points[0].y), ay));
+    __m128d hi = lo;
+    for (size_t i = 1; i < n; i++) {
+      __m128d proj = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(points[i].x), ax),
+        _mm_mul_pd(_mm_set1_pd(points[i].y), ay));
+      // min(a, b) is a < b ? a : b, so ties keep the earlier extreme
+      lo = _mm_min_pd(proj, lo);
+      hi = _mm_max_pd(proj, hi);
+    }
+    _mm_storeu_pd(mins + a, lo);
+    _mm_storeu_pd(maxes + a, hi);
+  }
+  project_scalar(points, n, axes + a, axis_count - a, mins + a, maxes + a);
+}
+
+/**
+ * Projects onto four axes at a time, like project_sse2().
+ */
+__attribute__((target("avx2")))
+static void project_avx2(const vector_t *points, size_t n,
+  const vector_t *axes, size_t axis_count, double *mins, double *maxes) {
+  size_t a = 0;
+  for (; a + 4 <= axis_count; a += 4) {
+    __m256d first = _mm256_loadu_pd(&axes[a].x);
+    __m256d second = _mm256_loadu_pd(&axes[a + 2].x);
+    // Unpacking works within 128-bit halves, giving axes 0, 2, 1, 3
+    __m256d ax = _mm256_permute4x64_pd(_mm256_unpacklo_pd(first, second),
+      0xD8);
+    __m256d ay = _mm256_permute4x64_pd(_mm256_unpackhi_pd(first, second),
+      0xD8);
+    __m256d lo = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(points[0].x),
+      ax), _mm256_mul_pd(_mm256_set1_pd(points[0].y), ay));
+    __m256d hi = lo;
+    for (size_t i = 1; i < n; i++) {
+      __m256d proj = _mm256_add_pd(
+        _mm256_mul_pd(_mm256_set1_pd(points[i].x), ax),
+        _mm256_mul_pd(_mm256_set1_pd(points[i].y), ay));
+      lo = _mm256_min_pd(proj, lo);
+      hi = _mm256_max_pd(proj, hi);
+    }
+    _mm256_storeu_pd(mins + a, lo);
+    _mm256_storeu_pd(maxes + a, hi);
+  }
+  // Mixing in the SSE2 kernel's instructions with the upper halves of the
+  // registers still in use stalls some CPUs
+  _mm256_zeroupper();
+  project_sse2(points, n, axes + a, axis_count - a, mins + a, maxes + a);
+}
+#endif
+
+static projection_kernel_t kernel = PROJECTION_SCALAR;
+static project_func_t kernel_func = project_scalar;
+static pthread_once_t kernel_chosen = PTHREAD_ONCE_INIT;
+
+static project_func_t find_kernel_func(projection_kernel_t choice) {
+  switch (choice) {
+#ifdef PROJECTION_X86
+    case PROJECTION_SSE2:
+      return project_sse2;
+    case PROJECTION_AVX2:
+      return project_avx2;
+#endif
+    default:
+      return project_scalar;
+  }
+}
+
+/**
+ * Picks the widest kernel the CPU supports, once per process.
+ */
+static void choose_kernel(void) {
+  if (projection_kernel_supported(PROJECTION_AVX2)) {
+    kernel = PROJECTION_AVX2;
+  }
+  else if (projection_kernel_supported(PROJECTION_SSE2)) {
+    kernel = PROJECTION_SSE2;
+  }
+  kernel_func = find_kernel_func(kernel);
+}
+
+void project_points(const vector_t *points, size_t n, const vector_t *axes,
+  size_t axis_count, double *mins, double *maxes) {
+  assert(n > 0);
+  pthread_once(&kernel_chosen, choose_kernel);
+  kernel_func(points, n, axes, axis_count, mins, maxes);
+}
+
+bool projection_kernel_supported(projection_kernel_t choice) {
+#ifdef PROJECTION_X86
+  __builtin_cpu_init();
+  switch (choice) {
+    case PROJECTION_SCALAR:
+      return true;
+    case PROJECTION_SSE2:
+      return __builtin_cpu_supports("sse2");
+    case PROJECTION_AVX2:
+      return __builtin_cpu_supports("avx2");
+  }
+  return false;
+#else
+  return choice == PROJECTION_SCALAR;
+#endif
+}
+
+projection_kernel_t projection_get_kernel(void) {
+  pthread_once(&kernel_chosen, choose_kernel);
+  return kernel;
+}
+
+void projection_set_kernel(projection_kernel_t choice) {
+  assert(projection_kernel_supported(choice));
+  pthread_once(&kernel_chosen, choose_kernel);
+  kernel = choice;
+  kernel_func = find_kernel_func(choice);
+}
@@ -7,15 +7,169 @@
 #include "polygon.h"
 #include "body.h"
 #include "list.h"
+#include "aabb_tree.h"
+#include "axis_cache.h"
+#include "body_store.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "contact_solver.h"
+#include "job_pool.h"
+#include <math.h>
+#include <string.h>
 
 const int NUMBER_BODIES = 10;
+// Grid cell size used when a rule is added before any broadphase is chosen
+const double DEFAULT_CELL_SIZE = 64.0;
+// Items per job_pool chunk in the parallel parts of scene_tick(); a multiple
+// of the body store's vector width so store ranges stay aligned
+const size_t SCENE_GRAIN = 512;
+// Sleep thresholds until scene_set_sleep_thresholds() is called
+const double DEFAULT_SLEEP_SPEED = 1.0;
+const double DEFAULT_SLEEP_ACCELERATION = 1.0;
+const double DEFAULT_SLEEP_TIME = 0.5;
+// How far the query tree fattens a body's box when the body leaves it, so
+// bodies that only jiggle do not touch the tree
+const double QUERY_MARGIN = 2.0;
+// Contact solver sweeps until scene_set_solver_iterations() is called
+const size_t DEFAULT_SOLVER_ITERATIONS = 10;
 
+/**
+ * The narrowphase result for one broadphase pair, or tested == false if no
+ * rule applied to the pair when the narrowphase ran.
+ */
+typedef struct {
+  bool tested;
+  collision_info_t info;
+  // whether the bounding circles or boxes were enough to tell the bodies
+  // apart (see bodies_may_collide())
+  bool bounds_rejected;
+  // the axis that decided the test, and whether it came from the cache
+  vector_t axis;
+  bool cache_hit;
+} pair_result_t;
+
+/**
+ * Where deterministic threading puts the typed forces' contributions
+ * (see force_records_contribute()), and which slots belong to each body:
+ * body i owns slots[starts[i]] to slots[starts[i + 1] - 1], in increasing
+ * order. Only rebuilt when bodies or typed forces are added or removed.
+ */
+typedef struct {
+  bool dirty;
+  vector_t *contributions;
+  body_t **owners;
+  size_t slot_capacity;
+  size_t *slots;
+  size_t *starts;
+  size_t *cursors;
+  size_t body_capacity;
+} contribution_index_t;
+
+/**
+ * A body's node in the union-find forest of islands. The flags are only
+ * meaningful on the root of each island.
+ */
+typedef struct {
+  size_t parent;
+  // some body of the island moved or was removed this tick
+  bool moving;
+  // some body of the island has not rested for long enough to sleep
+  bool restless;
+} island_node_t;
+
+/**
+ * A bullet (see body_set_bullet()) about to be integrated, and where it
+ * started the tick.
+ */
+typedef struct {
+  body_t *body;
+  vector_t start;
+} bullet_move_t;
+
+/**
+ * Grows an array to hold at least needed elements.
+ */
+static void *reserve(void *array, size_t *capacity, size_t needed,
+  size_t elem_size) {
+  if (needed <= *capacity) {
+    return array;
+  }
+  *capacity = needed > 2 * *capacity ? needed : 2 * *capacity;
+  array = realloc(array, *capacity * elem_size);
+  assert(array != NULL);
+  return array;
+}
+
+typedef struct scene {
+  list_t *bodies;
+  // every force, and the FORCE_CALLBACK ones among them in insertion order
+  list_t *forces;
+  list_t *callbacks;
+  force_records_t *records;
+  // the shape that is at the top of game
+  body_t *top;
+  // current score of the scene
+  int score;
+  // if non-NULL, the SoA store holding every body's hot state
+  body_store_t *store;
+  // collision rules, and the broadphase that feeds them candidate pairs
+  list_t *rules;
+  broadphase_t *broadphase;
+  // the axis that decided each rule pair's last narrowphase test, and the
+  // test run on the pairs the axis does not separate
+  axis_cache_t *axis_cache;
+  narrowphase_t narrowphase;
+  // resolves the contacts of contact rules and contact forces
+  contact_solver_t *solver;
+  // if non-NULL, Barnes-Hut gravity between all bodies
+  barnes_hut_t *gravity_field;
+  // if non-NULL, the bounding box tree the scene_query_*() functions search,
+  // built by the first query
+  aabb_tree_t *query_tree;
+  // if non-NULL, the threads that run the parallel parts of scene_tick(),
+  // with one force accumulator per body per thread
+  job_pool_t *pool;
+  vector_t *thread_forces;
+  size_t thread_forces_capacity;
+  pair_result_t *pair_results;
+  size_t pair_results_capacity;
+  // whether threads sum forces in a fixed order (scene_set_deterministic())
+  bool deterministic;
+  contribution_index_t contribution_index;
+  // set by force_remove() so scene_tick() only looks for dead forces
+  // when there are some
+  bool forces_removed;
+  // scratch lists reused by scene_tick() while retiring forces
+  list_t *retired_forces;
+  list_t *stale_bodies;
+  // automatic sleeping (scene_set_sleeping()) and its thresholds
+  bool sleeping;
+  double sleep_speed;
+  double sleep_acceleration;
+  double sleep_time;
+  island_node_t *islands;
+  size_t islands_capacity;
+  // the bullets integrated this tick, reused every tick
+  bullet_move_t *bullets;
+  size_t bullet_count;
+  size_t bullets_capacity;
+  scene_stats_t stats;
+} scene_t;
+
+/**
+ * A handle to a force. FORCE_CALLBACK forces call forcer on aux; every other
+ * kind lives in its scene's force_records_t at index.
+ */
 typedef struct force {
   void *aux;
   force_creator_t forcer;
   free_func_t freer;
   list_t *bodies;
   int forRemoval;
+  force_kind_t kind;
+  size_t index;
+  // the scene holding the force, if any
+  scene_t *scene;
 } force_t;
 
 force_t *force_init(void *aux, force_creator_t forcer, free_func_t freer) {
@@ -26,6 +180,9 @@ force_t *force_init(void *aux, force_creator_t forcer, free_func_t freer) {
   toReturn->freer = freer;
   toReturn->bodies = NULL;
   toReturn->forRemoval = 0;
+  toReturn->kind = FORCE_CALLBACK;
+  toReturn->index = 0;
+  toReturn->scene = NULL;
   return toReturn;
 }
 
@@ -38,6 +195,9 @@ force_t *force_init2(void *aux, force_creator_t forcer, free_func_t freer, \
 
 void force_remove(force_t *f){
   f->forRemoval = 1;
+  if (f->scene != NULL) {
+    f->scene->forces_removed = true;
+  }
 }
 
 int force_is_removed(force_t *f){
@@ -45,20 +205,39 @@ int force_is_removed(force_t *f){
 }
 
 void force_free(force_t *f) {
+  if (f->kind != FORCE_CALLBACK) {
+    force_records_remove(f->scene->records, f->kind, f->index);
+    f->scene->contribution_index.dirty = true;
+  }
   if (f->freer != NULL) {
     f->freer(f->aux);
   }
+  if (f->bodies != NULL) {
+    list_free(f->bodies);
+  }
   free(f);
 }
 
-typedef struct scene {
-  list_t *bodies;
-  list_t *forces;
-  // the shape that is at the top of game
-  body_t *top;
-  // current score of the scene
-  int score;
-} scene_t;
+/**
+ * A collision rule: calls handler on every colliding pair whose first body
+ * has a bit in categories1 and whose second body has a bit in categories2.
+ * A rule without a handler hands the pairs' contacts to the contact solver.
+ */
+typedef struct collision_rule {
+  unsigned int categories1;
+  unsigned int categories2;
+  collision_handler_t handler;
+  void *aux;
+  free_func_t freer;
+  double elasticity;
+} collision_rule_t;
+
+static void collision_rule_free(collision_rule_t *rule) {
+  if (rule->freer != NULL) {
+    rule->freer(rule->aux);
+  }
+  free(rule);
+}
 
 scene_t *scene_init(void) {
   scene_t *toReturn = malloc(sizeof(scene_t));
@@ -66,14 +245,76 @@ scene_t *scene_init(void) {
   toReturn->bodies = list_init(NUMBER_BODIES, (free_func_t) body_free,
     (equality_func_t) body_equals);
   toReturn->forces = list_init(1, (free_func_t) force_free, NULL);
+  toReturn->callbacks = list_init(1, NULL, NULL);
+  toReturn->records = force_records_init();
+  toReturn->forces_removed = false;
   toReturn->top = NULL;
   toReturn->score = 0;
+  toReturn->store = NULL;
+  toReturn->rules = list_init(1, (free_func_t) collision_rule_free, NULL);
+  toReturn->broadphase = NULL;
+  toReturn->axis_cache = axis_cache_init();
+  toReturn->narrowphase = NARROWPHASE_SAT;
+  toReturn->solver = contact_solver_init(DEFAULT_SOLVER_ITERATIONS);
+  toReturn->gravity_field = NULL;
+  toReturn->query_tree = NULL;
+  toReturn->pool = NULL;
+  toReturn->thread_forces = NULL;
+  toReturn->thread_forces_capacity = 0;
+  toReturn->pair_results = NULL;
+  toReturn->pair_results_capacity = 0;
+  toReturn->deterministic = false;
+  toReturn->contribution_index = (contribution_index_t) {true, NULL, NULL, 0,
+    NULL, NULL, NULL, 0};
+  toReturn->retired_forces = list_init(1, NULL, NULL);
+  toReturn->stale_bodies = list_init(1, NULL, NULL);
+  toReturn->sleeping = false;
+  toReturn->sleep_speed = DEFAULT_SLEEP_SPEED;
+  toReturn->sleep_acceleration = DEFAULT_SLEEP_ACCELERATION;
+  toReturn->sleep_time = DEFAULT_SLEEP_TIME;
+  toReturn->islands = NULL;
+  toReturn->islands_capacity = 0;
+  toReturn->bullets = NULL;
+  toReturn->bullet_count = 0;
+  toReturn->bullets_capacity = 0;
+  toReturn->stats = (scene_stats_t) {0};
   return toReturn;
 }
 
 void scene_free(scene_t *scene) {
   list_free(scene->bodies);
   list_free(scene->forces);
+  list_free(scene->callbacks);
+  force_records_free(scene->records);
+  if (scene->store != NULL) {
+    body_store_free(scene->store);
+  }
+  list_free(scene->rules);
+  if (scene->broadphase != NULL) {
+    broadphase_free(scene->broadphase);
+  }
+  axis_cache_free(scene->axis_cache);
+  contact_solver_free(scene->solver);
+  if (scene->gravity_field != NULL) {
+    barnes_hut_free(scene->gravity_field);
+  }
+  if (scene->query_tree != NULL) {
+    aabb_tree_free(scene->query_tree);
+  }
+  if (scene->pool != NULL) {
+    job_pool_free(scene->pool);
+  }
+  free(scene->thread_forces);
+  free(scene->pair_results);
+  free(scene->contribution_index.contributions);
+  free(scene->contribution_index.owners);
+  free(scene->contribution_index.slots);
+  free(scene->contribution_index.starts);
+  free(scene->contribution_index.cursors);
+  list_free(scene->retired_forces);
+  list_free(scene->stale_bodies);
+  free(scene->islands);
+  free(scene->bullets);
   free(scene);
 }
 
@@ -107,6 +348,37 @@ void scene_add_score(scene_t *scene, int to_add){
 
 void scene_add_body(scene_t *scene, body_t *body) {
   list_add(scene->bodies, body);
+  scene->contribution_index.dirty = true;
+  if (scene->store != NULL) {
+    if (body_is_asleep(body)) {
+      body->sleep_store = scene->store;
+    }
+    else {
+      body_store_add(scene->store, body);
+    }
+  }
+}
+
+void scene_use_body_store(scene_t *scene, bool enabled) {
+  if (enabled && scene->store == NULL) {
+    scene->store = body_store_init(scene_bodies(scene));
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+      body_t *body = scene_get_body(scene, i);
+      if (body_is_asleep(body)) {
+        body->sleep_store = scene->store;
+      }
+      else {
+        body_store_add(scene->store, body);
+      }
+    }
+  }
+  else if (!enabled && scene->store != NULL) {
+    body_store_free(scene->store);
+    scene->store = NULL;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+      scene_get_body(scene, i)->sleep_store = NULL;
+    }
+  }
 }
 
 //deprecated
@@ -114,55 +386,966 @@ void scene_remove_body(scene_t *scene, size_t index) {
   body_remove(scene_get_body(scene, index));
 }
 
+static bool is_same_force(void *force, void *aux) {
+  return force == aux;
+}
+
 void scene_remove_force(scene_t *scene, size_t index) {
-  list_remove(scene->forces, index);
+  force_t *f = list_remove(scene->forces, index);
+  if (f->kind == FORCE_CALLBACK) {
+    list_remove_if(scene->callbacks, is_same_force, f);
+  }
+  for (size_t i = 0; i < list_size(f->bodies); i++) {
+    body_t *body = list_get(f->bodies, i);
+    list_remove_if(body->forces, is_same_force, f);
+  }
+  force_free(f);
 }
 
 //deprecated
 void scene_add_force_creator(scene_t *scene, force_creator_t forcer, void *aux,
                              free_func_t freer) {
-  scene_add_bodies_force_creator(scene, forcer, aux, list_init(1, freer, NULL), freer);
+  scene_add_bodies_force_creator(scene, forcer, aux, list_init(1, NULL, NULL),
+    freer);
+}
 
+/**
+ * Adds a force to a scene and to the back-reference lists of its bodies,
+ * and wakes the bodies up so that the force can move them.
+ */
+static void scene_register_force(scene_t *scene, force_t *f) {
+  f->scene = scene;
+  list_add(scene->forces, f);
+  scene->contribution_index.dirty = true;
+  for (size_t i = 0; i < list_size(f->bodies); i++) {
+    body_t *body = list_get(f->bodies, i);
+    list_add(body->forces, f);
+    body_set_asleep(body, false);
+  }
 }
 
 void scene_add_bodies_force_creator(scene_t *scene, force_creator_t forcer, \
   void *aux, list_t *bodies, free_func_t freer){
-  list_add(scene->forces, force_init2(aux, forcer, freer, bodies));
+  force_t *f = force_init2(aux, forcer, freer, bodies);
+  scene_register_force(scene, f);
+  list_add(scene->callbacks, f);
 }
 
-void scene_tick(scene_t *scene, double dt) {
+/**
+ * Makes the list of bodies a typed force depends on, skipping NULL bodies.
+ */
+static list_t *force_bodies(body_t *body1, body_t *body2) {
+  list_t *bodies = list_init(2, NULL, NULL);
+  if (body1 != NULL) {
+    list_add(bodies, body1);
+  }
+  if (body2 != NULL) {
+    list_add(bodies, body2);
+  }
+  return bodies;
+}
 
-  for (size_t n = 0; n < list_size(scene->forces); n++) {
-    force_t *f = list_get(scene->forces, n);
-    f->forcer(f->aux);
+void scene_add_typed_force(scene_t *scene, force_kind_t kind, double constant,
+  body_t *body1, body_t *body2) {
+  force_t *f = force_init2(NULL, NULL, NULL, force_bodies(body1, body2));
+  f->kind = kind;
+  force_records_add(scene->records, kind, constant, body1, body2, &f->index);
+  scene_register_force(scene, f);
+}
+
+void scene_add_collision_force(scene_t *scene, body_t *body1, body_t *body2,
+  collision_handler_t handler, void *aux, free_func_t freer) {
+  force_t *f = force_init2(NULL, NULL, NULL, force_bodies(body1, body2));
+  f->kind = FORCE_COLLISION;
+  force_records_add_collision(scene->records, body1, body2, handler, aux,
+    freer, &f->index);
+  scene_register_force(scene, f);
+}
+
+void scene_add_contact_force(scene_t *scene, double elasticity,
+  body_t *body1, body_t *body2) {
+  force_t *f = force_init2(NULL, NULL, NULL, force_bodies(body1, body2));
+  f->kind = FORCE_COLLISION;
+  force_records_add_contact(scene->records, elasticity, body1, body2,
+    &f->index);
+  scene_register_force(scene, f);
+}
+
+void scene_set_solver_iterations(scene_t *scene, size_t iterations) {
+  contact_solver_set_iterations(scene->solver, iterations);
+}
+
+void scene_set_position_correction(scene_t *scene, double bias,
+  double slop) {
+  contact_solver_set_correction(scene->solver, bias, slop);
+}
+
+void scene_set_threads(scene_t *scene, size_t threads) {
+  assert(threads > 0);
+  if (scene->pool != NULL) {
+    job_pool_free(scene->pool);
+  }
+  scene->pool = threads > 1 ? job_pool_init(threads) : NULL;
+}
+
+void scene_set_deterministic(scene_t *scene, bool deterministic) {
+  scene->deterministic = deterministic;
+}
+
+void scene_set_sleeping(scene_t *scene, bool sleeping) {
+  scene->sleeping = sleeping;
+  if (!sleeping) {
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+      body_set_asleep(scene_get_body(scene, i), false);
+    }
+  }
+}
+
+void scene_set_sleep_thresholds(scene_t *scene, double speed,
+  double acceleration, double time) {
+  scene->sleep_speed = speed;
+  scene->sleep_acceleration = acceleration;
+  scene->sleep_time = time;
+}
+
+scene_stats_t scene_get_stats(scene_t *scene) {
+  return scene->stats;
+}
+
+void scene_set_gravity_field(scene_t *scene, barnes_hut_t *field) {
+  if (scene->gravity_field != NULL) {
+    barnes_hut_free(scene->gravity_field);
+  }
+  scene->gravity_field = field;
+}
+
+void scene_set_broadphase(scene_t *scene, broadphase_t *broadphase) {
+  if (scene->broadphase != NULL) {
+    broadphase_free(scene->broadphase);
+  }
+  scene->broadphase = broadphase;
+}
+
+void scene_set_narrowphase(scene_t *scene, narrowphase_t narrowphase) {
+  scene->narrowphase = narrowphase;
+  force_records_set_narrowphase(scene->records, narrowphase);
+}
+
+void scene_add_collision_rule(scene_t *scene, unsigned int categories1,
+  unsigned int categories2, collision_handler_t handler, void *aux,
+  free_func_t freer) {
+  collision_rule_t *rule = malloc(sizeof(collision_rule_t));
+  assert(rule != NULL);
+  rule->categories1 = categories1;
+  rule->categories2 = categories2;
+  rule->handler = handler;
+  rule->aux = aux;
+  rule->freer = freer;
+  rule->elasticity = 0.0;
+  list_add(scene->rules, rule);
+  if (scene->broadphase == NULL) {
+    scene->broadphase = broadphase_init_grid(DEFAULT_CELL_SIZE);
+  }
+}
+
+void scene_add_contact_rule(scene_t *scene, unsigned int categories1,
+  unsigned int categories2, double elasticity) {
+  scene_add_collision_rule(scene, categories1, categories2, NULL, NULL, NULL);
+  collision_rule_t *rule = list_get(scene->rules, list_size(scene->rules) - 1);
+  rule->elasticity = elasticity;
+}
+
+/**
+ * Checks whether a rule applies to an ordered pair of bodies.
+ */
+static bool rule_matches(collision_rule_t *rule, body_t *body1,
+  body_t *body2) {
+  return (body_get_category(body1) & rule->categories1) != 0 &&
+    (body_get_category(body2) & rule->categories2) != 0;
+}
+
+/**
+ * Checks whether any rule applies to a pair of bodies in either order.
+ */
+static bool any_rule_matches(scene_t *scene, body_t *body1, body_t *body2) {
+  for (size_t r = 0; r < list_size(scene->rules); r++) {
+    collision_rule_t *rule = list_get(scene->rules, r);
+    if (rule_matches(rule, body1, body2) || rule_matches(rule, body2, body1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Checks whether both bodies of a pair are asleep, in which case they cannot
+ * have started touching.
+ */
+static bool pair_is_asleep(body_t *body1, body_t *body2) {
+  return body_is_asleep(body1) && body_is_asleep(body2);
+}
+
+/**
+ * Runs the narrowphase on a pair: the bounding circles and boxes first, and
+ * then the separating axis test, starting from the axis that decided the
+ * pair's test last tick.
+ */
+static void test_pair(scene_t *scene, body_t *body1, body_t *body2,
+  pair_result_t *result) {
+  result->tested = true;
+  result->axis = axis_cache_get(scene->axis_cache, body1, body2);
+  result->cache_hit = false;
+  result->bounds_rejected = !bodies_may_collide(body1, body2);
+  if (result->bounds_rejected) {
+    result->info = (collision_info_t) {.collided = false, .axis = VEC_ZERO};
+    return;
+  }
+  result->info = find_body_collision_cached(body1, body2, scene->narrowphase,
+    &result->axis, &result->cache_hit);
+}
+
+static void test_pairs(void *aux, size_t begin, size_t end, size_t worker) {
+  scene_t *scene = aux;
+  body_pair_t *pairs = broadphase_pairs(scene->broadphase);
+  for (size_t p = begin; p < end; p++) {
+    pair_result_t *result = &scene->pair_results[p];
+    result->tested = false;
+    if (!pair_is_asleep(pairs[p].body1, pairs[p].body2) &&
+      any_rule_matches(scene, pairs[p].body1, pairs[p].body2)) {
+      test_pair(scene, pairs[p].body1, pairs[p].body2, result);
+    }
+  }
+}
+
+/**
+ * Runs the narrowphase on every broadphase pair covered by some rule, unless
+ * both bodies are asleep, and calls the handlers of the matching rules on
+ * the colliding ones, or adds their contacts to the solver.
+ * The narrowphase runs on the scene's threads first; the handlers then run
+ * one pair at a time, in pair order.
+ */
+static void scene_apply_collision_rules(scene_t *scene) {
+  if (list_size(scene->rules) == 0) {
+    return;
+  }
+  // Also brings every live body's cached vertices up to date, so the
+  // narrowphase threads only ever read them
+  broadphase_update(scene->broadphase, scene->bodies);
+  size_t pair_count = broadphase_pair_count(scene->broadphase);
+  body_pair_t *pairs = broadphase_pairs(scene->broadphase);
+  scene->pair_results = reserve(scene->pair_results,
+    &scene->pair_results_capacity, pair_count, sizeof(pair_result_t));
+  // The threads only read last tick's axes; this tick's are stored below
+  axis_cache_next_tick(scene->axis_cache);
+  job_pool_parallel_for(scene->pool, pair_count, SCENE_GRAIN, test_pairs,
+    scene);
+
+  for (size_t p = 0; p < pair_count; p++) {
+    body_t *body1 = pairs[p].body1;
+    body_t *body2 = pairs[p].body2;
+    pair_result_t *result = &scene->pair_results[p];
+    if (!result->tested) {
+      // An earlier handler may have changed the bodies' categories
+      // or woken them up
+      if (!any_rule_matches(scene, body1, body2)) {
+        continue;
+      }
+      if (pair_is_asleep(body1, body2)) {
+        scene->stats.pairs_skipped++;
+        continue;
+      }
+      test_pair(scene, body1, body2, result);
+    }
+    scene->stats.pairs_tested++;
+    if (result->bounds_rejected) {
+      scene->stats.bounds_rejected++;
+    }
+    else if (result->cache_hit) {
+      scene->stats.axis_cache_hits++;
+    }
+    else {
+      scene->stats.axis_cache_misses++;
+    }
+    axis_cache_put(scene->axis_cache, body1, body2, result->axis);
+    collision_info_t info = result->info;
+    if (!info.collided) {
+      continue;
+    }
+    for (size_t r = 0; r < list_size(scene->rules); r++) {
+      collision_rule_t *rule = list_get(scene->rules, r);
+      // Handlers may remove bodies, which ends their collisions
+      if (body_is_removed(body1) || body_is_removed(body2)) {
+        break;
+      }
+      if (rule->handler == NULL) {
+        // A contact is solved once, whichever way round the rule matches
+        if (rule_matches(rule, body1, body2) ||
+          rule_matches(rule, body2, body1)) {
+          contact_solver_add(scene->solver, body1, body2, info,
+            rule->elasticity);
+        }
+        continue;
+      }
+      if (rule_matches(rule, body1, body2)) {
+        rule->handler(body1, body2, info.axis, rule->aux);
+      }
+      if (rule_matches(rule, body2, body1)) {
+        rule->handler(body2, body1, vec_negate(info.axis), rule->aux);
+      }
+    }
+  }
+}
+
+/**
+ * Drops a removed body from the scene: marks every force registered on it
+ * for removal and takes it out of the body store. The body is not freed.
+ */
+static bool retire_body(void *value, void *aux) {
+  body_t *body = value;
+  scene_t *scene = aux;
+  if (!body_is_removed(body)) {
+    return false;
+  }
+  for (size_t i = 0; i < list_size(body->forces); i++) {
+    force_remove(list_get(body->forces, i));
+  }
+  // Sleeping bodies have already left the store
+  if (body->store != NULL) {
+    body_store_remove(body->store, body);
+  }
+  if (body->query_proxy != -1) {
+    aabb_tree_remove(scene->query_tree, body->query_proxy);
+    body->query_proxy = -1;
+  }
+  scene->contribution_index.dirty = true;
+  return true;
+}
+
+/**
+ * Drops a removed force from the scene and queues it to be freed once the
+ * bodies it was registered on have forgotten it.
+ */
+static bool retire_force(void *value, void *aux) {
+  force_t *f = value;
+  scene_t *scene = aux;
+  if (!force_is_removed(f)) {
+    return false;
+  }
+  for (size_t i = 0; i < list_size(f->bodies); i++) {
+    body_t *body = list_get(f->bodies, i);
+    if (!body->forces_stale) {
+      body->forces_stale = true;
+      list_add(scene->stale_bodies, body);
+    }
+  }
+  list_add(scene->retired_forces, f);
+  return true;
+}
+
+static bool is_removed_force(void *force, void *aux) {
+  return force_is_removed(force);
+}
+
+static bool prune_body_forces(void *value, void *aux) {
+  body_t *body = value;
+  list_remove_if(body->forces, is_removed_force, NULL);
+  body->forces_stale = false;
+  return true;
+}
+
+static bool free_retired_force(void *value, void *aux) {
+  force_free(value);
+  return true;
+}
+
+static void accumulate_forces(void *aux, size_t begin, size_t end,
+  size_t worker) {
+  scene_t *scene = aux;
+  force_records_accumulate(scene->records, begin, end,
+    scene->thread_forces + worker * scene_bodies(scene));
+}
+
+static void merge_forces(void *aux, size_t begin, size_t end, size_t worker) {
+  scene_t *scene = aux;
+  size_t n = scene_bodies(scene);
+  size_t threads = job_pool_threads(scene->pool);
+  for (size_t i = begin; i < end; i++) {
+    vector_t total = VEC_ZERO;
+    for (size_t t = 0; t < threads; t++) {
+      total = vec_add(total, scene->thread_forces[t * n + i]);
+    }
+    body_add_force(scene_get_body(scene, i), total);
+  }
+}
+
+/**
+ * Rebuilds the body-to-slots index with a counting sort of the slots by
+ * owner, which keeps each body's slots in increasing order.
+ * Expects every body's scene_index to be up to date.
+ */
+static void build_contribution_index(scene_t *scene) {
+  contribution_index_t *index = &scene->contribution_index;
+  size_t n = scene_bodies(scene);
+  size_t slot_count = 2 * force_records_body_force_count(scene->records);
+  if (slot_count > index->slot_capacity) {
+    index->slot_capacity = slot_count;
+    index->contributions = realloc(index->contributions,
+      slot_count * sizeof(vector_t));
+    index->owners = realloc(index->owners, slot_count * sizeof(body_t *));
+    index->slots = realloc(index->slots, slot_count * sizeof(size_t));
+    assert(index->contributions != NULL && index->owners != NULL &&
+      index->slots != NULL);
+  }
+  if (n + 1 > index->body_capacity) {
+    index->body_capacity = n + 1;
+    index->starts = realloc(index->starts, (n + 1) * sizeof(size_t));
+    index->cursors = realloc(index->cursors, (n + 1) * sizeof(size_t));
+    assert(index->starts != NULL && index->cursors != NULL);
   }
 
-  for (size_t k = 0; k < list_size(scene->forces); k++){
-    force_t *f = scene_get_force(scene, k);
-    for (size_t l = 0; l < list_size(f->bodies); l++){
-      if (body_is_removed(list_get(f->bodies, l))){
-         force_remove(f);
+  force_records_contribution_bodies(scene->records, index->owners);
+  memset(index->starts, 0, (n + 1) * sizeof(size_t));
+  for (size_t s = 0; s < slot_count; s++) {
+    if (index->owners[s] != NULL) {
+      index->starts[index->owners[s]->scene_index + 1]++;
+    }
+  }
+  for (size_t i = 0; i < n; i++) {
+    index->starts[i + 1] += index->starts[i];
+    index->cursors[i] = index->starts[i];
+  }
+  for (size_t s = 0; s < slot_count; s++) {
+    if (index->owners[s] != NULL) {
+      index->slots[index->cursors[index->owners[s]->scene_index]++] = s;
+    }
+  }
+  index->dirty = false;
+}
+
+static void contribute_forces(void *aux, size_t begin, size_t end,
+  size_t worker) {
+  scene_t *scene = aux;
+  force_records_contribute(scene->records, begin, end,
+    scene->contribution_index.contributions);
+}
+
+/**
+ * Adds each body's contributions to it one at a time in slot order,
+ * which is the order force_records_apply() would add them in.
+ */
+static void reduce_forces(void *aux, size_t begin, size_t end, size_t worker) {
+  scene_t *scene = aux;
+  contribution_index_t *index = &scene->contribution_index;
+  for (size_t i = begin; i < end; i++) {
+    body_t *body = scene_get_body(scene, i);
+    vector_t force = body_get_force(body);
+    for (size_t j = index->starts[i]; j < index->starts[i + 1]; j++) {
+      force = vec_add(force, index->contributions[index->slots[j]]);
+    }
+    body_set_force(body, force);
+  }
+}
+
+/**
+ * Applies the typed forces. With threads, each thread adds the forces of its
+ * records into its own accumulator, and the accumulators are then summed
+ * into the bodies, so no two threads ever write to the same body.
+ * In deterministic mode, records write their forces into fixed slots
+ * instead, and each body sums its slots in a fixed order.
+ */
+static void scene_apply_forces(scene_t *scene) {
+  if (scene->pool == NULL) {
+    force_records_apply(scene->records, scene->solver);
+    return;
+  }
+  size_t n = scene_bodies(scene);
+  if (scene->deterministic) {
+    if (scene->contribution_index.dirty) {
+      for (size_t i = 0; i < n; i++) {
+        scene_get_body(scene, i)->scene_index = i;
       }
+      build_contribution_index(scene);
     }
+    job_pool_parallel_for(scene->pool,
+      force_records_body_force_count(scene->records), SCENE_GRAIN,
+      contribute_forces, scene);
+    job_pool_parallel_for(scene->pool, n, SCENE_GRAIN, reduce_forces, scene);
+    force_records_apply_collisions(scene->records, scene->solver);
+    return;
+  }
+  size_t needed = n * job_pool_threads(scene->pool);
+  scene->thread_forces = reserve(scene->thread_forces,
+    &scene->thread_forces_capacity, needed, sizeof(vector_t));
+  memset(scene->thread_forces, 0, needed * sizeof(vector_t));
+  for (size_t i = 0; i < n; i++) {
+    scene_get_body(scene, i)->scene_index = i;
+  }
+  job_pool_parallel_for(scene->pool,
+    force_records_body_force_count(scene->records), SCENE_GRAIN,
+    accumulate_forces, scene);
+  job_pool_parallel_for(scene->pool, n, SCENE_GRAIN, merge_forces, scene);
+  force_records_apply_collisions(scene->records, scene->solver);
+}
+
+static size_t find_island(island_node_t *islands, size_t i) {
+  while (islands[i].parent != i) {
+    islands[i].parent = islands[islands[i].parent].parent;
+    i = islands[i].parent;
   }
+  return i;
+}
 
-  for (size_t j = 0; j < list_size(scene->forces); j++) {
-    force_t *f = scene_get_force(scene, j);
-    if (force_is_removed(f)){
-      scene_remove_force(scene, j);
-      j--;
+/**
+ * Merges the islands of two bodies, unless either has infinite mass or
+ * is not in the scene.
+ */
+static void link_bodies(scene_t *scene, body_t *body1, body_t *body2) {
+  size_t n = scene_bodies(scene);
+  if (body1->scene_index >= n || scene_get_body(scene, body1->scene_index) !=
+    body1 || body2->scene_index >= n ||
+    scene_get_body(scene, body2->scene_index) != body2) {
+    return;
+  }
+  if (body_get_mass(body1) == INFINITY || body_get_mass(body2) == INFINITY) {
+    return;
+  }
+  size_t root1 = find_island(scene->islands, body1->scene_index);
+  size_t root2 = find_island(scene->islands, body2->scene_index);
+  scene->islands[root1].parent = root2;
+}
+
+/**
+ * Checks whether a body is resting over a tick, given the forces and
+ * impulses applied to it so far.
+ */
+static bool is_resting(scene_t *scene, body_t *body, double dt) {
+  vector_t velocity = body_get_velocity(body);
+  vector_t change = vec_multiply(1.0 / body_get_mass(body),
+    vec_add(vec_multiply(dt, body_get_force(body)), body_get_impulse(body)));
+  vector_t next = vec_add(velocity, change);
+  double speed = scene->sleep_speed;
+  double acceleration = scene->sleep_acceleration * dt;
+  return vec_dot(velocity, velocity) <= speed * speed &&
+    vec_dot(next, next) <= speed * speed &&
+    vec_dot(change, change) <= acceleration * acceleration;
+}
+
+/**
+ * Groups the bodies into islands, then puts islands that have rested for
+ * long enough to sleep and wakes islands in which something moved.
+ * Islands are linked by this tick's contacts from the collision rules and
+ * collision forces, by forces acting on both of their bodies, and by
+ * broadphase pairs with a removed body, so bodies resting on a removed body
+ * wake up.
+ * Runs after the forces and collisions and before removed bodies leave.
+ */
+static void update_sleep(scene_t *scene, double dt) {
+  size_t n = scene_bodies(scene);
+  scene->islands = reserve(scene->islands, &scene->islands_capacity, n,
+    sizeof(island_node_t));
+  for (size_t i = 0; i < n; i++) {
+    scene_get_body(scene, i)->scene_index = i;
+    scene->islands[i] = (island_node_t) {i, false, false};
+  }
+
+  if (list_size(scene->rules) > 0) {
+    size_t pair_count = broadphase_pair_count(scene->broadphase);
+    body_pair_t *pairs = broadphase_pairs(scene->broadphase);
+    for (size_t p = 0; p < pair_count; p++) {
+      pair_result_t *result = &scene->pair_results[p];
+      if ((result->tested && result->info.collided) ||
+        body_is_removed(pairs[p].body1) || body_is_removed(pairs[p].body2)) {
+        link_bodies(scene, pairs[p].body1, pairs[p].body2);
+      }
+    }
+  }
+  for (size_t i = 0; i < list_size(scene->forces); i++) {
+    force_t *f = list_get(scene->forces, i);
+    if (force_is_removed(f)) {
+      continue;
+    }
+    if (f->kind == FORCE_COLLISION) {
+      if (!force_records_collision_touching(scene->records, f->index)) {
+        continue;
+      }
+    }
+    else if (f->kind != FORCE_CALLBACK && !force_kind_acts_on_body2(f->kind)) {
+      continue;
+    }
+    for (size_t j = 1; j < list_size(f->bodies); j++) {
+      link_bodies(scene, list_get(f->bodies, j - 1), list_get(f->bodies, j));
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = scene_get_body(scene, i);
+    island_node_t *root = &scene->islands[find_island(scene->islands, i)];
+    if (body_is_removed(body)) {
+      root->moving = true;
+      continue;
+    }
+    if (body_is_asleep(body)) {
+      continue;
+    }
+    if (is_resting(scene, body, dt)) {
+      body->sleep_time += dt;
+    }
+    else {
+      body->sleep_time = 0.0;
+      root->moving = true;
+    }
+    if (body->sleep_time < scene->sleep_time) {
+      root->restless = true;
     }
   }
 
-  for (size_t m = 0; m <scene_bodies(scene); m ++){
-    body_t *bod = scene_get_body((scene_t*) scene, m);
-    if (body_is_removed(bod)){
-      list_remove(scene->bodies, m);
-      m--;
+  for (size_t i = 0; i < n; i++) {
+    body_t *body = scene_get_body(scene, i);
+    size_t root = find_island(scene->islands, i);
+    if (body_is_removed(body)) {
+      continue;
+    }
+    if (root == i) {
+      scene->stats.islands++;
+    }
+    if (scene->islands[root].moving) {
+      body_set_asleep(body, false);
+    }
+    else if (!scene->islands[root].restless) {
+      body_set_asleep(body, true);
+    }
+    if (body_is_asleep(body)) {
+      // Forces on a resting body are balanced by whatever it rests on
+      body->force = VEC_ZERO;
+      body->impulse = VEC_ZERO;
+      scene->stats.asleep++;
     }
   }
+}
+
+/**
+ * What the integration jobs need besides their range.
+ */
+typedef struct {
+  scene_t *scene;
+  double dt;
+} integrate_job_t;
 
-  for (size_t i = 0; i < scene_bodies(scene); i++){
-    body_tick(scene_get_body((scene_t*) scene, i), dt);
+static void integrate_store(void *aux, size_t begin, size_t end,
+  size_t worker) {
+  integrate_job_t *job = aux;
+  body_store_integrate_range(job->scene->store, begin, end, job->dt);
+}
+
+static void integrate_bodies(void *aux, size_t begin, size_t end,
+  size_t worker) {
+  integrate_job_t *job = aux;
+  for (size_t i = begin; i < end; i++) {
+    body_t *body = scene_get_body(job->scene, i);
+    if (!body_is_asleep(body)) {
+      body_tick(body, job->dt);
+    }
+  }
+}
+
+void scene_refresh_queries(scene_t *scene) {
+  if (scene->query_tree == NULL) {
+    scene->query_tree = aabb_tree_init();
   }
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    aabb_t box = body_get_aabb(body);
+    if (body->query_proxy == -1) {
+      body->query_proxy = aabb_tree_insert(scene->query_tree,
+        aabb_expand(box, QUERY_MARGIN), body);
+    }
+    else {
+      aabb_tree_move(scene->query_tree, body->query_proxy, box,
+        QUERY_MARGIN);
+    }
+  }
+}
+
+/**
+ * A region search: the box every match overlaps, and the exact test for
+ * radius and point queries.
+ */
+typedef enum {
+  QUERY_AABB,
+  QUERY_RADIUS,
+  QUERY_POINT
+} query_kind_t;
+
+typedef struct {
+  aabb_tree_t *tree;
+  query_kind_t kind;
+  aabb_t box;
+  vector_t center;
+  double radius;
+  scene_query_visitor_t visit;
+  void *aux;
+} region_query_t;
+
+static bool visit_region(void *aux, int proxy) {
+  region_query_t *query = aux;
+  body_t *body = aabb_tree_get_data(query->tree, proxy);
+  if (body_is_removed(body) ||
+    !aabb_overlaps(body_get_aabb(body), query->box)) {
+    return true;
+  }
+  if (query->kind == QUERY_RADIUS &&
+    shape_distance(body_get_vertices(body), query->center) > query->radius) {
+    return true;
+  }
+  if (query->kind == QUERY_POINT &&
+    !shape_contains(body_get_vertices(body), query->center)) {
+    return true;
+  }
+  return query->visit(body, query->aux);
+}
+
+static void query_region(scene_t *scene, region_query_t *query) {
+  if (scene->query_tree == NULL) {
+    scene_refresh_queries(scene);
+  }
+  query->tree = scene->query_tree;
+  aabb_tree_query(scene->query_tree, query->box, visit_region, query);
+}
+
+/**
+ * Where the *_bodies() queries store what they find.
+ */
+typedef struct {
+  body_t **bodies;
+  size_t capacity;
+  size_t count;
+} body_buffer_t;
+
+static bool collect_body(body_t *body, void *aux) {
+  body_buffer_t *buffer = aux;
+  if (buffer->count < buffer->capacity) {
+    buffer->bodies[buffer->count] = body;
+  }
+  buffer->count++;
+  return true;
+}
+
+void scene_query_aabb(scene_t *scene, aabb_t box, scene_query_visitor_t visit,
+  void *aux) {
+  region_query_t query = {.kind = QUERY_AABB, .box = box, .visit = visit,
+    .aux = aux};
+  query_region(scene, &query);
+}
+
+size_t scene_query_aabb_bodies(scene_t *scene, aabb_t box, body_t **bodies,
+  size_t capacity) {
+  body_buffer_t buffer = {bodies, capacity, 0};
+  scene_query_aabb(scene, box, collect_body, &buffer);
+  return buffer.count;
+}
+
+void scene_query_radius(scene_t *scene, vector_t center, double radius,
+  scene_query_visitor_t visit, void *aux) {
+  vector_t reach = {radius, radius};
+  region_query_t query = {.kind = QUERY_RADIUS,
+    .box = {vec_subtract(center, reach), vec_add(center, reach)},
+    .center = center, .radius = radius, .visit = visit, .aux = aux};
+  query_region(scene, &query);
+}
+
+size_t scene_query_radius_bodies(scene_t *scene, vector_t center,
+  double radius, body_t **bodies, size_t capacity) {
+  body_buffer_t buffer = {bodies, capacity, 0};
+  scene_query_radius(scene, center, radius, collect_body, &buffer);
+  return buffer.count;
+}
+
+void scene_query_point(scene_t *scene, vector_t point,
+  scene_query_visitor_t visit, void *aux) {
+  region_query_t query = {.kind = QUERY_POINT, .box = {point, point},
+    .center = point, .visit = visit, .aux = aux};
+  query_region(scene, &query);
+}
+
+size_t scene_query_point_bodies(scene_t *scene, vector_t point,
+  body_t **bodies, size_t capacity) {
+  body_buffer_t buffer = {bodies, capacity, 0};
+  scene_query_point(scene, point, collect_body, &buffer);
+  return buffer.count;
+}
+
+/**
+ * A ray cast: the segment, and the nearest body it has hit so far.
+ */
+typedef struct {
+  aabb_tree_t *tree;
+  vector_t origin;
+  vector_t translation;
+  body_t *hit;
+  double fraction;
+} ray_query_t;
+
+static bool visit_ray(void *aux, int proxy) {
+  ray_query_t *query = aux;
+  body_t *body = aabb_tree_get_data(query->tree, proxy);
+  double fraction;
+  if (!body_is_removed(body) && shape_ray_cast(body_get_vertices(body),
+    query->origin, query->translation, &fraction) &&
+    (query->hit == NULL || fraction < query->fraction)) {
+    query->hit = body;
+    query->fraction = fraction;
+  }
+  return true;
+}
+
+body_t *scene_ray_cast(scene_t *scene, vector_t origin, vector_t translation,
+  double *fraction) {
+  if (scene->query_tree == NULL) {
+    scene_refresh_queries(scene);
+  }
+  vector_t end = vec_add(origin, translation);
+  aabb_t box = {{fmin(origin.x, end.x), fmin(origin.y, end.y)},
+    {fmax(origin.x, end.x), fmax(origin.y, end.y)}};
+  ray_query_t query = {scene->query_tree, origin, translation, NULL, 1.0};
+  aabb_tree_query(scene->query_tree, box, visit_ray, &query);
+  if (query.hit != NULL) {
+    *fraction = query.fraction;
+  }
+  return query.hit;
+}
+
+/**
+ * Remembers where each awake bullet starts the tick, before integration.
+ */
+static void collect_bullets(scene_t *scene) {
+  scene->bullet_count = 0;
+  for (size_t i = 0; i < scene_bodies(scene); i++) {
+    body_t *body = scene_get_body(scene, i);
+    if (!body_is_bullet(body) || body_is_asleep(body)) {
+      continue;
+    }
+    scene->bullets = reserve(scene->bullets, &scene->bullets_capacity,
+      scene->bullet_count + 1, sizeof(bullet_move_t));
+    scene->bullets[scene->bullet_count++] =
+      (bullet_move_t) {body, body_get_centroid(body)};
+  }
+}
+
+/**
+ * A bullet's move being swept, and the earliest impact found so far.
+ */
+typedef struct {
+  scene_t *scene;
+  body_t *bullet;
+  vector_t displacement;
+  double toi;
+} bullet_sweep_t;
+
+static bool visit_bullet_target(void *aux, int proxy) {
+  bullet_sweep_t *sweep = aux;
+  body_t *other = aabb_tree_get_data(sweep->scene->query_tree, proxy);
+  if (other == sweep->bullet || body_is_removed(other) ||
+    !any_rule_matches(sweep->scene, sweep->bullet, other)) {
+    return true;
+  }
+  double t = find_time_of_impact(sweep->bullet, sweep->displacement, other);
+  sweep->toi = t < sweep->toi ? t : sweep->toi;
+  sweep->scene->stats.bullet_candidates++;
+  return true;
+}
+
+/**
+ * Sweeps each bullet's move this tick against the bodies a rule covers it
+ * with, at their new positions, and moves the bullet back to where it first
+ * overlaps one (see find_time_of_impact()). Only the bodies in the query
+ * tree whose boxes overlap the box the bullet sweeps through are tested.
+ * The rest of the move is dropped but the velocity is kept, so the
+ * collision rules handle the hit next tick.
+ */
+static void sweep_bullets(scene_t *scene) {
+  if (scene->bullet_count == 0) {
+    return;
+  }
+  scene_refresh_queries(scene);
+  for (size_t b = 0; b < scene->bullet_count; b++) {
+    body_t *bullet = scene->bullets[b].body;
+    vector_t start = scene->bullets[b].start;
+    vector_t displacement = vec_subtract(body_get_centroid(bullet), start);
+    if (displacement.x == 0.0 && displacement.y == 0.0) {
+      continue;
+    }
+    scene->stats.bullets_swept++;
+    aabb_t end_box = body_get_aabb(bullet);
+    body_set_centroid(bullet, start);
+    aabb_t swept = aabb_union(body_get_aabb(bullet), end_box);
+    bullet_sweep_t sweep = {scene, bullet, displacement, 1.0};
+    aabb_tree_query(scene->query_tree, swept, visit_bullet_target, &sweep);
+    if (sweep.toi < 1.0) {
+      scene->stats.bullets_stopped++;
+    }
+    body_set_centroid(bullet, vec_add(start, vec_multiply(sweep.toi,
+      displacement)));
+    // Later bullets are swept against where this one stopped
+    aabb_tree_move(scene->query_tree, bullet->query_proxy,
+      body_get_aabb(bullet), QUERY_MARGIN);
+  }
+}
+
+void scene_tick(scene_t *scene, double dt) {
+  scene->stats = (scene_stats_t) {0};
+
+  for (size_t n = 0; n < list_size(scene->callbacks); n++) {
+    force_t *f = list_get(scene->callbacks, n);
+    f->forcer(f->aux);
+  }
+  if (scene->gravity_field != NULL) {
+    barnes_hut_apply(scene->gravity_field, scene->bodies, scene->pool);
+  }
+  scene_apply_forces(scene);
+
+  // Handlers may query the scene
+  if (scene->query_tree != NULL) {
+    scene_refresh_queries(scene);
+  }
+  scene_apply_collision_rules(scene);
+  if (contact_solver_count(scene->solver) > 0) {
+    contact_solver_solve(scene->solver, dt);
+  }
+  if (scene->sleeping) {
+    update_sleep(scene, dt);
+  }
+
+  // Each list is compacted in one pass; a removed body reaches its forces
+  // through its own list rather than by scanning every force
+  list_remove_if(scene->bodies, retire_body, scene);
+  if (scene->forces_removed) {
+    list_remove_if(scene->forces, retire_force, scene);
+    list_remove_if(scene->callbacks, is_removed_force, NULL);
+    list_remove_if(scene->stale_bodies, prune_body_forces, NULL);
+    list_remove_if(scene->retired_forces, free_retired_force, NULL);
+    scene->forces_removed = false;
+  }
+
+  collect_bullets(scene);
+  // Sleeping bodies are not in the store, and integrate_bodies() skips them
+  integrate_job_t job = {scene, dt};
+  if (scene->store != NULL) {
+    job_pool_parallel_for(scene->pool, body_store_size(scene->store),
+      SCENE_GRAIN, integrate_store, &job);
+  }
+  else {
+    job_pool_parallel_for(scene->pool, scene_bodies(scene), SCENE_GRAIN,
+      integrate_bodies, &job);
+  }
+  sweep_bullets(scene);
+  if (scene->query_tree != NULL) {
+    scene_refresh_queries(scene);
+  }
+
+  scene_stats_t *stats = &scene->stats;
+  stats->bodies = scene_bodies(scene);
+  stats->integrated = stats->bodies - stats->asleep;
+  stats->integrations_skipped = stats->asleep;
+  stats->percent_asleep = stats->bodies == 0 ? 0.0 :
+    100.0 * stats->asleep / stats->bodies;
 }
@@ -220,9 +220,11 @@ void sdl_clear(void) {
     SDL_RenderClear(renderer);
 }
 
-void sdl_draw_polygon(list_t *points, rgb_color_t color) {
+/**
+ * Draws a filled polygon from a contiguous array of vertices.
+ */
+static void draw_points(const vector_t *points, size_t n, rgb_color_t color) {
     // Check parameters
-    size_t n = list_size(points);
     assert(n >= 3);
     assert(0 <= color.r && color.r <= 1);
     assert(0 <= color.g && color.g <= 1);
@@ -231,13 +233,9 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
     vector_t window_center = get_window_center();
 
     // Convert each vertex to a point on screen
-    int16_t *x_points = malloc(sizeof(*x_points) * n),
-            *y_points = malloc(sizeof(*y_points) * n);
-    assert(x_points != NULL);
-    assert(y_points != NULL);
+    int16_t x_points[n], y_points[n];
     for (size_t i = 0; i < n; i++) {
-        vector_t *vertex = list_get(points, i);
-        vector_t pixel = get_window_position(*vertex, window_center);
+        vector_t pixel = get_window_position(points[i], window_center);
         x_points[i] = pixel.x;
         y_points[i] = pixel.y;
     }
@@ -248,8 +246,19 @@ void sdl_draw_polygon(list_t *points, rgb_color_t color) {
         x_points, y_points, n,
         color.r * 255, color.g * 255, color.b * 255, 255
     );
-    free(x_points);
-    free(y_points);
+}
+
+void sdl_draw_polygon(list_t *points, rgb_color_t color) {
+    size_t n = list_size(points);
+    vector_t vertices[n];
+    for (size_t i = 0; i < n; i++) {
+        vertices[i] = *(vector_t *) list_get(points, i);
+    }
+    draw_points(vertices, n, color);
+}
+
+void sdl_draw_shape(const shape_t *shape, rgb_color_t color) {
+    draw_points(shape_const_points(shape), shape_size(shape), color);
 }
 
 void sdl_show(void) {
@@ -277,14 +286,31 @@ void sdl_render_scene(scene_t *scene) {
     size_t body_count = scene_bodies(scene);
     for (size_t i = 0; i < body_count; i++) {
         body_t *body = scene_get_body(scene, i);
-        list_t *shape = body_get_shape(body);
-        sdl_draw_polygon(shape, body_get_color(body));
-        list_free(shape);
+        sdl_draw_shape(body_get_vertices(body), body_get_color(body));
     }
     Mix_Quit();
     //close_audio();
 }
 
+void sdl_render_scene_interpolated(scene_t *scene, double alpha) {
+    // Reused across frames so drawing does not allocate
+    static shape_t vertices;
+    static bool vertices_initialized = false;
+    if (!vertices_initialized) {
+        shape_init(&vertices, 0);
+        vertices_initialized = true;
+    }
+    sdl_clear();
+    SDL_RenderCopy(renderer, texture, NULL, dstrect);
+    size_t body_count = scene_bodies(scene);
+    for (size_t i = 0; i < body_count; i++) {
+        body_t *body = scene_get_body(scene, i);
+        body_get_interpolated_vertices(body, alpha, &vertices);
+        sdl_draw_shape(&vertices, body_get_color(body));
+    }
+    Mix_Quit();
+}
+
 void sdl_on_key(key_handler_t handler, void *b, void *s) {
     key_handler = handler;
     body = b;
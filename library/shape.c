@@ -0,0 +1,100 @@
+#include "shape.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "list.h"
+#include "vector.h"
+
+void shape_init(shape_t *shape, size_t capacity) {
+  shape->size = 0;
+  shape->heap_points = NULL;
+  shape->capacity = SHAPE_INLINE_CAPACITY;
+  if (capacity > SHAPE_INLINE_CAPACITY) {
+    shape->heap_points = malloc(capacity * sizeof(vector_t));
+    assert(shape->heap_points != NULL);
+    shape->capacity = capacity;
+  }
+}
+
+void shape_init_from_list(shape_t *shape, list_t *list) {
+  size_t len = list_size(list);
+  shape_init(shape, len);
+  vector_t *points = shape_points(shape);
+  for (size_t i = 0; i < len; i++) {
+    points[i] = *(vector_t *) list_get(list, i);
+  }
+  shape->size = len;
+}
+
+void shape_release(shape_t *shape) {
+  free(shape->heap_points);
+  shape->heap_points = NULL;
+  shape->capacity = SHAPE_INLINE_CAPACITY;
+  shape->size = 0;
+}
+
+/**
+ * Ensures the shape can hold at least capacity vertices.
+ */
+static void shape_reserve(shape_t *shape, size_t capacity) {
+  if (capacity <= shape->capacity) {
+    return;
+  }
+  vector_t *points = malloc(capacity * sizeof(vector_t));
+  assert(points != NULL);
+  memcpy(points, shape_const_points(shape), shape->size * sizeof(vector_t));
+  free(shape->heap_points);
+  shape->heap_points = points;
+  shape->capacity = capacity;
+}
+
+void shape_copy(shape_t *dest, const shape_t *src) {
+  dest->size = 0;
+  shape_reserve(dest, src->size);
+  memcpy(shape_points(dest), shape_const_points(src),
+    src->size * sizeof(vector_t));
+  dest->size = src->size;
+}
+
+list_t *shape_to_list(const shape_t *shape) {
+  list_t *list = list_init(shape->size, free, NULL);
+  const vector_t *points = shape_const_points(shape);
+  for (size_t i = 0; i < shape->size; i++) {
+    vector_t *vec_copy = malloc(sizeof(vector_t));
+    assert(vec_copy != NULL);
+    *vec_copy = points[i];
+    list_add(list, vec_copy);
+  }
+  return list;
+}
+
+void shape_add(shape_t *shape, vector_t point) {
+  if (shape->size == shape->capacity) {
+    shape_reserve(shape, 2 * shape->capacity);
+  }
+  shape_points(shape)[shape->size] = point;
+  shape->size++;
+}
+
+size_t shape_size(const shape_t *shape) {
+  return shape->size;
+}
+
+vector_t *shape_points(shape_t *shape) {
+  if (shape->heap_points != NULL) {
+    return shape->heap_points;
+  }
+  return shape->inline_points;
+}
+
+const vector_t *shape_const_points(const shape_t *shape) {
+  if (shape->heap_points != NULL) {
+    return shape->heap_points;
+  }
+  return shape->inline_points;
+}
+
+vector_t shape_get(const shape_t *shape, size_t index) {
+  assert(index < shape->size);
+  return shape_const_points(shape)[index];
+}
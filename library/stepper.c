@@ -0,0 +1,58 @@
+#include "stepper.h"
+#include <assert.h>
+#include <stdlib.h>
+#include "body.h"
+#include "scene.h"
+
+typedef struct stepper {
+  double step;
+  size_t max_substeps;
+  // simulated time owed to the scene, less than step between calls
+  double accumulator;
+} stepper_t;
+
+stepper_t *stepper_init(double step, size_t max_substeps) {
+  assert(step > 0 && max_substeps > 0);
+  stepper_t *stepper = malloc(sizeof(stepper_t));
+  assert(stepper != NULL);
+  stepper->step = step;
+  stepper->max_substeps = max_substeps;
+  stepper->accumulator = 0.0;
+  return stepper;
+}
+
+void stepper_free(stepper_t *stepper) {
+  free(stepper);
+}
+
+void stepper_set_step(stepper_t *stepper, double step) {
+  assert(step > 0);
+  stepper->step = step;
+}
+
+double stepper_get_step(stepper_t *stepper) {
+  return stepper->step;
+}
+
+size_t stepper_advance(stepper_t *stepper, scene_t *scene, double elapsed) {
+  stepper->accumulator += elapsed;
+  size_t steps = 0;
+  while (stepper->accumulator >= stepper->step &&
+    steps < stepper->max_substeps) {
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+      body_save_previous_state(scene_get_body(scene, i));
+    }
+    scene_tick(scene, stepper->step);
+    stepper->accumulator -= stepper->step;
+    steps++;
+  }
+  // Drops whatever the cap did not allow us to simulate
+  if (stepper->accumulator >= stepper->step) {
+    stepper->accumulator = 0.0;
+  }
+  return steps;
+}
+
+double stepper_alpha(stepper_t *stepper) {
+  return stepper->accumulator / stepper->step;
+}
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #define DEFAULT_EPSILON 1e-7
@@ -30,6 +31,16 @@ bool vec_within(double epsilon, vector_t v1, vector_t v2) {
     return within(epsilon, v1.x, v2.x) && within(epsilon, v1.y, v2.y);
 }
 
+double random_double(double min, double max) {
+    return min + (max - min) * rand() / RAND_MAX;
+}
+
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 void read_testname(char *filename, char *testname, size_t testname_size) {
     FILE *f = fopen(filename, "r");
     if (f == NULL) {
@@ -0,0 +1,119 @@
+#include "body.h"
+#include "broadphase.h"
+#include "collision.h"
+#include "list.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// finalgame's pit: rows of 4- to 8-gons of radius SIZE_ALL + 2.5, one every
+// 2 * SIZE_ALL along the 800-wide window and up the screen
+const double BENCH_SIZE = 25.0;
+const double BENCH_WIDTH = 800.0;
+const size_t BENCH_ROWS = 10;
+const double BENCH_CELL_SIZE = 64.0;
+const size_t BENCH_TICKS = 2000;
+// Resting shapes still jiggle a little from tick to tick
+const double BENCH_JITTER = 0.05;
+
+body_t *make_polygon(int n, vector_t center) {
+    list_t *points = list_init(n, free, NULL);
+    for (int i = 0; i < n; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        point->x = center.x + (BENCH_SIZE + 2.5) * cos(i * 2 * M_PI / n);
+        point->y = center.y + (BENCH_SIZE + 2.5) * sin(i * 2 * M_PI / n);
+        list_add(points, point);
+    }
+    return body_init(points, 1, (rgb_color_t) {0, 0, 0});
+}
+
+/**
+ * Compares the full and cached tests on the candidate pairs of a pit whose
+ * shapes are spacing apart, or only on the pairs that start out separated.
+ */
+void run(const char *name, double spacing, bool separated_only) {
+    srand(1);
+    list_t *bodies = list_init(1, (free_func_t) body_free, NULL);
+    for (size_t row = 0; row < BENCH_ROWS; row++) {
+        for (double x = BENCH_SIZE; x < BENCH_WIDTH; x += spacing) {
+            list_add(bodies, make_polygon(4 + rand() % 5,
+              (vector_t) {x, 10 + BENCH_SIZE + spacing * row}));
+        }
+    }
+    // The candidate pairs of the pit, as the scene's broadphase finds them
+    broadphase_t *bp = broadphase_init_grid(BENCH_CELL_SIZE);
+    broadphase_update(bp, bodies);
+    size_t pair_count = broadphase_pair_count(bp);
+    body_pair_t *pairs = malloc(pair_count * sizeof(body_pair_t));
+    vector_t *axes = malloc(pair_count * sizeof(vector_t));
+    assert(pairs != NULL && axes != NULL);
+    size_t kept = 0;
+    for (size_t p = 0; p < pair_count; p++) {
+        body_pair_t pair = broadphase_pairs(bp)[p];
+        if (!separated_only ||
+            !find_body_collision(pair.body1, pair.body2).collided) {
+            pairs[kept] = pair;
+            axes[kept] = VEC_ZERO;
+            kept++;
+        }
+    }
+    pair_count = kept;
+    broadphase_free(bp);
+
+    double full_time = 0.0, cached_time = 0.0;
+    size_t hits = 0, collided = 0, disagreements = 0;
+    for (size_t t = 0; t < BENCH_TICKS; t++) {
+        for (size_t i = 0; i < list_size(bodies); i++) {
+            body_t *body = list_get(bodies, i);
+            vector_t jitter = {random_double(-BENCH_JITTER, BENCH_JITTER),
+              random_double(-BENCH_JITTER, BENCH_JITTER)};
+            body_set_centroid(body, vec_add(body_get_centroid(body), jitter));
+            // Brings the cached vertices up to date outside the timed loops
+            body_get_vertices(body);
+        }
+        double start = now();
+        size_t full_collided = 0;
+        for (size_t p = 0; p < pair_count; p++) {
+            full_collided += find_body_collision(pairs[p].body1,
+              pairs[p].body2).collided;
+        }
+        full_time += now() - start;
+        start = now();
+        size_t cached_collided = 0;
+        for (size_t p = 0; p < pair_count; p++) {
+            // The scene checks the bounds first, as find_body_collision()
+            if (!bodies_may_collide(pairs[p].body1, pairs[p].body2)) {
+                continue;
+            }
+            bool hit;
+            cached_collided += find_body_collision_cached(pairs[p].body1,
+              pairs[p].body2, NARROWPHASE_SAT, &axes[p], &hit).collided;
+            hits += hit;
+        }
+        cached_time += now() - start;
+        collided += full_collided;
+        disagreements += full_collided != cached_collided;
+    }
+    size_t tests = pair_count * BENCH_TICKS;
+    printf("%s: %zu bodies, %zu candidate pairs, %.0f%% colliding\n", name,
+      list_size(bodies), pair_count, 100.0 * collided / tests);
+    printf("  full test:   %6.1f ns per pair\n", full_time * 1e9 / tests);
+    printf("  cached axis: %6.1f ns per pair, %.1f%% of pairs hit\n",
+      cached_time * 1e9 / tests, 100.0 * hits / tests);
+    assert(disagreements == 0);
+    free(pairs);
+    free(axes);
+    list_free(bodies);
+}
+
+int main(void) {
+    run("pit", 2 * BENCH_SIZE, false);
+    run("pit, separated pairs", 2 * BENCH_SIZE, true);
+    // Shapes whose boxes overlap but which mostly do not touch
+    run("spaced pit", 2 * (BENCH_SIZE + 2.5) - 2, false);
+    run("spaced pit, separated pairs", 2 * (BENCH_SIZE + 2.5) - 2, true);
+}
@@ -0,0 +1,83 @@
+#include "body.h"
+#include "body_store.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const size_t BENCH_SIZES[] = {1000, 10000, 100000};
+// Every size runs about this many body updates
+const size_t BENCH_UPDATES = 50000000;
+const double BENCH_DT = 1e-3;
+
+list_t *make_triangle(void) {
+    list_t *triangle = list_init(3, free, NULL);
+    vector_t corners[] = {{0, 0}, {1, 0}, {0, 1}};
+    for (size_t i = 0; i < 3; i++) {
+        vector_t *v = malloc(sizeof(*v));
+        assert(v != NULL);
+        *v = corners[i];
+        list_add(triangle, v);
+    }
+    return triangle;
+}
+
+/**
+ * Returns millions of bodies integrated per second, either by calling
+ * body_tick() on each body or by integrating them all in a store.
+ */
+double run(size_t n, bool use_store) {
+    body_t **bodies = malloc(n * sizeof(body_t *));
+    assert(bodies != NULL);
+    body_store_t *store = body_store_init(n);
+    for (size_t i = 0; i < n; i++) {
+        bodies[i] = body_init(make_triangle(), 1 + i % 7,
+          (rgb_color_t) {0, 0, 0});
+        body_set_velocity(bodies[i], (vector_t) {i % 13, i % 5});
+        if (use_store) {
+            body_store_add(store, bodies[i]);
+        }
+    }
+    size_t ticks = BENCH_UPDATES / n;
+    double start = now();
+    for (size_t t = 0; t < ticks; t++) {
+        if (use_store) {
+            body_store_integrate(store, BENCH_DT);
+        }
+        else {
+            for (size_t i = 0; i < n; i++) {
+                body_tick(bodies[i], BENCH_DT);
+            }
+        }
+    }
+    double rate = n * ticks / (now() - start) / 1e6;
+    body_store_free(store);
+    for (size_t i = 0; i < n; i++) {
+        body_free(bodies[i]);
+    }
+    free(bodies);
+    return rate;
+}
+
+int main(void) {
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    printf("%8s %10s", "bodies", "body_tick");
+    for (body_store_kernel_t k = BODY_STORE_SCALAR; k <= BODY_STORE_AVX2; k++) {
+        printf(" %10s", names[k]);
+    }
+    printf("   (M bodies/s)\n");
+    for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]); s++) {
+        size_t n = BENCH_SIZES[s];
+        printf("%8zu %10.1f", n, run(n, false));
+        for (body_store_kernel_t k = BODY_STORE_SCALAR; k <= BODY_STORE_AVX2;
+          k++) {
+            if (!body_store_kernel_supported(k)) {
+                printf(" %10s", "-");
+                continue;
+            }
+            body_store_set_kernel(k);
+            printf(" %10.1f", run(n, true));
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,150 @@
+#include "body.h"
+#include "broadphase.h"
+#include "list.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// finalgame's grid cell size, and a fattening margin for the tree
+const double BENCH_CELL_SIZE = 64.0;
+const double BENCH_MARGIN = 4.0;
+const size_t BENCH_TICKS = 50;
+// Bodies drift up to this far each tick
+const double BENCH_DRIFT = 1.0;
+// The game's window, pit shapes and rows
+const double BENCH_WIDTH = 800.0;
+const double BENCH_HEIGHT = 1010.0;
+const double BENCH_SHAPE_SIZE = 25.0;
+const size_t BENCH_PIT_ROWS = 12;
+// The synthetic scatter: bodies of radius 5 to 30 spread over a square,
+// plus a few hundred long walls like the game's floor
+const size_t BENCH_SCATTER_BODIES = 50000;
+const size_t BENCH_SCATTER_WALLS = 250;
+const double BENCH_SCATTER_SIDE = 12000.0;
+
+body_t *make_polygon(int n, double radius, vector_t center) {
+    list_t *points = list_init(n, free, NULL);
+    for (int i = 0; i < n; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        point->x = center.x + radius * cos(i * 2 * M_PI / n);
+        point->y = center.y + radius * sin(i * 2 * M_PI / n);
+        list_add(points, point);
+    }
+    return body_init(points, 1, (rgb_color_t) {0, 0, 0});
+}
+
+body_t *make_rectangle(double width, double height, vector_t center) {
+    list_t *points = list_init(4, free, NULL);
+    vector_t corners[] = {{-width / 2, -height / 2}, {width / 2, -height / 2},
+      {width / 2, height / 2}, {-width / 2, height / 2}};
+    for (size_t i = 0; i < 4; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        *point = vec_add(center, corners[i]);
+        list_add(points, point);
+    }
+    return body_init(points, INFINITY, (rgb_color_t) {0, 0, 0});
+}
+
+/**
+ * Builds finalgame's walls and floor, and a pit with a full row of 4- to
+ * 8-gons every 2 * BENCH_SHAPE_SIZE up the screen.
+ */
+list_t *make_game_layout(void) {
+    list_t *bodies = list_init(1, (free_func_t) body_free, NULL);
+    list_add(bodies, make_rectangle(2 * BENCH_WIDTH, 50,
+      (vector_t) {BENCH_WIDTH / 2, -15}));
+    list_add(bodies, make_rectangle(50, BENCH_HEIGHT,
+      (vector_t) {-25, BENCH_HEIGHT / 2}));
+    list_add(bodies, make_rectangle(50, BENCH_HEIGHT,
+      (vector_t) {BENCH_WIDTH + 25, BENCH_HEIGHT / 2}));
+    for (size_t row = 0; row < BENCH_PIT_ROWS; row++) {
+        for (double x = BENCH_SHAPE_SIZE; x < BENCH_WIDTH;
+          x += 2 * BENCH_SHAPE_SIZE) {
+            vector_t center = {x, 10 + BENCH_SHAPE_SIZE +
+              2 * BENCH_SHAPE_SIZE * row};
+            list_add(bodies, make_polygon(4 + rand() % 5,
+              BENCH_SHAPE_SIZE + 2.5, center));
+        }
+    }
+    return bodies;
+}
+
+list_t *make_scatter(void) {
+    list_t *bodies = list_init(1, (free_func_t) body_free, NULL);
+    for (size_t i = 0; i < BENCH_SCATTER_WALLS; i++) {
+        vector_t center = {random_double(0, BENCH_SCATTER_SIDE),
+          random_double(0, BENCH_SCATTER_SIDE)};
+        list_add(bodies, make_rectangle(1600, 50, center));
+    }
+    for (size_t i = 0; i < BENCH_SCATTER_BODIES; i++) {
+        vector_t center = {random_double(0, BENCH_SCATTER_SIDE),
+          random_double(0, BENCH_SCATTER_SIDE)};
+        list_add(bodies, make_polygon(3 + rand() % 6, random_double(5, 30),
+          center));
+    }
+    return bodies;
+}
+
+/**
+ * Prints the average time of a broadphase update while every body
+ * drifts a little each tick.
+ */
+void run(const char *name, broadphase_t *bp, list_t *bodies) {
+    srand(2);
+    size_t n = list_size(bodies);
+    vector_t *drift = malloc(n * sizeof(vector_t));
+    vector_t *start_centroids = malloc(n * sizeof(vector_t));
+    assert(drift != NULL && start_centroids != NULL);
+    for (size_t i = 0; i < n; i++) {
+        drift[i] = (vector_t) {random_double(-BENCH_DRIFT, BENCH_DRIFT),
+          random_double(-BENCH_DRIFT, BENCH_DRIFT)};
+        start_centroids[i] = body_get_centroid(list_get(bodies, i));
+    }
+    // The first update builds the structure from scratch
+    double start = now();
+    broadphase_update(bp, bodies);
+    double first = now() - start;
+    double total = 0.0;
+    size_t pairs = 0;
+    for (size_t t = 0; t < BENCH_TICKS; t++) {
+        for (size_t i = 0; i < n; i++) {
+            body_t *body = list_get(bodies, i);
+            // Swaps direction every 10 ticks so bodies stay nearby
+            vector_t step = (t / 10) % 2 == 0 ? drift[i] :
+              vec_negate(drift[i]);
+            body_set_centroid(body, vec_add(body_get_centroid(body), step));
+        }
+        start = now();
+        broadphase_update(bp, bodies);
+        total += now() - start;
+        pairs += broadphase_pair_count(bp);
+    }
+    printf("  %-6s first %9.3f ms, then %9.3f ms per update, %zu pairs\n",
+      name, first * 1e3, total * 1e3 / BENCH_TICKS, pairs / BENCH_TICKS);
+    // Puts the bodies back so the next broadphase sees the same scene
+    for (size_t i = 0; i < n; i++) {
+        body_set_centroid(list_get(bodies, i), start_centroids[i]);
+    }
+    free(drift);
+    free(start_centroids);
+    broadphase_free(bp);
+}
+
+int main(void) {
+    srand(1);
+    list_t *game = make_game_layout();
+    printf("game layout, %zu bodies:\n", list_size(game));
+    run("grid", broadphase_init_grid(BENCH_CELL_SIZE), game);
+    run("tree", broadphase_init_tree(BENCH_MARGIN), game);
+    list_free(game);
+
+    list_t *scatter = make_scatter();
+    printf("scatter, %zu bodies:\n", list_size(scatter));
+    run("grid", broadphase_init_grid(BENCH_CELL_SIZE), scatter);
+    run("tree", broadphase_init_tree(BENCH_MARGIN), scatter);
+    list_free(scatter);
+}
@@ -0,0 +1,94 @@
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A field of small blocks with a few bullets crossing it every tick
+const size_t BENCH_BLOCKS_PER_SIDE = 100;
+const double BENCH_SPACING = 40.0;
+const double BENCH_BLOCK_SIZE = 10.0;
+const size_t BENCH_BULLETS = 20;
+const double BENCH_BULLET_SIZE = 2.0;
+const double BENCH_BULLET_SPEED = 20000.0;
+const size_t BENCH_TICKS = 200;
+const double BENCH_DT = 1e-3;
+const unsigned int BENCH_BLOCK = 1;
+const unsigned int BENCH_SHOT = 2;
+
+body_t *make_square(vector_t center, double size, double mass) {
+    list_t *points = list_init(4, free, NULL);
+    for (int i = 0; i < 4; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        point->x = center.x + (i == 1 || i == 2 ? size : -size);
+        point->y = center.y + (i >= 2 ? size : -size);
+        list_add(points, point);
+    }
+    return body_init(points, mass, (rgb_color_t) {0, 0, 0});
+}
+
+/**
+ * Puts a bullet back at a random point on the left edge of the field,
+ * heading right at a random angle.
+ */
+void reload(body_t *bullet) {
+    double field = BENCH_BLOCKS_PER_SIDE * BENCH_SPACING;
+    body_teleport(bullet, (vector_t) {-BENCH_SPACING,
+      random_double(0, field)});
+    double angle = random_double(-0.3, 0.3);
+    body_set_velocity(bullet, (vector_t) {BENCH_BULLET_SPEED * cos(angle),
+      BENCH_BULLET_SPEED * sin(angle)});
+}
+
+void count_hit(body_t *bullet, body_t *block, vector_t axis, void *aux) {
+    (void) block;
+    (void) axis;
+    (*(size_t *) aux)++;
+    reload(bullet);
+}
+
+int main(void) {
+    srand(1);
+    scene_t *scene = scene_init();
+    for (size_t i = 0; i < BENCH_BLOCKS_PER_SIDE; i++) {
+        for (size_t j = 0; j < BENCH_BLOCKS_PER_SIDE; j++) {
+            body_t *block = make_square((vector_t) {i * BENCH_SPACING,
+              j * BENCH_SPACING}, BENCH_BLOCK_SIZE, INFINITY);
+            body_set_category(block, BENCH_BLOCK);
+            scene_add_body(scene, block);
+        }
+    }
+    body_t *bullets[BENCH_BULLETS];
+    for (size_t b = 0; b < BENCH_BULLETS; b++) {
+        bullets[b] = make_square(VEC_ZERO, BENCH_BULLET_SIZE, 1.0);
+        body_set_category(bullets[b], BENCH_SHOT);
+        body_set_bullet(bullets[b], true);
+        reload(bullets[b]);
+        scene_add_body(scene, bullets[b]);
+    }
+    size_t hits = 0;
+    scene_add_collision_rule(scene, BENCH_SHOT, BENCH_BLOCK, count_hit, &hits,
+      NULL);
+
+    size_t swept = 0, stopped = 0, candidates = 0;
+    double start = now();
+    for (size_t t = 0; t < BENCH_TICKS; t++) {
+        scene_tick(scene, BENCH_DT);
+        scene_stats_t stats = scene_get_stats(scene);
+        swept += stats.bullets_swept;
+        stopped += stats.bullets_stopped;
+        candidates += stats.bullet_candidates;
+    }
+    double elapsed = now() - start;
+    printf("%zu blocks, %zu bullets: %.3f ms per tick\n",
+      BENCH_BLOCKS_PER_SIDE * BENCH_BLOCKS_PER_SIDE, BENCH_BULLETS,
+      elapsed * 1e3 / BENCH_TICKS);
+    printf("%zu sweeps, %zu stopped, %zu hits, %.1f bodies tested per sweep\n",
+      swept, stopped, hits, (double) candidates / swept);
+    scene_free(scene);
+}
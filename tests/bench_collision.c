@@ -0,0 +1,76 @@
+#include "collision.h"
+#include "list.h"
+#include "star.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The shapes finalgame drops: 4- to 8-gons from init_polygon() with radius
+// SIZE_ALL + 2.5, and 5-point stars from init_special() with radius SIZE_ALL
+const double BENCH_SIZE = 25.0;
+const int BENCH_STAR_POINTS = 5;
+const size_t BENCH_PAIRS = 4096;
+const size_t BENCH_ROUNDS = 200;
+// Pairs are placed up to this far apart, so roughly half of them collide
+const double BENCH_SPREAD = 70.0;
+
+/**
+ * Builds the vertices of init_polygon() or init_special() around a center.
+ */
+list_t *make_shape(bool star, vector_t center) {
+    if (star) {
+        star_t *s = init_star(center, BENCH_STAR_POINTS, BENCH_SIZE, 0, 0);
+        list_t *coords = get_coords(s);
+        star_free(s);
+        return coords;
+    }
+    int n = 4 + rand() % 5;
+    list_t *points = list_init(n, free, NULL);
+    double angle = 2 * M_PI / n;
+    for (int i = 0; i < n; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        point->x = center.x + (BENCH_SIZE + 2.5) * cos(i * angle);
+        point->y = center.y + (BENCH_SIZE + 2.5) * sin(i * angle);
+        list_add(points, point);
+    }
+    return points;
+}
+
+/**
+ * Prints the number of find_collision() calls per second on pairs of
+ * n-gons and stars.
+ */
+void run(const char *name, bool star1, bool star2) {
+    list_t *shapes1[BENCH_PAIRS], *shapes2[BENCH_PAIRS];
+    for (size_t i = 0; i < BENCH_PAIRS; i++) {
+        shapes1[i] = make_shape(star1, VEC_ZERO);
+        vector_t offset = {random_double(-BENCH_SPREAD, BENCH_SPREAD),
+          random_double(-BENCH_SPREAD, BENCH_SPREAD)};
+        shapes2[i] = make_shape(star2, offset);
+    }
+    size_t collided = 0;
+    double start = now();
+    for (size_t r = 0; r < BENCH_ROUNDS; r++) {
+        for (size_t i = 0; i < BENCH_PAIRS; i++) {
+            collided += find_collision(shapes1[i], shapes2[i]).collided;
+        }
+    }
+    double elapsed = now() - start;
+    printf("%-14s %8.2f M pairs/s  (%.0f%% colliding)\n", name,
+      BENCH_PAIRS * BENCH_ROUNDS / elapsed / 1e6,
+      100.0 * collided / (BENCH_PAIRS * BENCH_ROUNDS));
+    for (size_t i = 0; i < BENCH_PAIRS; i++) {
+        list_free(shapes1[i]);
+        list_free(shapes2[i]);
+    }
+}
+
+int main(void) {
+    srand(1);
+    run("n-gon, n-gon", false, false);
+    run("star, n-gon", true, false);
+    run("star, star", true, true);
+}
@@ -0,0 +1,82 @@
+#include "collision.h"
+#include "gjk.h"
+#include "shape.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const double BENCH_RADIUS = 27.5;
+const size_t BENCH_PAIRS = 1024;
+const size_t BENCH_ROUNDS = 100;
+// Pairs are placed up to this far apart, so roughly half of them collide
+const double BENCH_SPREAD = 70.0;
+const size_t BENCH_VERTEX_COUNTS[] = {3, 4, 5, 6, 8, 12, 16, 24, 32, 48, 64};
+
+/**
+ * Builds a randomly rotated regular n-gon around a center.
+ */
+void make_polygon(shape_t *shape, size_t n, vector_t center) {
+    shape_init(shape, n);
+    double rotation = random_double(0, 2 * M_PI);
+    for (size_t i = 0; i < n; i++) {
+        double angle = rotation + i * 2 * M_PI / n;
+        shape_add(shape, (vector_t) {center.x + BENCH_RADIUS * cos(angle),
+          center.y + BENCH_RADIUS * sin(angle)});
+    }
+}
+
+/**
+ * Prints the time per pair of find_shape_collision() (SAT) and
+ * find_shape_collision_gjk() (GJK/EPA) on pairs of n-gons, and asserts
+ * that they agree on which pairs collide.
+ */
+void run(size_t n) {
+    shape_t *shapes1 = malloc(BENCH_PAIRS * sizeof(shape_t));
+    shape_t *shapes2 = malloc(BENCH_PAIRS * sizeof(shape_t));
+    assert(shapes1 != NULL && shapes2 != NULL);
+    for (size_t i = 0; i < BENCH_PAIRS; i++) {
+        make_polygon(&shapes1[i], n, VEC_ZERO);
+        vector_t offset = {random_double(-BENCH_SPREAD, BENCH_SPREAD),
+          random_double(-BENCH_SPREAD, BENCH_SPREAD)};
+        make_polygon(&shapes2[i], n, offset);
+    }
+    size_t sat_collided = 0;
+    double start = now();
+    for (size_t r = 0; r < BENCH_ROUNDS; r++) {
+        for (size_t i = 0; i < BENCH_PAIRS; i++) {
+            sat_collided += find_shape_collision(&shapes1[i],
+              &shapes2[i]).collided;
+        }
+    }
+    double sat_time = now() - start;
+    size_t gjk_collided = 0;
+    start = now();
+    for (size_t r = 0; r < BENCH_ROUNDS; r++) {
+        for (size_t i = 0; i < BENCH_PAIRS; i++) {
+            gjk_collided += find_shape_collision_gjk(&shapes1[i],
+              &shapes2[i], VEC_ZERO).collided;
+        }
+    }
+    double gjk_time = now() - start;
+    size_t tests = BENCH_PAIRS * BENCH_ROUNDS;
+    printf("%3zu vertices  SAT %7.1f ns  GJK %7.1f ns  (%.0f%% colliding)\n",
+      n, sat_time * 1e9 / tests, gjk_time * 1e9 / tests,
+      100.0 * sat_collided / tests);
+    assert(sat_collided == gjk_collided);
+    for (size_t i = 0; i < BENCH_PAIRS; i++) {
+        shape_release(&shapes1[i]);
+        shape_release(&shapes2[i]);
+    }
+    free(shapes1);
+    free(shapes2);
+}
+
+int main(void) {
+    srand(1);
+    size_t count = sizeof(BENCH_VERTEX_COUNTS) / sizeof(BENCH_VERTEX_COUNTS[0]);
+    for (size_t i = 0; i < count; i++) {
+        run(BENCH_VERTEX_COUNTS[i]);
+    }
+}
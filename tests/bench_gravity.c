@@ -0,0 +1,153 @@
+#include "barnes_hut.h"
+#include "body.h"
+#include "force_records.h"
+#include "forces.h"
+#include "list.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const double BENCH_G = 100.0;
+const size_t BENCH_SIZES[] = {1000, 10000, 100000};
+const double BENCH_THETAS[] = {0.3, 0.5, 0.8, 1.0};
+// Bodies are spread over a square this many units wide per sqrt(body)
+const double BENCH_SPACING = 20.0;
+// Errors are measured against the exact forces on this many bodies
+const size_t BENCH_SAMPLE = 500;
+// Pairwise force records are only registered up to this many bodies
+const size_t BENCH_MAX_PAIRWISE = 1000;
+const double BENCH_DT = 1e-3;
+const size_t BENCH_REPEATS = 3;
+
+body_t *make_body(vector_t center, double mass) {
+    list_t *triangle = list_init(3, free, NULL);
+    vector_t corners[] = {{0, 0}, {1, 0}, {0, 1}};
+    for (size_t i = 0; i < 3; i++) {
+        vector_t *v = malloc(sizeof(*v));
+        assert(v != NULL);
+        *v = vec_add(center, corners[i]);
+        list_add(triangle, v);
+    }
+    return body_init(triangle, mass, (rgb_color_t) {0, 0, 0});
+}
+
+/**
+ * The exact pull of every other body on one body, with the MIN_DIST cutoff
+ * of create_newtonian_gravity().
+ */
+vector_t exact_force(const vector_t *positions, const double *masses,
+  size_t n, size_t index) {
+    // Plain arithmetic instead of the vec_* calls keeps the loop tight
+    vector_t p = positions[index];
+    double fx = 0.0, fy = 0.0;
+    for (size_t j = 0; j < n; j++) {
+        double dx = positions[j].x - p.x;
+        double dy = positions[j].y - p.y;
+        double distance = sqrt(dx * dx + dy * dy);
+        if (j == index || distance <= MIN_DIST) {
+            continue;
+        }
+        double magnitude = BENCH_G * masses[index] * masses[j] /
+          (distance * distance);
+        fx += magnitude * dx / distance;
+        fy += magnitude * dy / distance;
+    }
+    return (vector_t) {fx, fy};
+}
+
+void clear_forces(list_t *bodies) {
+    for (size_t i = 0; i < list_size(bodies); i++) {
+        body_set_force(list_get(bodies, i), VEC_ZERO);
+    }
+}
+
+/**
+ * Times one pairwise tick with a create_newtonian_gravity() force for
+ * every pair of bodies.
+ */
+double time_pairwise(size_t n) {
+    srand(1);
+    scene_t *scene = scene_init();
+    double side = BENCH_SPACING * sqrt(n);
+    for (size_t i = 0; i < n; i++) {
+        vector_t center = {random_double(0, side), random_double(0, side)};
+        scene_add_body(scene, make_body(center, random_double(1, 10)));
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            create_newtonian_gravity(scene, BENCH_G, scene_get_body(scene, i),
+              scene_get_body(scene, j));
+        }
+    }
+    double start = now();
+    scene_tick(scene, BENCH_DT);
+    double elapsed = now() - start;
+    scene_free(scene);
+    return elapsed;
+}
+
+void run(size_t n) {
+    srand(1);
+    list_t *bodies = list_init(n, (free_func_t) body_free, NULL);
+    double side = BENCH_SPACING * sqrt(n);
+    for (size_t i = 0; i < n; i++) {
+        vector_t center = {random_double(0, side), random_double(0, side)};
+        list_add(bodies, make_body(center, random_double(1, 10)));
+    }
+    vector_t *positions = malloc(n * sizeof(vector_t));
+    double *masses = malloc(n * sizeof(double));
+    assert(positions != NULL && masses != NULL);
+    for (size_t i = 0; i < n; i++) {
+        positions[i] = body_get_centroid(list_get(bodies, i));
+        masses[i] = body_get_mass(list_get(bodies, i));
+    }
+    size_t sample = n < BENCH_SAMPLE ? n : BENCH_SAMPLE;
+    vector_t exact[sample];
+    double start = now();
+    for (size_t s = 0; s < sample; s++) {
+        exact[s] = exact_force(positions, masses, n, s * (n / sample));
+    }
+    // The exact sum over every body, scaled up from the sample
+    double direct = (now() - start) * n / sample;
+    free(positions);
+    free(masses);
+    printf("%7zu bodies: direct sum %10.2f ms", n, direct * 1e3);
+    if (n <= BENCH_MAX_PAIRWISE) {
+        printf(", pairwise forces %8.2f ms", time_pairwise(n) * 1e3);
+    }
+    printf("\n");
+
+    for (size_t t = 0; t < sizeof(BENCH_THETAS) / sizeof(double); t++) {
+        barnes_hut_t *bh = barnes_hut_init(BENCH_G, BENCH_THETAS[t]);
+        // The first update allocates the tree, so it is not timed
+        barnes_hut_apply(bh, bodies, NULL);
+        double elapsed = 0.0;
+        for (size_t r = 0; r < BENCH_REPEATS; r++) {
+            clear_forces(bodies);
+            start = now();
+            barnes_hut_apply(bh, bodies, NULL);
+            elapsed += (now() - start) / BENCH_REPEATS;
+        }
+        // Relative RMS error of the sampled forces
+        double error = 0.0, total = 0.0;
+        for (size_t s = 0; s < sample; s++) {
+            vector_t diff = vec_subtract(
+              body_get_force(list_get(bodies, s * (n / sample))), exact[s]);
+            error += vec_dot(diff, diff);
+            total += vec_dot(exact[s], exact[s]);
+        }
+        printf("  theta %.1f: %10.2f ms, relative error %.2e\n",
+          BENCH_THETAS[t], elapsed * 1e3, sqrt(error / total));
+        barnes_hut_free(bh);
+    }
+    list_free(bodies);
+}
+
+int main(void) {
+    for (size_t s = 0; s < sizeof(BENCH_SIZES) / sizeof(size_t); s++) {
+        run(BENCH_SIZES[s]);
+    }
+}
@@ -0,0 +1,77 @@
+#include "projection.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Polygons of n vertices projected onto their n edge normals, as the
+// separating axis test does with one polygon's unique normals
+const size_t BENCH_VERTEX_COUNTS[] = {3, 4, 6, 8, 12, 16, 32, 64};
+const size_t BENCH_SHAPES = 256;
+// Every size runs about this many point-axis projections
+const size_t BENCH_PROJECTIONS = 200000000;
+
+/**
+ * Returns the average time in ns of one project_points() call on an n-gon
+ * and its n edge normals with the kernel in use.
+ */
+double run(size_t n) {
+    vector_t *points = malloc(BENCH_SHAPES * n * sizeof(vector_t));
+    vector_t *axes = malloc(BENCH_SHAPES * n * sizeof(vector_t));
+    double *mins = malloc(n * sizeof(double));
+    double *maxes = malloc(n * sizeof(double));
+    assert(points != NULL && axes != NULL && mins != NULL && maxes != NULL);
+    srand(1);
+    for (size_t s = 0; s < BENCH_SHAPES; s++) {
+        double rotation = random_double(0, 2 * M_PI);
+        for (size_t i = 0; i < n; i++) {
+            double angle = rotation + i * 2 * M_PI / n;
+            points[s * n + i] = (vector_t) {cos(angle), sin(angle)};
+            axes[s * n + i] = (vector_t) {cos(angle + M_PI / n),
+              sin(angle + M_PI / n)};
+        }
+    }
+    size_t rounds = BENCH_PROJECTIONS / (BENCH_SHAPES * n * n) + 1;
+    double sum = 0.0;
+    double start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t s = 0; s < BENCH_SHAPES; s++) {
+            project_points(points + s * n, n, axes + s * n, n, mins, maxes);
+            // Keeps the results live
+            sum += mins[0] + maxes[n - 1];
+        }
+    }
+    double elapsed = now() - start;
+    assert(!isnan(sum));
+    free(points);
+    free(axes);
+    free(mins);
+    free(maxes);
+    return elapsed * 1e9 / (rounds * BENCH_SHAPES);
+}
+
+int main(void) {
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    printf("%8s", "vertices");
+    for (projection_kernel_t k = PROJECTION_SCALAR; k <= PROJECTION_AVX2;
+      k++) {
+        printf(" %10s", names[k]);
+    }
+    printf("   (ns per call)\n");
+    size_t count = sizeof(BENCH_VERTEX_COUNTS) / sizeof(BENCH_VERTEX_COUNTS[0]);
+    for (size_t c = 0; c < count; c++) {
+        size_t n = BENCH_VERTEX_COUNTS[c];
+        printf("%8zu", n);
+        for (projection_kernel_t k = PROJECTION_SCALAR; k <= PROJECTION_AVX2;
+          k++) {
+            if (!projection_kernel_supported(k)) {
+                printf(" %10s", "-");
+                continue;
+            }
+            projection_set_kernel(k);
+            printf(" %10.1f", run(n));
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,84 @@
+#include "body.h"
+#include "forces.h"
+#include "list.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const size_t BENCH_BODIES = 10000;
+const double BENCH_DT = 1e-3;
+const size_t BENCH_REPEATS = 7;
+
+list_t *make_square(vector_t center) {
+    list_t *square = list_init(4, free, NULL);
+    vector_t corners[] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    for (size_t i = 0; i < 4; i++) {
+        vector_t *v = malloc(sizeof(*v));
+        assert(v != NULL);
+        *v = vec_add(center, corners[i]);
+        list_add(square, v);
+    }
+    return square;
+}
+
+/**
+ * Builds a scene of bodies in a row, each with drag and a spring to the next
+ * body, so there are two forces per body and most bodies are in three.
+ */
+scene_t *make_scene(void) {
+    scene_t *scene = scene_init();
+    body_t *previous = NULL;
+    for (size_t i = 0; i < BENCH_BODIES; i++) {
+        body_t *body = body_init(make_square((vector_t) {3.0 * i, 0}), 1,
+          (rgb_color_t) {0, 0, 0});
+        scene_add_body(scene, body);
+        create_drag(scene, 0.1, body);
+        if (previous != NULL) {
+            create_spring(scene, 1.0, previous, body);
+        }
+        previous = body;
+    }
+    // Ticks once so any lazily built state exists before timing
+    scene_tick(scene, BENCH_DT);
+    return scene;
+}
+
+/**
+ * Times the tick that removes every stride-th body,
+ * or a tick that removes nothing if stride is 0.
+ */
+double time_tick(size_t stride) {
+    scene_t *scene = make_scene();
+    size_t removed = 0;
+    for (size_t i = 0; stride > 0 && i < BENCH_BODIES; i += stride) {
+        body_remove(scene_get_body(scene, i));
+        removed++;
+    }
+    double start = now();
+    scene_tick(scene, BENCH_DT);
+    double elapsed = now() - start;
+    assert(scene_bodies(scene) == BENCH_BODIES - removed);
+    scene_free(scene);
+    return elapsed;
+}
+
+/**
+ * Prints the fastest of several timings, since a single tick is noisy.
+ */
+void run(const char *name, size_t stride) {
+    double best = time_tick(stride);
+    for (size_t r = 1; r < BENCH_REPEATS; r++) {
+        double elapsed = time_tick(stride);
+        best = elapsed < best ? elapsed : best;
+    }
+    printf("%-28s %10.3f ms\n", name, best * 1e3);
+}
+
+int main(void) {
+    run("tick removing nothing", 0);
+    run("clear all 10000 bodies", 1);
+    run("remove every 10th body", 10);
+    run("remove every 100th body", 100);
+}
@@ -0,0 +1,156 @@
+#include "body.h"
+#include "collision.h"
+#include "list.h"
+#include "star.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The shapes finalgame drops: 3- to 8-gons of radius SIZE_ALL + 2.5, and
+// 5-point stars of radius SIZE_ALL, which are tested as their 3- and
+// 4-vertex convex pieces
+const double BENCH_SIZE = 25.0;
+const int BENCH_STAR_POINTS = 5;
+const int BENCH_MIN_VERTICES = 3;
+const int BENCH_MAX_VERTICES = 8;
+const size_t BENCH_PAIRS = 512;
+const size_t BENCH_ROUNDS = 40;
+const size_t BENCH_REPEATS = 5;
+// Spread pairs are placed up to this far apart, so roughly half of them
+// collide; near pairs are placed between these multiples of the radius
+// apart, so their boxes overlap but most of them do not collide and the
+// time goes to the separating axis test
+const double BENCH_SPREAD = 70.0;
+const double BENCH_NEAR_MIN = 1.6;
+const double BENCH_NEAR_MAX = 2.0;
+
+/**
+ * Builds a randomly rotated regular n-gon, or a star if n is 0.
+ */
+body_t *make_shape(int n, vector_t center) {
+    if (n == 0) {
+        star_t *star = init_star(center, BENCH_STAR_POINTS, BENCH_SIZE, 0, 0);
+        list_t *coords = get_coords(star);
+        star_free(star);
+        return body_init(coords, 1, (rgb_color_t) {0, 0, 0});
+    }
+    list_t *points = list_init(n, free, NULL);
+    double rotation = random_double(0, 2 * M_PI);
+    for (int i = 0; i < n; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        double angle = rotation + i * 2 * M_PI / n;
+        point->x = center.x + (BENCH_SIZE + 2.5) * cos(angle);
+        point->y = center.y + (BENCH_SIZE + 2.5) * sin(angle);
+        list_add(points, point);
+    }
+    return body_init(points, 1, (rgb_color_t) {0, 0, 0});
+}
+
+/**
+ * Returns the average time in ns of find_body_collision() on the pairs.
+ */
+double time_pairs(body_t **bodies1, body_t **bodies2, size_t *collided) {
+    *collided = 0;
+    double start = now();
+    for (size_t r = 0; r < BENCH_ROUNDS; r++) {
+        for (size_t i = 0; i < BENCH_PAIRS; i++) {
+            *collided += find_body_collision(bodies1[i],
+              bodies2[i]).collided;
+        }
+    }
+    return (now() - start) * 1e9 / (BENCH_ROUNDS * BENCH_PAIRS);
+}
+
+/**
+ * Returns where to put the second shape of a pair, spread out or near.
+ */
+vector_t place(bool near) {
+    if (!near) {
+        return (vector_t) {random_double(-BENCH_SPREAD, BENCH_SPREAD),
+          random_double(-BENCH_SPREAD, BENCH_SPREAD)};
+    }
+    double angle = random_double(0, 2 * M_PI);
+    double distance = (BENCH_SIZE + 2.5) *
+      random_double(BENCH_NEAR_MIN, BENCH_NEAR_MAX);
+    return (vector_t) {distance * cos(angle), distance * sin(angle)};
+}
+
+/**
+ * Finds the time per pair of n1-gons against n2-gons (0 for stars) with
+ * the generic separating axis test and with the specialized kernels.
+ */
+void time_layout(int n1, int n2, bool near, double *generic, double *kernel,
+  double *percent_collided) {
+    body_t *bodies1[BENCH_PAIRS], *bodies2[BENCH_PAIRS];
+    for (size_t i = 0; i < BENCH_PAIRS; i++) {
+        bodies1[i] = make_shape(n1, VEC_ZERO);
+        bodies2[i] = make_shape(n2, place(near));
+        // Brings the cached vertices and normals up to date untimed
+        body_get_vertices(bodies1[i]);
+        body_get_vertices(bodies2[i]);
+    }
+    // The two tests take turns, and each keeps its best time
+    size_t generic_collided, kernel_collided;
+    *generic = INFINITY;
+    *kernel = INFINITY;
+    for (size_t r = 0; r < BENCH_REPEATS; r++) {
+        collision_set_sat_kernels(false);
+        *generic = fmin(*generic, time_pairs(bodies1, bodies2,
+          &generic_collided));
+        collision_set_sat_kernels(true);
+        *kernel = fmin(*kernel, time_pairs(bodies1, bodies2,
+          &kernel_collided));
+        assert(generic_collided == kernel_collided);
+    }
+    *percent_collided = 100.0 * kernel_collided / (BENCH_ROUNDS * BENCH_PAIRS);
+    for (size_t i = 0; i < BENCH_PAIRS; i++) {
+        body_free(bodies1[i]);
+        body_free(bodies2[i]);
+    }
+}
+
+/**
+ * Prints the generic and kernel times of a pair type in both layouts.
+ */
+void run(int n1, int n2) {
+    char name[16];
+    if (n1 != 0 && n2 != 0) {
+        snprintf(name, sizeof(name), "%d x %d", n1, n2);
+    }
+    else if (n1 != 0) {
+        snprintf(name, sizeof(name), "%d x star", n1);
+    }
+    else {
+        snprintf(name, sizeof(name), "star x star");
+    }
+    printf("%-12s", name);
+    for (int near = 1; near >= 0; near--) {
+        double generic, kernel, collided;
+        time_layout(n1, n2, near, &generic, &kernel, &collided);
+        printf(" %7.1f %7.1f %5.2fx %3.0f%%", generic, kernel,
+          generic / kernel, collided);
+    }
+    printf("\n");
+}
+
+int main(void) {
+    srand(1);
+    printf("%-12s %29s %29s\n", "", "near pairs", "spread pairs");
+    printf("%-12s", "pair");
+    for (int layout = 0; layout < 2; layout++) {
+        printf(" %7s %7s %6s %4s", "generic", "kernel", "ratio", "hit");
+    }
+    printf("   (ns per pair)\n");
+    for (int n1 = BENCH_MIN_VERTICES; n1 <= BENCH_MAX_VERTICES; n1++) {
+        for (int n2 = BENCH_MIN_VERTICES; n2 <= BENCH_MAX_VERTICES; n2++) {
+            run(n1, n2);
+        }
+    }
+    for (int n = BENCH_MIN_VERTICES; n <= BENCH_MAX_VERTICES; n++) {
+        run(n, 0);
+    }
+    run(0, 0);
+}
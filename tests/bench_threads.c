@@ -0,0 +1,89 @@
+#include "barnes_hut.h"
+#include "body.h"
+#include "broadphase.h"
+#include "forces.h"
+#include "list.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// A square grid of this many bodies on a side
+const size_t BENCH_SIDE = 150;
+const double BENCH_SPACING = 12.0;
+const double BENCH_RADIUS = 5.0;
+const size_t BENCH_WARMUP = 2;
+const size_t BENCH_TICKS = 20;
+const double BENCH_DT = 1e-3;
+const size_t BENCH_MAX_THREADS = 8;
+
+body_t *make_pentagon(vector_t center) {
+    list_t *points = list_init(5, free, NULL);
+    for (int i = 0; i < 5; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        point->x = center.x + BENCH_RADIUS * cos(i * 2 * M_PI / 5);
+        point->y = center.y + BENCH_RADIUS * sin(i * 2 * M_PI / 5);
+        list_add(points, point);
+    }
+    body_t *body = body_init(points, 1, (rgb_color_t) {0, 0, 0});
+    body_set_category(body, 1);
+    return body;
+}
+
+/**
+ * Builds a grid of pentagons pulled together by a Barnes-Hut gravity
+ * field, each with drag and a spring to its right-hand neighbor, and
+ * resolving contacts with each other.
+ */
+scene_t *make_scene(size_t threads) {
+    scene_t *scene = scene_init();
+    for (size_t row = 0; row < BENCH_SIDE; row++) {
+        for (size_t col = 0; col < BENCH_SIDE; col++) {
+            body_t *body = make_pentagon((vector_t) {col * BENCH_SPACING,
+              row * BENCH_SPACING});
+            scene_add_body(scene, body);
+            create_drag(scene, 0.1, body);
+            if (col > 0) {
+                create_spring(scene, 1.0,
+                  scene_get_body(scene, scene_bodies(scene) - 2), body);
+            }
+        }
+    }
+    scene_set_gravity_field(scene, barnes_hut_init(1000.0, 0.5));
+    scene_set_broadphase(scene, broadphase_init_grid(2 * BENCH_SPACING));
+    scene_add_contact_rule(scene, 1, 1, 0.5);
+    scene_set_threads(scene, threads);
+    return scene;
+}
+
+double time_ticks(size_t threads) {
+    scene_t *scene = make_scene(threads);
+    for (size_t t = 0; t < BENCH_WARMUP; t++) {
+        scene_tick(scene, BENCH_DT);
+    }
+    double start = now();
+    for (size_t t = 0; t < BENCH_TICKS; t++) {
+        scene_tick(scene, BENCH_DT);
+    }
+    double elapsed = (now() - start) / BENCH_TICKS;
+    scene_free(scene);
+    return elapsed;
+}
+
+int main(void) {
+    printf("%zu bodies, %ld cores online\n", BENCH_SIDE * BENCH_SIDE,
+      sysconf(_SC_NPROCESSORS_ONLN));
+    double single = 0.0;
+    for (size_t threads = 1; threads <= BENCH_MAX_THREADS; threads *= 2) {
+        double elapsed = time_ticks(threads);
+        if (threads == 1) {
+            single = elapsed;
+        }
+        printf("%2zu threads: %8.2f ms per tick, %.2fx\n", threads,
+          elapsed * 1e3, single / elapsed);
+    }
+}
@@ -0,0 +1,126 @@
+#include "body.h"
+#include "body_store.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+// Not a multiple of any kernel's width, so the remainder loops run too
+const size_t STORE_TEST_BODIES = 37;
+const size_t STORE_TEST_TICKS = 500;
+const double STORE_TEST_DT = 1e-3;
+
+list_t *make_square(double side) {
+    list_t *square = list_init(4, free, NULL);
+    double half = side / 2;
+    vector_t corners[] = {{-half, -half}, {half, -half}, {half, half},
+      {-half, half}};
+    for (size_t i = 0; i < 4; i++) {
+        vector_t *v = malloc(sizeof(*v));
+        assert(v != NULL);
+        *v = corners[i];
+        list_add(square, v);
+    }
+    return square;
+}
+
+/**
+ * Ticks bodies in a store alongside identical bodies ticked by body_tick(),
+ * and checks that the two stay exactly equal.
+ */
+void check_kernel(body_store_kernel_t kernel) {
+    body_store_set_kernel(kernel);
+    assert(body_store_get_kernel() == kernel);
+    srand(1);
+    body_t *stored[STORE_TEST_BODIES], *loose[STORE_TEST_BODIES];
+    body_store_t *store = body_store_init(1);
+    for (size_t i = 0; i < STORE_TEST_BODIES; i++) {
+        double mass = random_double(0.1, 50);
+        vector_t centroid = {random_double(-100, 100),
+          random_double(-100, 100)};
+        vector_t velocity = {random_double(-10, 10), random_double(-10, 10)};
+        stored[i] = body_init(make_square(2), mass, (rgb_color_t) {0, 0, 0});
+        loose[i] = body_init(make_square(2), mass, (rgb_color_t) {0, 0, 0});
+        body_set_centroid(stored[i], centroid);
+        body_set_centroid(loose[i], centroid);
+        body_set_velocity(stored[i], velocity);
+        body_set_velocity(loose[i], velocity);
+        body_store_add(store, stored[i]);
+    }
+    for (size_t t = 0; t < STORE_TEST_TICKS; t++) {
+        for (size_t i = 0; i < STORE_TEST_BODIES; i++) {
+            vector_t force = {random_double(-50, 50), random_double(-50, 50)};
+            vector_t impulse = {0, 0};
+            if (rand() % 10 == 0) {
+                impulse = (vector_t) {random_double(-1, 1),
+                  random_double(-1, 1)};
+            }
+            body_add_force(stored[i], force);
+            body_add_force(loose[i], force);
+            body_add_impulse(stored[i], impulse);
+            body_add_impulse(loose[i], impulse);
+            body_tick(loose[i], STORE_TEST_DT);
+        }
+        body_store_integrate(store, STORE_TEST_DT);
+        for (size_t i = 0; i < STORE_TEST_BODIES; i++) {
+            assert(vec_equal(body_get_centroid(stored[i]),
+              body_get_centroid(loose[i])));
+            assert(vec_equal(body_get_velocity(stored[i]),
+              body_get_velocity(loose[i])));
+            assert(vec_equal(body_get_force(stored[i]), VEC_ZERO));
+            assert(vec_equal(body_get_impulse(stored[i]), VEC_ZERO));
+        }
+    }
+    body_store_free(store);
+    for (size_t i = 0; i < STORE_TEST_BODIES; i++) {
+        body_free(stored[i]);
+        body_free(loose[i]);
+    }
+}
+
+void test_store_matches_body_tick() {
+    body_store_kernel_t kernels[] = {BODY_STORE_SCALAR, BODY_STORE_SSE2,
+      BODY_STORE_AVX2};
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (body_store_kernel_supported(kernels[k])) {
+            check_kernel(kernels[k]);
+        }
+    }
+}
+
+void test_remove_keeps_state() {
+    body_store_t *store = body_store_init(1);
+    body_t *bodies[5];
+    for (size_t i = 0; i < 5; i++) {
+        bodies[i] = body_init(make_square(1), 1, (rgb_color_t) {0, 0, 0});
+        body_set_centroid(bodies[i], (vector_t) {i, 0});
+        body_store_add(store, bodies[i]);
+    }
+    body_set_velocity(bodies[1], (vector_t) {0, 2});
+    body_store_remove(store, bodies[1]);
+    assert(body_store_size(store) == 4);
+    body_store_integrate(store, 0.5);
+    assert(vec_equal(body_get_centroid(bodies[1]), (vector_t) {1, 0}));
+    assert(vec_equal(body_get_velocity(bodies[1]), (vector_t) {0, 2}));
+    for (size_t i = 0; i < 5; i++) {
+        assert(vec_equal(body_get_centroid(bodies[i]), (vector_t) {i, 0}));
+    }
+    body_store_free(store);
+    for (size_t i = 0; i < 5; i++) {
+        body_free(bodies[i]);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_store_matches_body_tick)
+    DO_TEST(test_remove_keeps_state)
+
+    puts("body_store_test PASS");
+}
@@ -0,0 +1,120 @@
+#include "body.h"
+#include "collision.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Every vertex count a build can give a kernel, and one more
+const size_t COLLISION_TEST_MIN_VERTICES = 3;
+const size_t COLLISION_TEST_MAX_VERTICES = 13;
+const size_t COLLISION_TEST_PAIRS = 200;
+
+int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Builds a random convex polygon: n points at sorted random angles on a
+ * circle of random radius around a center.
+ */
+body_t *make_convex(size_t n, vector_t center) {
+    double angles[n];
+    for (size_t i = 0; i < n; i++) {
+        angles[i] = random_double(0, 2 * M_PI);
+    }
+    qsort(angles, n, sizeof(double), compare_doubles);
+    double radius = random_double(5, 30);
+    list_t *points = list_init(n, free, NULL);
+    for (size_t i = 0; i < n; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        point->x = center.x + radius * cos(angles[i]);
+        point->y = center.y + radius * sin(angles[i]);
+        list_add(points, point);
+    }
+    return body_init(points, 1, (rgb_color_t) {0, 0, 0});
+}
+
+/**
+ * Checks that two collisions are exactly the same.
+ */
+void assert_same_collision(collision_info_t a, collision_info_t b) {
+    assert(a.collided == b.collided);
+    assert(vec_equal(a.axis, b.axis));
+    if (!a.collided) {
+        return;
+    }
+    assert(a.depth == b.depth);
+    assert(a.contact_count == b.contact_count);
+    for (size_t i = 0; i < a.contact_count; i++) {
+        assert(vec_equal(a.contacts[i], b.contacts[i]));
+    }
+}
+
+void test_sat_kernels_match_generic() {
+    srand(1);
+    size_t collided = 0, tests = 0;
+    for (size_t n1 = COLLISION_TEST_MIN_VERTICES;
+      n1 <= COLLISION_TEST_MAX_VERTICES; n1++) {
+        for (size_t n2 = COLLISION_TEST_MIN_VERTICES;
+          n2 <= COLLISION_TEST_MAX_VERTICES; n2++) {
+            for (size_t p = 0; p < COLLISION_TEST_PAIRS; p++) {
+                body_t *body1 = make_convex(n1, VEC_ZERO);
+                body_t *body2 = make_convex(n2, (vector_t)
+                  {random_double(-50, 50), random_double(-50, 50)});
+                collision_set_sat_kernels(true);
+                collision_info_t kernel = find_body_collision(body1, body2);
+                collision_set_sat_kernels(false);
+                collision_info_t generic = find_body_collision(body1, body2);
+                assert_same_collision(kernel, generic);
+                collided += kernel.collided;
+                tests++;
+                body_free(body1);
+                body_free(body2);
+            }
+        }
+    }
+    collision_set_sat_kernels(true);
+    // Both outcomes are covered
+    assert(collided > tests / 10 && collided < tests - tests / 10);
+}
+
+void test_square_overlap() {
+    list_t *square1 = list_init(4, free, NULL);
+    list_t *square2 = list_init(4, free, NULL);
+    vector_t corners[] = {{0, 0}, {2, 0}, {2, 2}, {0, 2}};
+    for (size_t i = 0; i < 4; i++) {
+        vector_t *v1 = malloc(sizeof(vector_t));
+        vector_t *v2 = malloc(sizeof(vector_t));
+        assert(v1 != NULL && v2 != NULL);
+        *v1 = corners[i];
+        *v2 = vec_add(corners[i], (vector_t) {1.5, 0.5});
+        list_add(square1, v1);
+        list_add(square2, v2);
+    }
+    body_t *body1 = body_init(square1, 1, (rgb_color_t) {0, 0, 0});
+    body_t *body2 = body_init(square2, 1, (rgb_color_t) {0, 0, 0});
+    collision_info_t info = find_body_collision(body1, body2);
+    assert(info.collided);
+    assert(isclose(info.depth, 0.5));
+    assert(vec_isclose(info.axis, (vector_t) {1, 0}));
+    body_free(body1);
+    body_free(body2);
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_sat_kernels_match_generic)
+    DO_TEST(test_square_overlap)
+
+    puts("collision_test PASS");
+}
@@ -0,0 +1,109 @@
+#include "barnes_hut.h"
+#include "body.h"
+#include "forces.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t DET_SIDE = 12;
+const double DET_SPACING = 12.0;
+const double DET_RADIUS = 5.0;
+const size_t DET_TICKS = 10000;
+const double DET_DT = 1e-3;
+const size_t DET_THREAD_COUNTS[] = {1, 2, 3, 4, 8};
+
+list_t *make_pentagon(vector_t center) {
+    list_t *points = list_init(5, free, NULL);
+    for (int i = 0; i < 5; i++) {
+        vector_t *point = malloc(sizeof(vector_t));
+        assert(point != NULL);
+        point->x = center.x + DET_RADIUS * cos(i * 2 * M_PI / 5);
+        point->y = center.y + DET_RADIUS * sin(i * 2 * M_PI / 5);
+        list_add(points, point);
+    }
+    return points;
+}
+
+/**
+ * Builds a grid of bodies with every kind of force that is evaluated in
+ * parallel: a gravity field, drag, springs and gravity between neighbors.
+ */
+scene_t *make_scene(size_t threads) {
+    scene_t *scene = scene_init();
+    for (size_t row = 0; row < DET_SIDE; row++) {
+        for (size_t col = 0; col < DET_SIDE; col++) {
+            body_t *body = body_init(make_pentagon((vector_t) {
+              col * DET_SPACING, row * DET_SPACING}), 1 + (row + col) % 3,
+              (rgb_color_t) {0, 0, 0});
+            body_set_velocity(body, (vector_t) {(double) col - row, 0});
+            scene_add_body(scene, body);
+            create_drag(scene, 0.05, body);
+            size_t index = scene_bodies(scene) - 1;
+            if (col > 0) {
+                create_spring(scene, 2.0, scene_get_body(scene, index - 1),
+                  body);
+            }
+            if (row > 0) {
+                create_newtonian_gravity(scene, 50.0,
+                  scene_get_body(scene, index - DET_SIDE), body);
+            }
+        }
+    }
+    scene_set_gravity_field(scene, barnes_hut_init(100.0, 0.5));
+    scene_set_deterministic(scene, true);
+    scene_set_threads(scene, threads);
+    return scene;
+}
+
+/**
+ * FNV-1a over the bytes of every centroid and velocity, so any difference
+ * in any bit changes the hash.
+ */
+uint64_t hash_scene(scene_t *scene) {
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < scene_bodies(scene); i++) {
+        body_t *body = scene_get_body(scene, i);
+        vector_t state[] = {body_get_centroid(body), body_get_velocity(body)};
+        unsigned char bytes[sizeof(state)];
+        memcpy(bytes, state, sizeof(state));
+        for (size_t b = 0; b < sizeof(bytes); b++) {
+            hash = (hash ^ bytes[b]) * 1099511628211u;
+        }
+    }
+    return hash;
+}
+
+uint64_t run(size_t threads) {
+    scene_t *scene = make_scene(threads);
+    for (size_t t = 0; t < DET_TICKS; t++) {
+        scene_tick(scene, DET_DT);
+    }
+    uint64_t hash = hash_scene(scene);
+    scene_free(scene);
+    return hash;
+}
+
+void test_thread_count_independent() {
+    uint64_t expected = run(DET_THREAD_COUNTS[0]);
+    for (size_t i = 1; i < sizeof(DET_THREAD_COUNTS) / sizeof(size_t); i++) {
+        assert(run(DET_THREAD_COUNTS[i]) == expected);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_thread_count_independent)
+
+    puts("determinism_test PASS");
+}
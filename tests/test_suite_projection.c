@@ -0,0 +1,98 @@
+#include "projection.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Up to this many points and axes, so every kernel's remainder loops run
+const size_t PROJECTION_TEST_MAX_POINTS = 20;
+const size_t PROJECTION_TEST_MAX_AXES = 17;
+const size_t PROJECTION_TEST_SHAPES = 2000;
+
+/**
+ * A random coordinate, sometimes exactly zero so that projections tie and
+ * signed zeros turn up.
+ */
+double random_coordinate(void) {
+    switch (rand() % 8) {
+        case 0:
+            return 0.0;
+        case 1:
+            return -0.0;
+        case 2:
+            return rand() % 5 - 2;
+        default:
+            return random_double(-100, 100);
+    }
+}
+
+/**
+ * Projects random shapes onto random axes with a kernel and with the scalar
+ * kernel, and checks that the results are bit-for-bit the same.
+ */
+void check_kernel(projection_kernel_t kernel) {
+    srand(1);
+    vector_t points[PROJECTION_TEST_MAX_POINTS];
+    vector_t axes[PROJECTION_TEST_MAX_AXES];
+    double mins[PROJECTION_TEST_MAX_AXES], maxes[PROJECTION_TEST_MAX_AXES];
+    double ref_mins[PROJECTION_TEST_MAX_AXES];
+    double ref_maxes[PROJECTION_TEST_MAX_AXES];
+    for (size_t s = 0; s < PROJECTION_TEST_SHAPES; s++) {
+        size_t n = 1 + rand() % PROJECTION_TEST_MAX_POINTS;
+        size_t axis_count = rand() % (PROJECTION_TEST_MAX_AXES + 1);
+        for (size_t i = 0; i < n; i++) {
+            points[i] = (vector_t) {random_coordinate(), random_coordinate()};
+        }
+        for (size_t a = 0; a < axis_count; a++) {
+            axes[a] = (vector_t) {random_coordinate(), random_coordinate()};
+        }
+        projection_set_kernel(PROJECTION_SCALAR);
+        project_points(points, n, axes, axis_count, ref_mins, ref_maxes);
+        projection_set_kernel(kernel);
+        assert(projection_get_kernel() == kernel);
+        project_points(points, n, axes, axis_count, mins, maxes);
+        assert(memcmp(mins, ref_mins, axis_count * sizeof(double)) == 0);
+        assert(memcmp(maxes, ref_maxes, axis_count * sizeof(double)) == 0);
+    }
+}
+
+void test_kernels_match_scalar() {
+    projection_kernel_t chosen = projection_get_kernel();
+    assert(projection_kernel_supported(chosen));
+    projection_kernel_t kernels[] = {PROJECTION_SCALAR, PROJECTION_SSE2,
+      PROJECTION_AVX2};
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        if (projection_kernel_supported(kernels[k])) {
+            check_kernel(kernels[k]);
+        }
+    }
+    projection_set_kernel(chosen);
+}
+
+void test_square_extents() {
+    vector_t square[] = {{-1, -2}, {3, -2}, {3, 4}, {-1, 4}};
+    vector_t axes[] = {{1, 0}, {0, 1}, {1, 1}, {-2, 0}, {0, 0}};
+    double mins[5], maxes[5];
+    project_points(square, 4, axes, 5, mins, maxes);
+    double expected_mins[] = {-1, -2, -3, -6, 0};
+    double expected_maxes[] = {3, 4, 7, 2, 0};
+    for (size_t a = 0; a < 5; a++) {
+        assert(mins[a] == expected_mins[a]);
+        assert(maxes[a] == expected_maxes[a]);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // Run all tests if there are no command-line arguments
+    bool all_tests = argc == 1;
+    // Read test name from file
+    char testname[100];
+    if (!all_tests) {
+        read_testname(argv[1], testname, sizeof(testname));
+    }
+
+    DO_TEST(test_kernels_match_scalar)
+    DO_TEST(test_square_extents)
+
+    puts("projection_test PASS");
+}